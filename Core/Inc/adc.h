@@ -65,4 +65,8 @@ uint32_t readADC(uint8_t bitPosition, ADC_regName_t regName);
 void ADC_temperatureSensorInit();
 float temperatureSensorRead();
 
+void ADC_continuousDmaStart(uint8_t channel);
+void ADC_continuousDmaStop(void);
+uint32_t ADC_dataRegAddr(void);
+
 #endif /* INC_ADC_H_ */
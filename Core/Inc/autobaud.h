@@ -0,0 +1,57 @@
+/*
+ * autobaud.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_AUTOBAUD_H_
+#define INC_AUTOBAUD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "uart.h"
+#include "timer.h"
+
+/*
+ * Console baud rate detection on USART1 RX (PB7), which doubles as TIM4_CH2 on AF2
+ *
+ * 		TIM4 runs in PWM input mode on TI2: IC2 captures falling edges and resets the counter,
+ * 		IC1 (mapped to the same pin) captures the rising edge in between. At the falling edge
+ * 		that ends the first data bit, CCR1 holds the start bit width and CCR2 - CCR1 the first
+ * 		data bit width. Both are one bit long for the sync characters CR (0x0D) and 'U' (0x55),
+ * 		so a pair that disagrees by more than AUTOBAUD_MATCH_PCT is rejected.
+ *
+ * 		The measured rate is snapped to the nearest standard rate, programmed through the integer
+ * 		BRR solver and announced at the new rate. The first frame received afterwards without a
+ * 		line error confirms it; a line error starts the detection over.
+ *
+ * 		The sync character is swallowed: nothing reaches the ring until the line has gone quiet
+ * 		after it. A board upstream in a firmware chain therefore sends FW_CHAIN_SYNC_CHAR and pauses
+ * 		before its "Update firmware" line (fwChain.h), so the 'U' of that line is never eaten.
+ */
+#define AUTOBAUD_AT_BOOT		1		//Detect the console rate from the first character after reset
+#define AUTOBAUD_TICK_HZ		50000000U	//54 ticks per bit at 921600; start + first bit at 2400 still fit 16 bits
+#define AUTOBAUD_MATCH_PCT		25U		//Start bit and first data bit must agree within this
+#define AUTOBAUD_SNAP_PCT		4U		//Measured rate must be this close to a standard rate
+
+typedef enum{
+	AUTOBAUD_OFF,		//Fixed rate
+	AUTOBAUD_ARMED,		//Receiver off, waiting for a sync character
+	AUTOBAUD_SETTLE,	//Measured (or rejected), waiting for the rest of the character to pass
+	AUTOBAUD_CONFIRM,	//New rate set, waiting for the first clean frame
+	AUTOBAUD_LOCKED
+}Autobaud_State_t;
+
+/*
+ * Function Declarations
+ */
+void autobaudStart(UART_Name_t uartName);
+void autobaudPoll(void);
+Autobaud_State_t autobaudState(void);
+uint32_t autobaudLastRate(void);
+
+void TIM4_IRQHandler(void);
+
+#endif /* INC_AUTOBAUD_H_ */
@@ -0,0 +1,70 @@
+/*
+ * cli.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_CLI_H_
+#define INC_CLI_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "uart.h"
+
+#define CLI_MAX_COMMANDS	24U		//Registry capacity
+#define CLI_HASH_SLOTS		32U		//Open-addressing table, power of 2 and > CLI_MAX_COMMANDS
+#define CLI_LINE_SIZE		64U		//Longest accepted line including arguments
+#define CLI_MAX_ARGS		4U
+#define CLI_BAUD_CONFIRM_MS	2000U	//Host must answer "Baud ok" at the new rate within this window
+
+typedef enum{
+	CLI_OK,
+	CLI_FULL,
+	CLI_DUPLICATE,
+	CLI_NOT_FOUND,
+	CLI_BAD_ARGS
+}CLI_Status_t;
+
+/*
+ * @brief	Arguments handed to a command handler after its parser accepted them
+ * 			argv[] point into the line buffer and are only valid during the handler call
+ */
+typedef struct{
+	uint8_t argc;
+	char* argv[CLI_MAX_ARGS];
+	uint32_t value[CLI_MAX_ARGS];	//Numeric form of argv[] when the parser converts them
+}CLI_Args_t;
+
+typedef CLI_Status_t (*CLI_ArgParser_t)(char* argText, CLI_Args_t* args);
+typedef void (*CLI_Handler_t)(const CLI_Args_t* args);
+
+/*
+ * @brief	One registry entry. Must stay valid after cliRegister() (keep it static const)
+ *
+ * @note	The name may contain spaces ("Orange led on"); the longest registered name that
+ * 			matches whole words at the start of the line wins, the rest goes to the parser
+ */
+typedef struct{
+	const char* name;
+	CLI_Handler_t handler;
+	CLI_ArgParser_t parser;	//NULL: command takes no arguments
+}CLI_Command_t;
+
+/*
+ * Function Declarations
+ */
+void cliInit(UART_Name_t uartName);
+CLI_Status_t cliRegister(const CLI_Command_t* command);
+void cliPoll(void);
+void cliSetUartInput(bool enable);
+void cliExecute(const char* text, uint16_t len);
+
+CLI_Status_t cliParseNone(char* argText, CLI_Args_t* args);
+CLI_Status_t cliParseWords(char* argText, CLI_Args_t* args);
+CLI_Status_t cliParseU32(char* argText, CLI_Args_t* args);
+
+#endif /* INC_CLI_H_ */
@@ -0,0 +1,74 @@
+/*
+ * cliTrace.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_CLITRACE_H_
+#define INC_CLITRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cli.h"
+#include "uart.h"
+#include "timer.h"
+
+/*
+ * Command round trip, stamped with the DWT cycle counter (CYCLE_COUNT())
+ *
+ * 		first byte --WIRE--> IDLE --POLL--> end of line --LOOKUP--> handler --RUN--> return --DRAIN--> last stop bit
+ *
+ * 		WIRE	the line on the wire; RX runs on DMA, so the first byte is dated back from the IDLE
+ * 				interrupt by one character time per byte plus the idle character
+ * 		POLL	frame published until cliPoll() reaches it: this is where the main loop's delay()
+ * 				busy-waits and anything else it does between passes show up
+ * 		LOOKUP	hash lookup and argument parsing
+ * 		RUN		the handler, including any wait for room in the TX ring
+ * 		DRAIN	until the last byte queued by the handler has left the shift register
+ *
+ * Each command also gets the part of its round trip spent inside delay() and blocked on TX
+ * (uartWriteAll() on a full ring, uartTxFlush()), and a histogram of its total latency.
+ */
+#define CLI_TRACE_BUCKETS	12U	//Bucket 0: below 1 ms, bucket n: [2^(n-1), 2^n) ms, the last one open-ended
+
+typedef enum{
+	CLI_TRACE_WIRE,
+	CLI_TRACE_POLL,
+	CLI_TRACE_LOOKUP,
+	CLI_TRACE_RUN,
+	CLI_TRACE_DRAIN,
+
+	CLI_TRACE_STAGES
+}CLI_TraceStage_t;
+
+/*
+ * @brief	Accumulated round trips of one command, times in microseconds
+ */
+typedef struct{
+	const CLI_Command_t* command;	//NULL: free entry
+	uint32_t count;
+	uint32_t stageUs[CLI_TRACE_STAGES];	//Sum per stage
+	uint32_t maxUs;						//Worst total
+	uint32_t delayUs;					//Sum of the time inside delay()
+	uint32_t txBlockedUs;				//Sum of the time blocked on TX
+	uint16_t hist[CLI_TRACE_BUCKETS];
+}CLI_TraceEntry_t;
+
+/*
+ * Function Declarations
+ */
+void cliTraceInit(UART_Name_t uartName);
+void cliTraceReset(void);
+void cliTraceRxFrame(uint32_t len);
+void cliTraceLineEnd(void);
+void cliTraceDispatch(const CLI_Command_t* command);
+void cliTraceHandlerDone(void);
+void cliTracePoll(void);
+
+const CLI_TraceEntry_t* cliTraceEntry(uint8_t index);
+uint32_t cliTraceSkipped(void);
+void cliTracePrint(UART_Name_t uartName);
+
+#endif /* INC_CLITRACE_H_ */
@@ -0,0 +1,67 @@
+/*
+ * dlog.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_DLOG_H_
+#define INC_DLOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "timer.h"
+
+/*
+ * Deferred logging
+ * 		DLOG("ADC %u mV, %d.%02u C", mv, whole, frac) puts its format string in the .dlog
+ * 		linker section, which is never loaded: the string costs no flash and its address is
+ * 		the log ID. At run time only the ID, a millisecond timestamp and the raw 32-bit
+ * 		arguments are queued; Tools/dlog_decode.py reads the strings back out of the ELF.
+ *
+ * 		Arguments are 32-bit words: integers as they are, floats through DLOG_FLOAT(),
+ * 		pointers cast to uint32_t. %s is not supported (the host cannot read target RAM).
+ *
+ * Wire record, little-endian, packed into TELEMETRY_MSG_DLOG frames
+ *
+ * 		| id (2) | arg count (1) | timestamp ms (4) | args (4 x count) |
+ */
+#define DLOG_ENABLE		1		//0: every DLOG() compiles to nothing
+#define DLOG_RING_WORDS	256U	//Queued words (2 + args per record), must be a power of 2
+#define DLOG_MAX_ARGS	4U
+
+#define DLOG_RECORD_HEADER	7U	//id + count + timestamp on the wire
+
+#if DLOG_ENABLE
+
+/* Number of variadic arguments, 0 to DLOG_MAX_ARGS */
+#define DLOG_NARGS(...)				DLOG_NARGS_(_, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_, a, b, c, d, n, ...)	n
+
+#define DLOG(fmt, ...) do{ \
+	static const char dlogFormat[] __attribute__((section(".dlog"), used)) = fmt; \
+	dlogWrite((uint16_t)(uintptr_t)dlogFormat, DLOG_NARGS(__VA_ARGS__), \
+			  (const uint32_t[DLOG_MAX_ARGS + 1U]){0, ##__VA_ARGS__} + 1); \
+}while(0)
+
+#else
+#define DLOG(fmt, ...)	do{}while(0)
+#endif
+
+/* @brief	Bit pattern of a float argument, printed by %f/%e/%g on the host */
+static inline uint32_t DLOG_FLOAT(float value){
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof bits);
+	return bits;
+}
+
+/*
+ * Function Declarations
+ */
+void dlogWrite(uint16_t id, uint8_t argCount, const uint32_t* args);
+void dlogPoll(void);
+uint32_t dlogDropped(void);
+
+#endif /* INC_DLOG_H_ */
@@ -10,8 +10,16 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "stm32PeripheralAddr.h"
+#include "rcc.h"
+#include "exti.h"
+
+typedef enum{
+	my_DMA1,
+	my_DMA2
+}DMA_Name_t;
 
 typedef enum {
 	DMA_LISR,
@@ -78,10 +86,141 @@ typedef enum {
 	DMA_REG_COUNT
 }DMA_RegName_t;
 
+/*
+ * Per-stream register by stream number (0..7)
+ */
+#define DMA_STREAM_REG_COUNT	6U
+#define DMA_SxCR(stream)		((DMA_RegName_t)(DMA_S0CR   + (stream) * DMA_STREAM_REG_COUNT))
+#define DMA_SxNDTR(stream)		((DMA_RegName_t)(DMA_S0NDTR + (stream) * DMA_STREAM_REG_COUNT))
+#define DMA_SxPAR(stream)		((DMA_RegName_t)(DMA_S0PAR  + (stream) * DMA_STREAM_REG_COUNT))
+#define DMA_SxM0AR(stream)		((DMA_RegName_t)(DMA_S0M0AR + (stream) * DMA_STREAM_REG_COUNT))
+#define DMA_SxM1AR(stream)		((DMA_RegName_t)(DMA_S0M1AR + (stream) * DMA_STREAM_REG_COUNT))
+#define DMA_SxFCR(stream)		((DMA_RegName_t)(DMA_S0FCR  + (stream) * DMA_STREAM_REG_COUNT))
+
+/*
+ * Stream flags as returned by dmaStreamFlags() (same order for every stream)
+ */
+#define DMA_FLAG_FE		(1U << 0)	//FIFO error
+#define DMA_FLAG_DME	(1U << 2)	//Direct mode error
+#define DMA_FLAG_TE		(1U << 3)	//Transfer error
+#define DMA_FLAG_HT		(1U << 4)	//Half transfer
+#define DMA_FLAG_TC		(1U << 5)	//Transfer complete
+#define DMA_FLAG_ALL	0x3DU
+
+/*
+ * Stream handle: DMA1 streams 0-7 are 0-7, DMA2 streams 0-7 are 8-15
+ *
+ * 		The handle alone locates everything: the controller is bit 3, the register block is
+ * 		&DMA_S0CR + 6 * stream and the flags sit in LISR/HISR (stream bit 2) at 0, 6, 16 or 22
+ * 		(stream bits 0-1). No call goes through a per-register table or switch.
+ */
+typedef uint8_t DMA_Stream_t;
+
+#define DMA_STREAM_COUNT		16U
+#define DMA_STREAM(dma, stream)	((DMA_Stream_t)(((dma) << 3) | ((stream) & 7U)))
+#define DMA_STREAM_DMA(handle)	((DMA_Name_t)((handle) >> 3))
+#define DMA_STREAM_NUM(handle)	((uint8_t)((handle) & 7U))
+
+typedef enum{
+	DMA_OK,
+	DMA_ERR_PARAM,		//Unknown stream or a field out of range
+	DMA_ERR_BUSY,		//Stream still enabled
+	DMA_ERR_TRANSFER	//Stream stopped on a transfer error
+}DMA_Status_t;
+
+typedef enum{
+	DMA_DIR_P2M,		//Peripheral (PAR) to memory (M0AR)
+	DMA_DIR_M2P,		//Memory (M0AR) to peripheral (PAR)
+	DMA_DIR_M2M			//PAR to M0AR, DMA2 only, never circular
+}DMA_Dir_t;
+
+typedef enum{
+	DMA_WIDTH_8,
+	DMA_WIDTH_16,
+	DMA_WIDTH_32
+}DMA_Width_t;
+
+typedef enum{
+	DMA_PRIO_LOW,
+	DMA_PRIO_MEDIUM,
+	DMA_PRIO_HIGH,
+	DMA_PRIO_VERY_HIGH
+}DMA_Priority_t;
+
+#define DMA_FIFO_BYTES		16U		//Per stream, four words
+
+typedef enum{
+	DMA_FIFO_DIRECT,	//No FIFO: every item goes straight through (not allowed for M2M)
+	DMA_FIFO_1_4,		//FIFO on, drained/filled at this fill level
+	DMA_FIFO_1_2,
+	DMA_FIFO_3_4,
+	DMA_FIFO_FULL
+}DMA_Fifo_t;
+
+typedef enum{
+	DMA_BURST_SINGLE,
+	DMA_BURST_INCR4,	//Beats per burst; needs a FIFO threshold that holds whole bursts
+	DMA_BURST_INCR8,
+	DMA_BURST_INCR16
+}DMA_Burst_t;
+
+/*
+ * @brief	Everything dmaStreamConfigure() writes; per-transfer values go to dmaStreamStart()
+ */
+typedef struct{
+	uint8_t channel;			//CHSEL: request mapping (RM0383 Tables 27 and 28)
+	DMA_Dir_t dir;
+	DMA_Width_t periphWidth;
+	DMA_Width_t memWidth;
+	bool periphInc;
+	bool memInc;
+	bool circular;
+	DMA_Priority_t priority;
+	DMA_Fifo_t fifo;			//Zero: direct mode, as every peripheral stream so far
+	DMA_Burst_t periphBurst;
+	DMA_Burst_t memBurst;
+	uint32_t irqFlags;			//DMA_FLAG_TC | HT | TE | DME interrupts to enable, 0 for polling
+	uint32_t periphAddr;		//PAR: the peripheral register (M2M: the source)
+}DMA_StreamConfig_t;
+
+/*
+ * @brief	Completion callback, in interrupt context. @p flags are the stream flags that were
+ * 			set (and have already been cleared) when the stream's interrupt ran
+ */
+typedef void (*DMA_StreamCallback_t)(DMA_Stream_t stream, uint32_t flags, void* context);
+
+/*
+ * @brief	Double-buffer completion, in interrupt context. @p done (0 or 1) is the buffer the
+ * 			stream just finished: it is idle until the other one completes, so it can be read,
+ * 			refilled or retargeted with dmaStreamSetBuffer() in the meantime
+ */
+typedef void (*DMA_BufferCallback_t)(DMA_Stream_t stream, uint8_t done, void* context);
+
 /*
  * Function Declarations
  */
-void writeDMA2(uint8_t bitPosition, DMA_RegName_t regName, uint32_t value);
-uint32_t readDMA2(uint8_t bitPosition, DMA_RegName_t regName);
+void writeDMA(DMA_Name_t dma, uint8_t bitPosition, DMA_RegName_t regName, uint32_t value);
+uint32_t readDMA(DMA_Name_t dma, uint8_t bitPosition, DMA_RegName_t regName);
+
+volatile dmaStreamRegOffset_t* dmaStreamRegs(DMA_Stream_t stream);
+IRQn_Pos_t dmaStreamIrq(DMA_Stream_t stream);
+DMA_Status_t dmaStreamConfigure(DMA_Stream_t stream, const DMA_StreamConfig_t* config);
+DMA_Status_t dmaStreamStart(DMA_Stream_t stream, const volatile void* memory, uint16_t count);
+void dmaStreamStop(DMA_Stream_t stream);
+bool dmaStreamBusy(DMA_Stream_t stream);
+DMA_Status_t dmaStreamSetPriority(DMA_Stream_t stream, DMA_Priority_t priority);
+uint16_t dmaStreamRemaining(DMA_Stream_t stream);
+
+uint32_t dmaStreamFlags(DMA_Stream_t stream);
+void dmaStreamClearFlags(DMA_Stream_t stream, uint32_t flags);
+
+DMA_Status_t dmaStreamStartDouble(DMA_Stream_t stream, const volatile void* buffer0, const volatile void* buffer1, uint16_t count);
+uint8_t dmaStreamActiveBuffer(DMA_Stream_t stream);
+DMA_Status_t dmaStreamSetBuffer(DMA_Stream_t stream, uint8_t buffer, const volatile void* memory);
+uint32_t dmaStreamMissedBuffers(DMA_Stream_t stream);
+
+void dmaStreamSetCallback(DMA_Stream_t stream, DMA_StreamCallback_t callback, void* context);
+void dmaStreamSetBufferCallback(DMA_Stream_t stream, DMA_BufferCallback_t callback, void* context);
+void dmaStreamIRQHandler(DMA_Stream_t stream);
 
 #endif /* INC_DMA_H_ */
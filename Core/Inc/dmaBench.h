@@ -0,0 +1,82 @@
+/*
+ * dmaBench.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_DMABENCH_H_
+#define INC_DMABENCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dma.h"
+#include "dmaMem.h"
+#include "adc.h"
+#include "uart.h"
+#include "timer.h"
+
+/*
+ * DMA2 contention benchmark
+ *
+ * 		Three lanes share DMA2 the way the application does: the console TX stream, ADC1
+ * 		converting back to back into a double buffer, and dmaMemcpy() copying blocks as fast as
+ * 		its completion callback can restart it. Each lane first runs alone for a window, then all
+ * 		three together, so the drop in throughput and the rise in latency show what the other
+ * 		streams cost it under the FIFO, burst and priority settings in force.
+ *
+ * 		Latency is the transfer's start to its TC interrupt; for the double-buffered ADC lane it
+ * 		is the time between two buffer completions, which only grows when samples are late.
+ *
+ * 		The ADC lane consumes its samples the way a sampling task would: every finished buffer
+ * 		is parked whole and the stream's idle buffer is retargeted (dmaStreamSetBuffer()) at a
+ * 		spare one, with a third buffer in rotation. A retarget the stream has already overtaken
+ * 		and every buffer completion lost to a late interrupt (dmaStreamMissedBuffers()) count as
+ * 		errors of the lane.
+ */
+#define DMA_BENCHMARK			1		//"Bench contention" and the lane buffers below
+
+#define DMA_BENCH_WINDOW_MS		100U	//Per scenario
+#define DMA_BENCH_UART			my_UART1	//Console: its TX stream is borrowed, then handed back
+#define DMA_BENCH_UART_STREAM	DMA_STREAM(my_DMA2, 7)	//USART1_TX on channel 4
+#define DMA_BENCH_UART_BYTES	32U		//One payload line per transfer
+#define DMA_BENCH_ADC_STREAM	DMA_STREAM(my_DMA2, 4)	//ADC1 on channel 0 (Stream 0 is DMA_MEM_STREAM)
+#define DMA_BENCH_ADC_CHANNEL	16U		//Temperature sensor, 480-cycle sampling
+#define DMA_BENCH_ADC_SAMPLES	64U		//Per buffer, three buffers in rotation
+#define DMA_BENCH_ADC_PRIORITY	DMA_PRIO_HIGH
+#define DMA_BENCH_MEM_BYTES		DMA_MEM_BENCH_MAX	//Never below the crossover, so always DMA
+
+typedef enum{
+	DMA_BENCH_LANE_UART,
+	DMA_BENCH_LANE_ADC,
+	DMA_BENCH_LANE_MEM,
+	DMA_BENCH_LANES
+}DMA_BenchLane_t;
+
+/*
+ * @brief	One lane over one window, latencies in core cycles
+ */
+typedef struct{
+	uint32_t transfers;		//Completed in the window
+	uint32_t bytes;
+	uint32_t latencyAvg;
+	uint32_t latencyMax;
+	uint32_t errors;		//TE/DME/FE; ADC overruns, missed buffers and refused retargets
+}DMA_BenchLaneStats_t;
+
+typedef struct{
+	uint32_t windowCycles;
+	DMA_BenchLaneStats_t alone[DMA_BENCH_LANES];
+	DMA_BenchLaneStats_t shared[DMA_BENCH_LANES];
+}DMA_BenchResult_t;
+
+/*
+ * Function Declarations
+ */
+#if DMA_BENCHMARK
+void dmaBenchContention(DMA_BenchResult_t* result);
+const char* dmaBenchLaneName(DMA_BenchLane_t lane);
+#endif
+
+#endif /* INC_DMABENCH_H_ */
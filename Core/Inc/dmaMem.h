@@ -0,0 +1,71 @@
+/*
+ * dmaMem.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_DMAMEM_H_
+#define INC_DMAMEM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "dma.h"
+#include "timer.h"
+
+/*
+ * Asynchronous memory-to-memory copy and fill on one DMA2 stream
+ *
+ * 		One request is in flight at a time; a second one gets DMA_ERR_BUSY. Requests
+ * 		shorter than the crossover are done by the CPU on the spot and complete before the
+ * 		call returns. The crossover is measured by dmaMemCalibrate(): the smallest block for
+ * 		which a DMA copy finishes sooner than memcpy().
+ *
+ * 		The item width is the widest one that source, destination and length are all aligned
+ * 		to, and bursts are only used when both addresses are aligned to a whole burst (a burst
+ * 		must never cross a 1 KB boundary).
+ */
+#define DMA_MEM_STREAM			DMA_STREAM(my_DMA2, 0)	//Free: the USART streams are DMA2 1, 2, 5, 6, 7
+#define DMA_MEM_FIFO			DMA_FIFO_FULL
+#define DMA_MEM_BURST			DMA_BURST_INCR4
+#define DMA_MEM_PRIORITY		DMA_PRIO_LOW		//Peripheral streams come first
+#define DMA_MEM_CROSSOVER		64U		//Bytes, until dmaMemCalibrate() has measured it
+
+#define DMA_MEM_BENCHMARK		1		//dmaMemBenchmark() and the calibration buffers
+#define DMA_MEM_BENCH_MAX		4096U	//Largest block measured; two of these are reserved in RAM
+#define DMA_MEM_BENCH_SIZES		5U		//16, 64, 256, 1024, 4096 bytes
+#define DMA_MEM_BENCH_ROUNDS	4U		//Best of, so a timer interrupt does not spoil a sample
+
+/*
+ * @brief	Completion of a request; in interrupt context unless the CPU did the work
+ */
+typedef void (*DMA_MemCallback_t)(DMA_Status_t status, void* context);
+
+/*
+ * @brief	One block size, in core cycles
+ */
+typedef struct{
+	uint32_t size;
+	uint32_t cpuCycles;		//memcpy()
+	uint32_t dmaCycles;		//dmaMemcpy() call until its completion callback
+	uint32_t setupCycles;	//dmaMemcpy() call until it returned: the only part the CPU pays
+}DMA_MemBench_t;
+
+/*
+ * Function Declarations
+ */
+void dmaMemInit(void);
+DMA_Status_t dmaMemcpy(void* dst, const void* src, uint32_t len, DMA_MemCallback_t callback, void* context);
+DMA_Status_t dmaMemset(void* dst, uint8_t value, uint32_t len, DMA_MemCallback_t callback, void* context);
+bool dmaMemBusy(void);
+void dmaMemWait(void);
+uint32_t dmaMemCrossover(void);
+
+#if DMA_MEM_BENCHMARK
+void dmaMemCalibrate(void);
+void dmaMemBenchmark(DMA_MemBench_t result[DMA_MEM_BENCH_SIZES]);
+#endif
+
+#endif /* INC_DMAMEM_H_ */
@@ -0,0 +1,92 @@
+/*
+ * dmaTrace.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_DMATRACE_H_
+#define INC_DMATRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dma.h"
+#include "rcc.h"
+#include "timer.h"
+
+/*
+ * Transfer tracing for all 16 streams, stamped with the DWT cycle counter (CYCLE_COUNT())
+ *
+ * 		dma.c reports every start (dmaStreamStart(), dmaStreamStartDouble()), every TC and
+ * 		error flag its stream interrupt sees, and every dmaStreamStop(). A transfer runs from
+ * 		its start to its TC; a circular or double-buffered stream's passes are one transfer
+ * 		each, back to back. Each finished transfer goes into a ring of DMA_TRACE_DEPTH records
+ * 		and into the stream's statistics.
+ *
+ * 		Busy time is the time a transfer was in flight, waiting for its peripheral included,
+ * 		so it says how long a stream holds its slot rather than how many bus cycles it used;
+ * 		bytes per second is the load. A controller's busy time only counts one-shot transfers:
+ * 		circular and double-buffered streams are always in flight. A stream is being starved
+ * 		when the latency of its fixed-size transfers grows after another stream was added, or
+ * 		FE/DME errors appear.
+ *
+ * 		A stream without a TC interrupt (polled) is only seen to have finished at its next
+ * 		start or stop: its transfers count with their bytes, but without latency or busy time.
+ * 		Latencies above 2^32 cycles (~42 s at 100MHz) wrap.
+ */
+#define DMA_TRACE			1		//Hooks in dma.c, "DMA stats" and "DMA trace"
+#define DMA_TRACE_DEPTH		32U		//Records in the ring, a power of two
+
+typedef enum{
+	DMA_TRACE_DONE,		//TC
+	DMA_TRACE_ERROR,	//TE, DME or FE; the transfer goes on unless the stream stopped (TE)
+	DMA_TRACE_STOPPED,	//dmaStreamStop() before TC, bytes as far as it got
+	DMA_TRACE_UNTIMED	//Finished without a TC interrupt, noticed later
+}DMA_TraceEvent_t;
+
+/*
+ * @brief	One transfer, times in core cycles
+ */
+typedef struct{
+	uint32_t startAt;
+	uint32_t endAt;			//TC, error, stop, or when an untimed transfer was noticed
+	uint32_t bytes;
+	uint8_t stream;			//DMA_Stream_t
+	uint8_t event;			//DMA_TraceEvent_t
+	uint8_t flags;			//DMA_FLAG_* the interrupt saw
+}DMA_TraceRecord_t;
+
+/*
+ * @brief	One stream since dmaTraceReset(), latencies in core cycles
+ */
+typedef struct{
+	uint32_t transfers;		//Finished, timed or not
+	uint32_t bytes;
+	uint32_t latencyAvg;	//Start to TC, timed transfers only
+	uint32_t latencyMax;
+	uint16_t busyPermille;	//Of the window with a transfer in flight
+	uint32_t te;
+	uint32_t dme;
+	uint32_t fe;
+	uint32_t stopped;
+	bool active;			//A transfer is in flight right now
+}DMA_TraceStats_t;
+
+/*
+ * Function Declarations
+ */
+#if DMA_TRACE
+void dmaTraceStart(DMA_Stream_t stream, uint32_t bytes, bool timed, bool continuous);
+void dmaTraceEvent(DMA_Stream_t stream, uint32_t flags, bool running, uint32_t remainingBytes);
+void dmaTraceStop(DMA_Stream_t stream, bool wasRunning, uint32_t remainingBytes);
+
+void dmaTraceReset(void);
+void dmaTraceStats(DMA_Stream_t stream, DMA_TraceStats_t* out);
+uint16_t dmaTraceControllerBusy(DMA_Name_t dma);
+uint32_t dmaTraceWindowMs(void);
+bool dmaTraceRecord(uint8_t age, DMA_TraceRecord_t* out);
+uint32_t dmaTraceRecorded(void);
+#endif
+
+#endif /* INC_DMATRACE_H_ */
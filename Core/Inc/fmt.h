@@ -0,0 +1,52 @@
+/*
+ * fmt.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_FMT_H_
+#define INC_FMT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FMT_BUF_SIZE		24U		//Fits any result below: sign + 10 digits + '.' + 9 decimals + '\0'
+#define FMT_MAX_DECIMALS	9U
+
+/*
+ * fmtBenchmark() and "Bench fmt" compare against newlib snprintf("%.2f"), which pulls the float
+ * printf back in. Production builds leave it out; for a benchmark build set FMT_BENCHMARK to 1
+ * and tick "Use float with printf from newlib-nano (-u _printf_float)" in the linker settings,
+ * without it nano printf prints nothing for %f and the comparison is meaningless.
+ */
+#define FMT_BENCHMARK		0
+#define FMT_BENCH_ROUNDS	32U
+
+/*
+ * @brief	Average core cycles per call, fmt vs snprintf, on the same inputs
+ */
+typedef struct{
+	uint32_t fmtI32;
+	uint32_t snprintfI32;
+	uint32_t fmtFloat;
+	uint32_t snprintfFloat;
+}FMT_Bench_t;
+
+/*
+ * Function Declarations
+ *
+ * Every formatter writes into @p out (at least FMT_BUF_SIZE bytes), terminates it
+ * with '\0' and returns the number of characters written without the terminator
+ */
+uint8_t fmtU32(char* out, uint32_t value);
+uint8_t fmtI32(char* out, int32_t value);
+uint8_t fmtHex32(char* out, uint32_t value, uint8_t digits);
+uint8_t fmtFixed(char* out, int32_t value, uint8_t decimals);
+uint8_t fmtFloat(char* out, float value, uint8_t decimals);
+
+#if FMT_BENCHMARK
+void fmtBenchmark(FMT_Bench_t* result);
+#endif
+
+#endif /* INC_FMT_H_ */
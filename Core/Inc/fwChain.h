@@ -0,0 +1,64 @@
+/*
+ * fwChain.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_FWCHAIN_H_
+#define INC_FWCHAIN_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32PeripheralAddr.h"
+#include "uart.h"
+#include "dma.h"
+
+/*
+ * Daisy-chain settings
+ *
+ * The downstream board is wired: PC6 (USART6_TX) of this board -> PB7 (USART1_RX) of the next board
+ * Both links must use the same baud rate, parity and word length
+ *
+ * The downstream board may be detecting its console rate (AUTOBAUD_AT_BOOT): its receiver is then
+ * off until a sync character has been measured and the line has gone quiet again. The link has no
+ * return path, so the announcement is preceded by FW_CHAIN_SYNC_CHAR and a FW_CHAIN_SYNC_GAP_MS pause
+ * instead of a handshake. A board at a fixed rate skips the lone CR like any empty line.
+ *
+ * After an abort (FW_CHAIN_ABORTED) the downstream board is left in update mode waiting for the
+ * rest of an image that never comes; nothing is sent to release it, so it must be reset before
+ * the next attempt.
+ */
+#define FW_CHAIN_ENABLE			1		//Set to 0 on the last board of the chain (no USART6 wiring)
+#define FW_CHAIN_SOURCE_UART	my_UART1	//Link the image arrives on
+#define FW_CHAIN_UART			my_UART6	//Link the image is forwarded on
+#define FW_CHAIN_TX_STREAM		DMA_STREAM(my_DMA2, 6)	//USART6_TX on channel 5
+#define FW_CHAIN_BLOCK_SIZE		1024U		//Bytes forwarded per DMA burst
+#define FW_CHAIN_START_CMD		"Update firmware\n"
+#define FW_CHAIN_SYNC_CHAR		"\r"		//Autobaud sync character, never reaches the downstream CLI
+#define FW_CHAIN_SYNC_GAP_MS	20U		//Downstream quiet time (~2ms at 9600) plus its main loop latency
+
+typedef enum{
+	FW_CHAIN_IDLE,
+	FW_CHAIN_SYNC,			//Downstream board has not been sent the sync character yet
+	FW_CHAIN_ANNOUNCE,		//Sync character sent, the announcement waits for the gap to pass
+	FW_CHAIN_FORWARDING,	//Verified blocks are streamed as they arrive
+	FW_CHAIN_DONE,			//Whole image left the shift register
+	FW_CHAIN_ABORTED		//Line error on the source link, nothing more is forwarded; reset downstream
+}FW_Chain_State_t;
+
+/*
+ * Function Declarations
+ */
+void fwChainInit(void);
+void fwChainStart(const char* image, uint32_t imageSize);
+void fwChainReceiveComplete(void);
+void fwChainPoll(void);
+void fwChainFlush(void);
+
+bool fwChainBusy(void);
+FW_Chain_State_t fwChainState(void);
+
+#endif /* INC_FWCHAIN_H_ */
@@ -0,0 +1,89 @@
+/*
+ * log.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_LOG_H_
+#define INC_LOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dlog.h"
+
+/*
+ * Leveled front end of the deferred logger
+ * 		LOG_W(UART, "line error, SR 0x%02x", sr) logs "W UART: line error, SR 0x.." through DLOG()
+ *
+ * 		Two filters, both ahead of any argument evaluation:
+ * 		- Sites above LOG_COMPILE_LEVEL are removed by the preprocessor: no code, no string.
+ * 		- The rest check the module's runtime level (one load and compare) and return
+ * 		  before the record is built. "Log <module> <level>" changes it from the console.
+ */
+#define LOG_LEVEL_OFF		0
+#define LOG_LEVEL_ERROR		1
+#define LOG_LEVEL_WARN		2
+#define LOG_LEVEL_INFO		3
+#define LOG_LEVEL_DEBUG		4
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL	LOG_LEVEL_DEBUG	//Highest level compiled in, override with -DLOG_COMPILE_LEVEL=...
+#endif
+#define LOG_DEFAULT_LEVEL	LOG_LEVEL_INFO	//Runtime level of every module after boot
+
+/*
+ * @brief	Modules with their own runtime level. LOG_x(NAME, ...) uses LOG_MOD_NAME
+ */
+typedef enum{
+	LOG_MOD_APP,
+	LOG_MOD_UART,
+	LOG_MOD_CLI,
+	LOG_MOD_FWCHAIN,
+	LOG_MOD_TELEMETRY,
+	LOG_MOD_DMA,
+	LOG_MOD_COUNT
+}Log_Module_t;
+
+extern uint8_t logLevel[LOG_MOD_COUNT];
+
+#define LOG_AT(mod, level, tag, fmt, ...) do{ \
+	if((level) <= logLevel[LOG_MOD_##mod]) DLOG(tag " " #mod ": " fmt, ##__VA_ARGS__); \
+}while(0)
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(mod, fmt, ...)	LOG_AT(mod, LOG_LEVEL_ERROR, "E", fmt, ##__VA_ARGS__)
+#else
+#define LOG_E(mod, fmt, ...)	do{}while(0)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(mod, fmt, ...)	LOG_AT(mod, LOG_LEVEL_WARN, "W", fmt, ##__VA_ARGS__)
+#else
+#define LOG_W(mod, fmt, ...)	do{}while(0)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(mod, fmt, ...)	LOG_AT(mod, LOG_LEVEL_INFO, "I", fmt, ##__VA_ARGS__)
+#else
+#define LOG_I(mod, fmt, ...)	do{}while(0)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(mod, fmt, ...)	LOG_AT(mod, LOG_LEVEL_DEBUG, "D", fmt, ##__VA_ARGS__)
+#else
+#define LOG_D(mod, fmt, ...)	do{}while(0)
+#endif
+
+/*
+ * Function Declarations
+ */
+void logSetLevel(Log_Module_t module, uint8_t level);
+uint8_t logGetLevel(Log_Module_t module);
+const char* logModuleName(Log_Module_t module);
+const char* logLevelName(uint8_t level);
+bool logParseModule(const char* name, Log_Module_t* out);
+bool logParseLevel(const char* name, uint8_t* out);
+
+#endif /* INC_LOG_H_ */
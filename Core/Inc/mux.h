@@ -0,0 +1,62 @@
+/*
+ * mux.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_MUX_H_
+#define INC_MUX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "uart.h"
+
+/*
+ * Virtual channel frame, before COBS encoding
+ *
+ * 		| channel (1) | payload (0..MUX_MAX_PAYLOAD) | CRC16 (2, little-endian) |
+ *
+ * Same CRC-16/CCITT-FALSE and COBS + 0x00 delimiter as the telemetry frames, so one
+ * decoder resynchronises on both. Tools/telemetry_decode.py --mux splits the channels.
+ */
+#define MUX_MAX_PAYLOAD		80U	//Fits a whole telemetry frame (TELEMETRY_MAX_FRAME)
+#define MUX_CRC_SIZE		2U
+#define MUX_MAX_FRAME		(1U + MUX_MAX_PAYLOAD + MUX_CRC_SIZE)
+#define MUX_MAX_ENCODED		(MUX_MAX_FRAME + MUX_MAX_FRAME / 254U + 2U) //COBS overhead + delimiter
+
+#define MUX_QUEUE_SIZE		256U	//Encoded frames waiting per channel, must be a power of 2
+
+/*
+ * A frame is only handed to the UART while its TX ring holds fewer bytes than this, so a
+ * control reply never waits behind more than one low-water mark of bulk data
+ * (the rest stays in the per-channel queues, where priority still applies)
+ */
+#define MUX_TX_LOW_WATER	32U
+
+/*
+ * @brief	Channel IDs double as TX priorities: the lowest ID with a queued frame goes first
+ */
+typedef enum{
+	MUX_CH_CONTROL,		//Console commands and their replies
+	MUX_CH_UPDATE,		//Firmware update data and progress
+	MUX_CH_LOG,			//Telemetry and other bulk logs, dropped when its queue is full
+	MUX_CHANNEL_COUNT
+}MUX_Channel_t;
+
+typedef void (*MUX_Handler_t)(MUX_Channel_t channel, const uint8_t* payload, uint16_t len);
+
+/*
+ * Function Declarations
+ */
+void muxInit(UART_Name_t uartName);
+void muxStart(void);
+void muxStop(void);
+bool muxActive(void);
+
+void muxRegisterHandler(MUX_Channel_t channel, MUX_Handler_t handler);
+bool muxSend(MUX_Channel_t channel, const uint8_t* payload, uint16_t len);
+void muxPoll(void);
+
+#endif /* INC_MUX_H_ */
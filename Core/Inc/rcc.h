@@ -33,6 +33,9 @@
 #define PLLRDY_TIMEOUT	0x4000U //Max pollong loops while waiting for the main PLL
 #define	SWS_TIMEOUT		0x4000U //Max polling loops while verifying SYSCLK switch
 
+#define HSI_CLK_FREQ	16000000UL	//Internal RC oscillator
+#define HSE_CLK_FREQ	8000000UL	//On-board crystal
+
 /*
  * ------------------------------------------
  * Enumeration
@@ -93,6 +96,14 @@ void RCC_init(void);
 void writeRCC(uint8_t bitPosition, RCC_Mode_t mode, uint32_t value);
 uint32_t readRCC(uint8_t bitPosition, RCC_Mode_t mode);
 
+/*
+ * @brief	Bus clocks decoded from the live RCC configuration (not from a constant)
+ */
+uint32_t RCC_getSysClockFreq(void);
+uint32_t RCC_getHCLKFreq(void);
+uint32_t RCC_getPCLK1Freq(void);
+uint32_t RCC_getPCLK2Freq(void);
+
 /*
  * ----------------------------------------
  * Peripheral Clock Control - TIM
@@ -205,6 +216,17 @@ void my_RCC_I2C3_CLK_DISABLE();
 void my_RCC_ADC1_CLK_ENABLE();
 void my_RCC_ADC1_CLK_DISABLE();
 
+/*
+ * ----------------------------------------
+ * Peripheral Clock Control - DMA
+ * ----------------------------------------
+ */
+void my_RCC_DMA1_CLK_ENABLE();
+void my_RCC_DMA1_CLK_DISABLE();
+
+void my_RCC_DMA2_CLK_ENABLE();
+void my_RCC_DMA2_CLK_DISABLE();
+
 
 
 #endif /* INC_RCC_H_ */
@@ -57,6 +57,11 @@
 #define NVIC_BASE_ADDR 	0xE000E100U
 #define VTOR_BASE_ADDR 0xE000ED08UL
 
+/* Cortex-M4 debug (cycle counter) */
+#define DWT_CTRL_ADDR	0xE0001000U
+#define DWT_CYCCNT_ADDR	0xE0001004U
+#define DEMCR_ADDR		0xE000EDFCU
+
 
 /*
  * ----------------------------------------------------
@@ -282,6 +287,16 @@ typedef struct{
 	volatile uint32_t DMA_S7FCR;
 }dmaRegOffset_t;
 
+/* @brief	One stream's block inside dmaRegOffset_t: stream n starts at &DMA_S0CR + 6 * n */
+typedef struct{
+	volatile uint32_t SxCR;
+	volatile uint32_t SxNDTR;
+	volatile uint32_t SxPAR;
+	volatile uint32_t SxM0AR;
+	volatile uint32_t SxM1AR;
+	volatile uint32_t SxFCR;
+}dmaStreamRegOffset_t;
+
 /* @brief	FLASH interface register map */
 typedef struct{
 	volatile uint32_t FLASH_ACR;
@@ -0,0 +1,70 @@
+/*
+ * telemetry.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_TELEMETRY_H_
+#define INC_TELEMETRY_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "uart.h"
+#include "timer.h"
+#include "mux.h"
+
+/*
+ * Binary frame, before COBS encoding (all multi-byte fields little-endian)
+ *
+ * 		| type (1) | seq (1) | timestamp ms (4) | payload (0..TELEMETRY_MAX_PAYLOAD) | CRC16 (2) |
+ *
+ * The CRC is CRC-16/CCITT-FALSE over type..payload. The frame is COBS-encoded and
+ * terminated by a single 0x00, so a receiver resynchronises at the next zero byte.
+ * Tools/telemetry_decode.py is the host-side decoder.
+ * While the channel mux owns the UART the unencoded frame travels as a MUX_CH_LOG payload.
+ */
+#define TELEMETRY_HEADER_SIZE	6U
+#define TELEMETRY_CRC_SIZE		2U
+#define TELEMETRY_MAX_PAYLOAD	64U
+#define TELEMETRY_MAX_FRAME		(TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + TELEMETRY_CRC_SIZE)
+#define TELEMETRY_MAX_ENCODED	(TELEMETRY_MAX_FRAME + TELEMETRY_MAX_FRAME / 254U + 2U) //COBS overhead + delimiter
+
+/*
+ * Temperature batches: payload = period ms (2) | count (1) | count x int16 centi-degrees
+ * 16 samples cost 45 bytes on the wire (~2.8 bytes/sample) against ~29 bytes for one ASCII
+ * sentence, so the same 9600 baud link carries about ten times more samples per second.
+ */
+#define TELEMETRY_TEMP_BATCH		16U
+#define TELEMETRY_ASCII_PERIOD_MS	700U
+#define TELEMETRY_BINARY_PERIOD_MS	70U
+
+typedef enum{
+	TELEMETRY_ASCII,	//"\nSTM32's Temperature: 23.45*C" sentences
+	TELEMETRY_BINARY	//COBS + CRC frames
+}Telemetry_Mode_t;
+
+typedef enum{
+	TELEMETRY_MSG_TEMPERATURE = 0x01,
+	TELEMETRY_MSG_DLOG = 0x02		//Deferred log records, layout in dlog.h
+}Telemetry_MsgType_t;
+
+/*
+ * Function Declarations
+ */
+void telemetryInit(UART_Name_t uartName, Telemetry_Mode_t mode);
+void telemetrySetMode(Telemetry_Mode_t mode);
+Telemetry_Mode_t telemetryMode(void);
+uint32_t telemetryPeriodMs(void);
+
+void telemetryTemperature(float celsius);
+void telemetryFlush(void);
+bool telemetrySendFrame(uint8_t type, uint32_t timestamp, const uint8_t* payload, uint16_t len);
+
+uint16_t crc16Ccitt(const uint8_t* data, uint16_t len, uint16_t crc);
+uint16_t cobsEncode(const uint8_t* in, uint16_t len, uint8_t* out);
+uint16_t cobsDecode(const uint8_t* in, uint16_t len, uint8_t* out);
+
+#endif /* INC_TELEMETRY_H_ */
@@ -39,6 +39,8 @@
 #define TICK_FREQ_1000Hz	1/_1MS_PER_TICK //1ms per period
 #define TICK_FREQ_200Hz		1/_5MS_PER_TICK //5ms per period
 
+#define TICK_TIMER			my_TIM5	//1 kHz system tick; TIM1 is the waveform engine's step clock
+
 
 /*
  * ---------------------------------------------------
@@ -132,8 +134,14 @@ typedef enum{
  */
 void initTimer(TIM_Name_t userTIMx);
 void delay(int msec);
+uint32_t delayBusyCycles(void);
+uint32_t getTick(void);
+
+/* Core clock cycles since cycleCounterInit(), wraps every ~43s at 100MHz */
+#define CYCLE_COUNT()	(*(volatile uint32_t*)DWT_CYCCNT_ADDR)
+void cycleCounterInit(void);
 
-void TIM1_UP_TIM10_IRQHandler();
+void TIM5_IRQHandler();
 
 void writeTimer(uint8_t bitPosition, TIM_Name_t userTIMx, TIM_RegName_t mode, uint32_t value);
 
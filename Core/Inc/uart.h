@@ -9,7 +9,9 @@
 #define INC_UART_H_
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
+#include <stdlib.h>
 #include <math.h>
 
 #include "stm32PeripheralAddr.h"
@@ -19,9 +21,29 @@
 #include "dma.h"
 #include "exti.h"
 #include "led.h"
+#include "fmt.h"
 
 #define UART_CR1_M (1U << 12)	//Wordlength 9Bit
 #define UART_CR1_PCE (1U << 10) //Parity Control Enable
+#define UART_SR_ERROR_MASK	0x0FU	//PE | FE | NE | ORE
+
+#define UART_TX_BUFFER_SIZE	256U	//Per-UART TX ring size, must be a power of 2
+#define UART_RX_BUFFER_SIZE	256U	//Per-UART DMA RX ring size, must be a power of 2
+
+/*
+ * RTS/CTS watermarks. The fill level is sampled every half ring (HT/TC) and at IDLE,
+ * so up to half a ring can land after a check: throttle early enough to absorb it
+ */
+#define UART_RX_HIGH_WATER	(UART_RX_BUFFER_SIZE / 2U - 16U)
+#define UART_RX_LOW_WATER	(UART_RX_BUFFER_SIZE / 4U)
+
+/*
+ * Stream arbitration. A late RX item is an overrun that cannot be undone, a late TX item only
+ * stretches the stop bit. Both stay in direct mode: a byte parked in the RX FIFO would be
+ * invisible to the IDLE handler, and the TX ring hands out byte-aligned slices of any length.
+ */
+#define UART_DMA_RX_PRIORITY	DMA_PRIO_VERY_HIGH
+#define UART_DMA_TX_PRIORITY	DMA_PRIO_MEDIUM
 
 typedef enum{
 	UART_SR,
@@ -36,7 +58,9 @@ typedef enum{
 typedef enum{
 	my_UART1,
 	my_UART2,
-	my_UART6
+	my_UART6,
+
+	UART_COUNT
 }UART_Name_t;
 
 typedef enum{
@@ -50,6 +74,11 @@ typedef enum{
 	_9B_WORDLENGTH
 }UART_WordLength_t;
 
+typedef enum{
+	UART_FLOW_NONE,
+	UART_FLOW_RTS_CTS		//USART1 and USART2 only: USART6 has no CTS/RTS pins
+}UART_FlowControl_t;
+
 typedef enum{
 	UART_OK,
 	UART_NOT_OK,
@@ -62,6 +91,52 @@ typedef enum{
 	OK
 }General_Status_t;
 
+typedef enum{
+	UART_RX_FRAME,			//IDLE closed a frame in the RX ring, len = frame length
+	UART_RX_HALF_COMPLETE,	//Ping: first half of the block buffer is stable, len = half its size
+	UART_RX_BLOCK_COMPLETE	//Pong: second half is stable, so the block buffer is full, len = its size
+}UART_RxEvent_t;
+
+/*
+ * @brief	Per-UART counters since boot or the last uartResetStats()
+ */
+typedef struct{
+	uint32_t bytesIn;
+	uint32_t bytesOut;
+	uint32_t frames;		//IDLE-delimited messages
+	uint32_t parityErrors;
+	uint32_t framingErrors;
+	uint32_t noiseErrors;
+	uint32_t overrunErrors;
+	uint32_t dmaHalf;		//RX stream half transfer events
+	uint32_t dmaFull;		//RX stream transfer complete events
+	uint32_t rxPeak;		//Highest RX ring fill level seen, in bytes
+}UART_Stats_t;
+
+/*
+ * @brief	Read-only view of unread bytes inside the RX ring. Unread data wraps at most once,
+ * 			so uartRxPeek() fills two of these: the run up to the end of the ring, then the rest.
+ */
+typedef struct{
+	const char* data;
+	uint16_t len;			//0 when the span is unused
+}UART_RxSpan_t;
+
+typedef void (*UART_RxCallback_t)(UART_Name_t uartName, UART_RxEvent_t event, uint32_t len);
+typedef void (*UART_TxHook_t)(UART_Name_t uartName, const char* data, uint16_t len);
+
+/*
+ * @brief	Result of the integer BRR solver
+ */
+typedef struct{
+	uint16_t brr;			//Value for UART_BRR (mantissa << 4 | fraction)
+	uint32_t actualBaud;	//Baud rate the divider really produces
+	int32_t errorPpm;		//(actual - requested) / requested, in parts per million
+	bool over8;				//Oversampling by 8 selected
+}UART_Baud_t;
+
+#define UART_BAUD_MAX_ERROR_PPM	20000	//2%: beyond this a 9-bit frame drifts by half a bit
+
 typedef enum{
 	DISABLE_DMA,
 	ENABLE_DMA
@@ -73,22 +148,59 @@ typedef enum{
 UART_Status_t writeUART(uint8_t bitPosition, UART_Name_t uartName, UART_RegName_t regName, uint32_t value);
 int32_t readUART(uint8_t bitPosition, UART_Name_t uartName, UART_RegName_t regName);
 
-void UART_Init(GPIO_Pin_t TXPin,
-			   GPIO_Pin_t RXPin,
-			   GPIO_PortName_t portName,
-			   UART_Name_t uartName,
-			   uint32_t baudRate,
-			   UART_Parity_t parity,
-			   UART_WordLength_t wordLength);
+UART_Status_t UART_Init(GPIO_Pin_t TXPin,
+						GPIO_Pin_t RXPin,
+						GPIO_PortName_t portName,
+						UART_Name_t uartName,
+						uint32_t baudRate,
+						UART_Parity_t parity,
+						UART_WordLength_t wordLength,
+						UART_FlowControl_t flowControl);
+
+uint32_t uartGetClock(UART_Name_t uartName);
+UART_Status_t uartCalcBaud(uint32_t pclk, uint32_t baudRate, bool over8, UART_Baud_t* result);
+UART_Status_t uartResolveBaud(UART_Name_t uartName, uint32_t baudRate, UART_Baud_t* result);
+UART_Status_t uartSetBaudRate(UART_Name_t uartName, uint32_t baudRate, UART_Baud_t* result);
+uint32_t uartGetBaudRate(UART_Name_t uartName);
+void uartTxFlush(UART_Name_t uartName);
+uint16_t uartTxMark(UART_Name_t uartName);
+bool uartTxSent(UART_Name_t uartName, uint16_t mark);
+uint32_t uartTxBlockedCycles(UART_Name_t uartName);
 
 void my_UART_Transmit(UART_Name_t UARTx, uint16_t inputData);
 int32_t my_UART_Receive(UART_Name_t uartName);
 
-void UART1_DMA_Receiver_Init(char *rxBuffer, uint32_t bufferSize);
-void UART1_DMA_Receiver_Start();
+void UART_DMA_Receiver_Init(UART_Name_t uartName, char *rxBuffer, uint32_t bufferSize);
+void UART_DMA_Receiver_Start(UART_Name_t uartName);
+void UART_DMA_Receiver_Stop(UART_Name_t uartName);
+
+void UART_DMA_RxIdle_Init(UART_Name_t uartName);
+uint32_t uartRxDmaRemaining(UART_Name_t uartName);
+uint16_t uartRxIdleIRQHandler(UART_Name_t uartName);
+uint16_t uartRxAvailable(UART_Name_t uartName);
+uint16_t uartRxRead(UART_Name_t uartName, char* out, uint16_t maxLen);
+uint16_t uartRxPeek(UART_Name_t uartName, UART_RxSpan_t span[2]);
+void uartRxConsume(UART_Name_t uartName, uint16_t len);
+void uartRxDiscard(UART_Name_t uartName);
+void uartSetRxCallback(UART_Name_t uartName, UART_RxCallback_t callback);
+void uartSetTxHook(UART_Name_t uartName, UART_TxHook_t hook);
+
+void UART_DMA_Transmitter_Init(UART_Name_t uartName);
+void UART_DMA_Transmitter_Start(UART_Name_t uartName, char* txBuffer, uint32_t bufferSize);
+uint16_t uartWrite(UART_Name_t uartName, const char* data, uint16_t len);
+uint16_t uartTxPending(UART_Name_t uartName);
+void uartTxIRQHandler(UART_Name_t uartName);
+void uartIRQHandler(UART_Name_t uartName);
+void uartErrorIRQHandler(UART_Name_t uartName);
+
+void uartGetStats(UART_Name_t uartName, UART_Stats_t* out);
+void uartResetStats(UART_Name_t uartName);
+uint32_t uartErrorCount(UART_Name_t uartName);
 
-void UART1_DMA_Transmitter_Init(void);
-void UART1_DMA_Transmitter_Start(char* txBuffer, uint32_t bufferSize);
+void uartWriteAll(UART_Name_t uartName, const char* data, uint16_t len);
 void uartPrintLog(UART_Name_t uartName, char* message);
 void uartPrintFloat(UART_Name_t uartName, float val, uint8_t decimals);
+void uartPrintU32(UART_Name_t uartName, uint32_t val);
+void uartPrintI32(UART_Name_t uartName, int32_t val);
+void uartPrintHex(UART_Name_t uartName, uint32_t val, uint8_t digits);
 #endif /* INC_UART_H_ */
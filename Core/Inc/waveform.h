@@ -0,0 +1,74 @@
+/*
+ * waveform.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ */
+
+#ifndef INC_WAVEFORM_H_
+#define INC_WAVEFORM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32PeripheralAddr.h"
+#include "rcc.h"
+#include "timer.h"
+#include "dma.h"
+
+/*
+ * Timer-triggered GPIO waveforms
+ *
+ * 		TIM1 counts microseconds and raises an update DMA request at the end of every step;
+ * 		DMA2 Stream 5 (channel 6, TIM1_UP) then copies the next word of the pattern table into
+ * 		the port's BSRR. A word sets the pins of its low half and resets the pins of its high
+ * 		half, so a pattern only touches the pins it names and a zero word holds every pin.
+ * 		Edges land on the update event, whatever the CPU is doing.
+ *
+ * 		The stream runs circular, so a looping pattern costs no CPU at all. Its TC interrupt
+ * 		(once per pass) counts loops and switches patterns: a replacement or queued pattern
+ * 		always starts on a pass boundary, the pattern playing is never cut off mid-pass. The new
+ * 		step length is preloaded into ARR, so the last step of the old pattern keeps its own.
+ *
+ * 		The first step is output one step after the engine starts from idle.
+ */
+#define WAVE_STREAM			DMA_STREAM(my_DMA2, 5)	//TIM1_UP on channel 6
+#define WAVE_CHANNEL		6U
+#define WAVE_PRIORITY		DMA_PRIO_HIGH		//A late item is a late edge
+#define WAVE_PORT_BSRR		GPIOD_GET_REG(BSRR)	//PD12-PD15: the LEDs
+#define WAVE_TICK_HZ		1000000U	//TIM1 counter clock: stepUs is in counter ticks
+#define WAVE_MIN_STEP_US	20U		//The TC interrupt must restart the stream within one step
+#define WAVE_QUEUE_DEPTH	4U
+
+/* BSRR words */
+#define WAVE_SET(pin)		(1UL << (pin))
+#define WAVE_RESET(pin)		(1UL << ((pin) + 16U))
+#define WAVE_HOLD			0UL
+
+typedef enum{
+	WAVE_OK,
+	WAVE_ERR_PARAM,
+	WAVE_ERR_FULL
+}WAVE_Status_t;
+
+/*
+ * @brief	Must stay valid (and unchanged) while it is playing or queued
+ */
+typedef struct{
+	const uint32_t* steps;	//BSRR words, one per step
+	uint16_t length;		//Steps per pass
+	uint16_t stepUs;		//WAVE_MIN_STEP_US .. 65535
+	uint16_t loops;			//Passes, 0 until replaced or stopped
+}WAVE_Pattern_t;
+
+/*
+ * Function Declarations
+ */
+void waveInit(void);
+WAVE_Status_t wavePlay(const WAVE_Pattern_t* pattern);
+WAVE_Status_t waveQueue(const WAVE_Pattern_t* pattern);
+void waveStop(uint32_t finalBsrr);
+bool waveBusy(void);
+const WAVE_Pattern_t* waveCurrent(void);
+
+#endif /* INC_WAVEFORM_H_ */
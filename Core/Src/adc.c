@@ -201,6 +201,39 @@ float temperatureSensorRead(){
 	return temperature;
 }
 
+/*
+ * @brief	Convert regular channel @p channel back to back and raise a DMA request per result
+ *
+ * 			DMA2 Stream 0 or 4, channel 0 must be set up to read ADC_dataRegAddr() first. DDS keeps
+ * 			the requests coming after the stream's NDTR runs out, so a restarted stream picks up
+ * 			the next result instead of hanging. A result the stream is too late for sets OVR in
+ * 			ADC_SR and stops the requests until the next start.
+ *
+ * @note	The sampling time is whatever SMPRx holds; ADC_temperatureSensorInit() sets 480 cycles
+ * 			for channel 16 (about 50k samples/s at the 25 MHz ADC clock)
+ */
+void ADC_continuousDmaStart(uint8_t channel){
+	writeADC(1, ADC_SR, RESET); //EOC of a result nobody read would overrun at the first conversion
+	writeADC(5, ADC_SR, RESET); //OVR of an earlier run would keep the requests off
+	writeADC(20, ADC_SQR1, 0); //L = 0: one conversion in the regular sequence
+	writeADC(0, ADC_SQR3, channel); //SQ1
+	writeADC(8, ADC_CR2, SET); //DMA
+	writeADC(9, ADC_CR2, SET); //DDS
+	writeADC(1, ADC_CR2, SET); //CONT
+	writeADC(30, ADC_CR2, SET); //SWSTART
+}
+
+void ADC_continuousDmaStop(void){
+	writeADC(1, ADC_CR2, RESET); //The conversion in progress still completes
+	writeADC(9, ADC_CR2, RESET);
+	writeADC(8, ADC_CR2, RESET);
+}
+
+/* @brief	Peripheral address for the stream reading regular results */
+uint32_t ADC_dataRegAddr(void){
+	return (uint32_t)ADCRegLookupTable[ADC_DR];
+}
+
 /*
  * @brief	Write a bit-field to an ADC1 peripheral register
  *
@@ -0,0 +1,252 @@
+/*
+ * autobaud.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Console baud rate detection with TIM4 input capture on the RX pin
+ * 		The receiver is switched off and PB7 handed to TIM4 while a sync character is measured,
+ * 		so nothing of it lands in the RX ring. The capture interrupt only stores the two widths;
+ * 		autobaudPoll() waits until the line has been quiet for a character, gives the pin back to
+ * 		USART1 and programs the rate from thread context.
+ */
+
+#include "autobaud.h"
+#include "log.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+#define CAP_SR_UIF		(1U << 0)
+#define CAP_SR_CC1IF	(1U << 1)
+#define CAP_SR_CC2IF	(1U << 2)
+#define CAP_SR_CC1OF	(1U << 9)
+#define CAP_SR_CC2OF	(1U << 10)
+#define CAP_DIER_CC2IE	(1U << 2)
+
+#define AUTOBAUD_QUIET_MS	12U	//Line quiet time after a rejected character: a 12-bit frame at 1200
+
+/* USART1 on 100 MHz PCLK2 cannot divide down to 1200 (BRR mantissa is 12 bits) */
+static const uint32_t standardRates[] = {
+		2400, 4800, 9600, 14400, 19200, 38400, 57600, 115200, 230400, 460800, 921600
+};
+
+static UART_Name_t abUart = my_UART1;
+static uint32_t abTickHz = AUTOBAUD_TICK_HZ; //Real capture clock after the prescaler rounding
+
+/* Written by TIM4_IRQHandler */
+static volatile Autobaud_State_t abState = AUTOBAUD_OFF;
+static volatile uint8_t abEdges = 0;		//Falling edges since the capture was armed
+static volatile uint32_t abLowTicks = 0;	//Start bit, 0 when the character was rejected
+static volatile uint32_t abHighTicks = 0;	//First data bit
+static volatile uint32_t abLastEdgeTick = 0;
+
+static uint32_t abRate = 0;
+static uint32_t abErrors = 0;	//uartErrorCount() when the new rate was set
+static uint32_t abFrames = 0;	//Frames received when the new rate was set
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+
+/* APB1 timers run at twice PCLK1 whenever the APB1 prescaler divides */
+static uint32_t tim4Clock(void){
+	uint32_t pclk1 = RCC_getPCLK1Freq();
+	return (pclk1 == RCC_getHCLKFreq()) ? pclk1 : 2U * pclk1;
+}
+
+
+/*
+ * @brief	PB7 to TIM4_CH2 and TIM4 into PWM input mode on TI2, reset on every falling edge
+ */
+static void captureArm(void){
+	volatile timerRegOffset_t* tim = TIM4_REG;
+	uint32_t psc = (tim4Clock() + AUTOBAUD_TICK_HZ / 2U) / AUTOBAUD_TICK_HZ;
+	if(psc == 0) psc = 1;
+	abTickHz = tim4Clock() / psc;
+
+	writePin(my_GPIO_PIN_7, my_GPIOB, AFRL, AF2);
+	my_RCC_TIM4_CLK_ENABLE();
+
+	tim -> TIM_CR1 = 0;
+	tim -> TIM_DIER = 0;
+	tim -> TIM_PSC = psc - 1U;
+	tim -> TIM_ARR = 0xFFFFU;
+	tim -> TIM_CCER = 0; //CCxS is only writable while the channel is off
+	tim -> TIM_CCMR1 = (0b10U << 0) | (0b01U << 8); //CC1S: IC1 on TI2 (indirect), CC2S: IC2 on TI2 (direct)
+	tim -> TIM_CCER = (1U << 0) | (1U << 4) | (1U << 5); //CC1E rising, CC2E + CC2P falling
+	tim -> TIM_SMCR = (0b110U << 4) | (0b100U << 0); //TS = TI2FP2, SMS = reset mode
+	tim -> TIM_CR1 = (1U << 2); //URS: only an overflow raises UIF, not the reset trigger
+	tim -> TIM_EGR = 1U; //UG: load the prescaler
+	tim -> TIM_SR = 0;
+
+	abEdges = 0;
+	abLowTicks = 0;
+	abHighTicks = 0;
+	abState = AUTOBAUD_ARMED;
+
+	tim -> TIM_DIER = CAP_DIER_CC2IE;
+	NVIC_enableIRQ(TIM4_user);
+	tim -> TIM_CR1 |= 1U; //CEN
+}
+
+
+static void captureStop(void){
+	volatile timerRegOffset_t* tim = TIM4_REG;
+	tim -> TIM_DIER = 0;
+	tim -> TIM_CR1 = 0;
+	tim -> TIM_CCER = 0;
+	tim -> TIM_SR = 0;
+	writePin(my_GPIO_PIN_7, my_GPIOB, AFRL, AF7); //Back to USART1_RX
+}
+
+
+/*
+ * @return	The standard rate within AUTOBAUD_SNAP_PCT of @p measured, or 0
+ */
+static uint32_t snapRate(uint32_t measured){
+	for(uint8_t i = 0; i < sizeof standardRates / sizeof standardRates[0]; i++){
+		uint32_t rate = standardRates[i];
+		uint32_t diff = (measured > rate) ? measured - rate : rate - measured;
+		if(diff * 100U <= rate * AUTOBAUD_SNAP_PCT) return rate;
+	}
+	return 0;
+}
+
+
+/*
+ * @brief	Line has gone quiet after the sync character: program the rate or try again
+ */
+static void settle(void){
+	uint32_t low = abLowTicks;
+	uint32_t high = abHighTicks;
+	captureStop();
+
+	uint32_t rate = (low == 0) ? 0 : snapRate((uint32_t)((2ULL * abTickHz + (low + high) / 2U) / (low + high)));
+	if(rate != 0) uartTxFlush(abUart); //Queued text leaves at the old rate, the host still listens on it
+	if(rate == 0 || uartSetBaudRate(abUart, rate, NULL) != UART_OK){
+		captureArm(); //Not a sync character, or no usable rate: wait for the next one
+		return;
+	}
+
+	UART_Stats_t stats;
+	uartGetStats(abUart, &stats);
+	abErrors = uartErrorCount(abUart);
+	abFrames = stats.frames;
+	abRate = rate;
+	abState = AUTOBAUD_CONFIRM;
+	uartRxDiscard(abUart); //Whatever arrived at the old rate before the receiver went off
+	writeUART(2, abUart, UART_CR1, SET); //RE
+
+	uartPrintLog(abUart, "--> AUTOBAUD ");
+	uartPrintU32(abUart, rate);
+	uartPrintLog(abUart, "\n");
+	LOG_I(UART, "autobaud: start %u, bit %u ticks at %u Hz -> %u", low, high, abTickHz, rate);
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Stop receiving on @p uartName and wait for a sync character to measure
+ *
+ * @note	Only USART1 is wired to a capture channel (PB7 = TIM4_CH2); the caller must have
+ * 			set the port up with UART_Init() on PB6/PB7
+ */
+void autobaudStart(UART_Name_t uartName){
+	if(uartName != my_UART1){
+		LOG_W(UART, "autobaud: port %u has no capture channel on its RX pin", uartName);
+		return;
+	}
+	abUart = uartName;
+	writeUART(2, abUart, UART_CR1, RESET); //RE off: the sync character never reaches the ring
+	captureArm();
+}
+
+
+
+/*
+ * @brief	Thread-context half of the detection. Call from the main loop
+ */
+void autobaudPoll(void){
+	if(abState == AUTOBAUD_SETTLE){
+		uint32_t quietMs = AUTOBAUD_QUIET_MS;
+		if(abLowTicks != 0){
+			quietMs = (uint32_t)((12000ULL * abLowTicks) / abTickHz) + 1U; //One 12-bit character at the measured width
+		}
+		if((getTick() - abLastEdgeTick) <= quietMs) return;
+		settle();
+		return;
+	}
+
+	if(abState == AUTOBAUD_CONFIRM){
+		UART_Stats_t stats;
+		uartGetStats(abUart, &stats);
+
+		if(uartErrorCount(abUart) != abErrors){
+			LOG_W(UART, "autobaud: line errors at %u, detecting again", abRate);
+			autobaudStart(abUart); //Host is elsewhere: measure again
+		}
+		else if(stats.frames != abFrames){
+			abState = AUTOBAUD_LOCKED;
+			uartPrintLog(abUart, "--> BAUD LOCKED\n");
+		}
+	}
+}
+
+
+
+Autobaud_State_t autobaudState(void){
+	return abState;
+}
+
+
+
+/* @brief	Rate set by the last detection, 0 before the first */
+uint32_t autobaudLastRate(void){
+	return abRate;
+}
+
+
+
+/*
+ * @brief	TIM4 capture: every falling edge on PB7. The first one after arming is the start bit's
+ * 			leading edge; the second closes start bit + first data bit. Later edges only keep the
+ * 			quiet-line timer of autobaudPoll() running.
+ */
+void TIM4_IRQHandler(void){
+	volatile timerRegOffset_t* tim = TIM4_REG;
+	uint32_t sr = tim -> TIM_SR;
+	if((sr & CAP_SR_CC2IF) == 0) return;
+
+	uint32_t low = tim -> TIM_CCR1 & 0xFFFFU; //Counter value at the rising edge
+	uint32_t period = tim -> TIM_CCR2 & 0xFFFFU; //Reading CCR2 clears CC2IF
+	tim -> TIM_SR = ~(CAP_SR_UIF | CAP_SR_CC1IF | CAP_SR_CC2IF | CAP_SR_CC1OF | CAP_SR_CC2OF); //rc_w0
+	abLastEdgeTick = getTick();
+
+	if(abState != AUTOBAUD_ARMED) return;
+	if(abEdges++ == 0) return; //Leading edge of the start bit: the counter starts here
+
+	/* No rising edge in between, a missed edge, or a bit longer than the counter */
+	bool valid = (sr & CAP_SR_CC1IF) && !(sr & (CAP_SR_CC1OF | CAP_SR_CC2OF | CAP_SR_UIF)) && period > low;
+	uint32_t high = period - low;
+
+	if(valid){
+		uint32_t diff = (low > high) ? low - high : high - low;
+		valid = diff * 100U <= low * AUTOBAUD_MATCH_PCT;
+	}
+	abLowTicks = valid ? low : 0;
+	abHighTicks = valid ? high : 0;
+	abState = AUTOBAUD_SETTLE;
+}
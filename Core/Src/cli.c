@@ -0,0 +1,390 @@
+/*
+ * cli.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Table-driven command dispatcher
+ * 		The USART ISR only moves bytes (DMA + IDLE). cliPoll() runs in thread context,
+ * 		assembles lines and dispatches them through a hash table of registered commands.
+ *
+ * 		Lookup hashes the line once (FNV-1a) and probes the table at every word boundary,
+ * 		so the cost depends on the line length only, not on how many commands are registered.
+ *
+ * 		Built-in "Baud <rate>" switches the console rate with a handshake:
+ * 			1. Reply (at the old rate) with the rate the divider really achieves and its error
+ * 			2. Drain TX, reprogram BRR
+ * 			3. Host reopens its port and sends "Baud ok" at the new rate within CLI_BAUD_CONFIRM_MS,
+ * 			   otherwise the old rate is restored so a failed switch never locks the console out
+ */
+
+#include "cli.h"
+#include "cliTrace.h"
+#include "log.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+#define FNV_OFFSET_BASIS	2166136261U
+#define FNV_PRIME			16777619U
+
+typedef struct{
+	const CLI_Command_t* command;	//NULL: free slot
+	uint32_t hash;
+	uint8_t nameLen;
+}cliSlot_t;
+
+static cliSlot_t cliTable[CLI_HASH_SLOTS];
+static uint8_t cliCount = 0;
+static UART_Name_t cliUart = my_UART1;
+
+static char cliLine[CLI_LINE_SIZE];
+static uint16_t cliLineLen = 0;
+static bool cliLineOverflow = false;
+static bool cliUartInput = true;	//false: lines arrive through cliExecute() only
+
+static bool baudPending = false;	//Switched, waiting for "Baud ok"
+static uint32_t baudPrevious = 0;
+static uint32_t baudSwitchTick = 0;
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+static inline uint32_t fnvStep(uint32_t hash, char c){
+	return (hash ^ (uint8_t)c) * FNV_PRIME;
+}
+
+
+/*
+ * @brief	Linear probe for a name of @p len characters whose hash is @p hash
+ *
+ * @return	Matching slot or NULL
+ */
+static const cliSlot_t* cliFind(const char* name, uint8_t len, uint32_t hash){
+	for(uint32_t n = 0; n < CLI_HASH_SLOTS; n++){
+		const cliSlot_t* slot = &cliTable[(hash + n) & (CLI_HASH_SLOTS - 1U)];
+
+		if(slot -> command == NULL) return NULL; //End of probe chain
+		if(slot -> hash == hash && slot -> nameLen == len &&
+		   strncmp(slot -> command -> name, name, len) == 0){
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+
+static inline char* skipSpaces(char* text){
+	while(*text == ' ') text++;
+	return text;
+}
+
+
+/*
+ * @brief	Resolve one complete line to a command, parse its arguments and run the handler
+ */
+static void cliDispatch(char* line){
+	line = skipSpaces(line);
+	if(*line == '\0') return; //Empty line
+
+	/* Longest registered name that ends on a word boundary */
+	const cliSlot_t* best = NULL;
+	uint16_t bestLen = 0;
+	uint32_t hash = FNV_OFFSET_BASIS;
+
+	for(uint16_t i = 0; ; i++){
+		char c = line[i];
+		if(c == ' ' || c == '\0'){
+			const cliSlot_t* slot = cliFind(line, (uint8_t)i, hash);
+			if(slot != NULL){
+				best = slot;
+				bestLen = i;
+			}
+		}
+		if(c == '\0') break;
+		hash = fnvStep(hash, c);
+	}
+
+	if(best == NULL){
+		uartPrintLog(cliUart, "--> COMMAND NOT FOUND\n");
+		return;
+	}
+
+	CLI_Args_t args;
+	memset(&args, 0, sizeof args);
+
+	CLI_ArgParser_t parser = (best -> command -> parser != NULL) ? best -> command -> parser : cliParseNone;
+	if(parser(skipSpaces(line + bestLen), &args) != CLI_OK){
+		uartPrintLog(cliUart, "--> INVALID ARGUMENTS\n");
+		return;
+	}
+
+	cliTraceDispatch(best -> command);
+	best -> command -> handler(&args);
+	cliTraceHandlerDone();
+}
+
+
+/*
+ * @brief	Decimal string to unsigned integer
+ *
+ * @return	false when @p text is empty, has a non-digit or does not fit in 32 bits
+ */
+static bool parseU32(const char* text, uint32_t* out){
+	if(*text == '\0') return false;
+
+	uint32_t value = 0;
+	for(; *text != '\0'; text++){
+		if(*text < '0' || *text > '9') return false;
+		uint32_t digit = (uint32_t)(*text - '0');
+		if(value > (0xFFFFFFFFU - digit) / 10U) return false; //Overflow
+		value = value * 10U + digit;
+	}
+	*out = value;
+	return true;
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Argument Parsers
+ * ----------------------------------------------------------------------
+ */
+
+/* @brief	Command takes no arguments */
+CLI_Status_t cliParseNone(char* argText, CLI_Args_t* args){
+	(void)args;
+	return (*argText == '\0') ? CLI_OK : CLI_BAD_ARGS;
+}
+
+
+/* @brief	Split the argument text on spaces into argv[] (modifies the line in place) */
+CLI_Status_t cliParseWords(char* argText, CLI_Args_t* args){
+	args -> argc = 0;
+	char* p = skipSpaces(argText);
+
+	while(*p != '\0'){
+		if(args -> argc == CLI_MAX_ARGS) return CLI_BAD_ARGS;
+		args -> argv[args -> argc++] = p;
+
+		while(*p != '\0' && *p != ' ') p++;
+		if(*p == ' ') *p++ = '\0';
+		p = skipSpaces(p);
+	}
+	return CLI_OK;
+}
+
+
+/* @brief	One or more unsigned decimal arguments, converted into value[] */
+CLI_Status_t cliParseU32(char* argText, CLI_Args_t* args){
+	if(cliParseWords(argText, args) != CLI_OK || args -> argc == 0) return CLI_BAD_ARGS;
+
+	for(uint8_t i = 0; i < args -> argc; i++){
+		if(!parseU32(args -> argv[i], &args -> value[i])) return CLI_BAD_ARGS;
+	}
+	return CLI_OK;
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Built-in Commands
+ * ----------------------------------------------------------------------
+ */
+static void cmdBaud(const CLI_Args_t* args){
+	UART_Baud_t baud;
+	uint32_t previous = baudPending ? baudPrevious : uartGetBaudRate(cliUart);
+	char errText[FMT_BUF_SIZE];
+
+	if(args -> argc != 1){
+		uartPrintLog(cliUart, "--> INVALID ARGUMENTS\n");
+		return;
+	}
+
+	if(uartResolveBaud(cliUart, args -> value[0], &baud) != UART_OK){
+		uartPrintLog(cliUart, "--> BAUD NOT SUPPORTED\n");
+		return;
+	}
+
+	fmtFixed(errText, baud.errorPpm / 100, 2); //ppm -> hundredths of a percent
+
+	/* Still at the rate the host listens on */
+	uartPrintLog(cliUart, "--> BAUD ");
+	uartPrintU32(cliUart, baud.actualBaud);
+	uartPrintLog(cliUart, (baud.errorPpm >= 0) ? " ERR +" : " ERR ");
+	uartPrintLog(cliUart, errText);
+	uartPrintLog(cliUart, "%\n");
+	uartTxFlush(cliUart);
+
+	(void)uartSetBaudRate(cliUart, args -> value[0], NULL);
+	baudPrevious = previous;
+	baudSwitchTick = getTick();
+	baudPending = true;
+}
+
+
+static void cmdBaudOk(const CLI_Args_t* args){
+	(void)args;
+	if(!baudPending) return;
+	baudPending = false;
+	uartPrintLog(cliUart, "--> BAUD LOCKED\n");
+}
+
+
+static const CLI_Command_t builtinCommands[] = {
+	{"Baud",	cmdBaud,	cliParseU32},
+	{"Baud ok",	cmdBaudOk,	NULL},
+};
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Select the UART the console reads lines from and replies on
+ */
+void cliInit(UART_Name_t uartName){
+	cliUart = uartName;
+	cliLineLen = 0;
+	cliLineOverflow = false;
+	baudPending = false;
+
+	for(uint32_t i = 0; i < sizeof(builtinCommands) / sizeof(builtinCommands[0]); i++){
+		(void)cliRegister(&builtinCommands[i]);
+	}
+}
+
+
+
+/*
+ * @brief	Add a command to the registry
+ *
+ * @return	CLI_OK, CLI_FULL when the registry is at capacity, CLI_DUPLICATE when the name exists
+ */
+CLI_Status_t cliRegister(const CLI_Command_t* command){
+	if(command == NULL || command -> name == NULL || command -> handler == NULL) return CLI_BAD_ARGS;
+	if(cliCount >= CLI_MAX_COMMANDS) return CLI_FULL;
+
+	uint32_t hash = FNV_OFFSET_BASIS;
+	uint8_t len = 0;
+	for(const char* c = command -> name; *c != '\0'; c++, len++){
+		hash = fnvStep(hash, *c);
+	}
+
+	if(cliFind(command -> name, len, hash) != NULL) return CLI_DUPLICATE;
+
+	for(uint32_t n = 0; n < CLI_HASH_SLOTS; n++){
+		cliSlot_t* slot = &cliTable[(hash + n) & (CLI_HASH_SLOTS - 1U)];
+		if(slot -> command == NULL){
+			slot -> command = command;
+			slot -> hash = hash;
+			slot -> nameLen = len;
+			cliCount++;
+			return CLI_OK;
+		}
+	}
+	return CLI_FULL;
+}
+
+
+
+/*
+ * @brief	Stop or resume reading command lines from the console UART, e.g. while another
+ * 			protocol owns its RX ring. Replies always go to the console UART
+ */
+void cliSetUartInput(bool enable){
+	cliUartInput = enable;
+	cliLineLen = 0;
+	cliLineOverflow = false;
+}
+
+
+
+/*
+ * @brief	Run one command line that arrived some other way than the console's RX ring
+ *
+ * @param	text	Not zero-terminated; a trailing CR/LF is ignored
+ */
+void cliExecute(const char* text, uint16_t len){
+	char line[CLI_LINE_SIZE];
+
+	while(len > 0 && (text[len - 1U] == '\n' || text[len - 1U] == '\r')) len--;
+	if(len >= CLI_LINE_SIZE){
+		uartPrintLog(cliUart, "--> COMMAND NOT FOUND\n"); //Longer than any command
+		return;
+	}
+
+	memcpy(line, text, len);
+	line[len] = '\0';
+	cliTraceLineEnd();
+	cliDispatch(line);
+}
+
+
+
+/*
+ * @brief	Drain the console's RX ring, assemble lines and dispatch every complete one
+ *
+ * @note	Thread context only: handlers may print and take as long as they need
+ * 			without holding up the UART interrupt
+ */
+void cliPoll(void){
+	UART_RxSpan_t span[2];
+
+	/* No confirmation at the new rate: fall back before the host gives up on us */
+	if(baudPending && (getTick() - baudSwitchTick) > CLI_BAUD_CONFIRM_MS){
+		baudPending = false;
+		uartTxFlush(cliUart);
+		(void)uartSetBaudRate(cliUart, baudPrevious, NULL);
+		cliLineLen = 0; //Whatever arrived at the wrong rate is garbage
+		cliLineOverflow = false;
+		uartPrintLog(cliUart, "--> BAUD REVERTED\n");
+		LOG_W(CLI, "baud change not confirmed, back to %u", baudPrevious);
+	}
+
+	/* Lines are assembled straight out of the RX ring; a line is released before dispatch */
+	while(cliUartInput && uartRxPeek(cliUart, span) > 0){
+		uint16_t used = 0;
+		char c;
+
+		do{
+			c = span[0].data[used++];
+
+			if(c == '\n' || c == '\r'){
+				continue;
+			}
+			else if(cliLineLen < CLI_LINE_SIZE - 1U){
+				cliLine[cliLineLen++] = c;
+			}
+			else{
+				cliLineOverflow = true; //Keep discarding until the end of the line
+			}
+		}while(c != '\n' && used < span[0].len);
+
+		uartRxConsume(cliUart, used);
+		if(c != '\n') continue;
+		cliTraceLineEnd();
+
+		if(cliLineOverflow){
+			uartPrintLog(cliUart, "--> COMMAND NOT FOUND\n"); //Longer than any command
+		}
+		else{
+			cliLine[cliLineLen] = '\0';
+			cliDispatch(cliLine);
+		}
+		cliLineLen = 0;
+		cliLineOverflow = false;
+	}
+}
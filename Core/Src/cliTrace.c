@@ -0,0 +1,303 @@
+/*
+ * cliTrace.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Console round-trip latency tracer
+ * 		One command is traced at a time: the RX frame interrupt dates the first byte, cli.c
+ * 		reports the end of line, the dispatch and the handler return, and cliTracePoll()
+ * 		watches the TX ring until the reply has left the shift register. Lines that complete
+ * 		while a reply is still draining are counted as skipped, not traced.
+ *
+ * 		Stamps are raw CYCLE_COUNT() values, so a round trip must stay below one counter
+ * 		wrap (~43 s at 100 MHz). Results are folded into microseconds per command.
+ */
+
+#include "cliTrace.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+typedef enum{
+	TRACE_IDLE,		//Nothing in flight
+	TRACE_LINE,		//End of line seen, waiting for the dispatch
+	TRACE_RUN,		//Handler running
+	TRACE_REPLY,	//Handler returned, reply not yet marked in the TX ring
+	TRACE_DRAIN		//Waiting for the marked reply to leave the shift register
+}cliTraceState_t;
+
+typedef struct{
+	uint32_t firstByte;
+	uint32_t idle;
+	uint32_t lineEnd;
+	uint32_t dispatch;
+	uint32_t handlerDone;
+	uint32_t delay0;		//delayBusyCycles() at the first frame
+	uint32_t txBlocked0;	//uartTxBlockedCycles() at the first frame
+}cliTraceStamps_t;
+
+static UART_Name_t traceUart = my_UART1;
+static uint32_t cyclesPerUs = 100U;
+
+/* Written by the RX frame interrupt: the line being received */
+static volatile bool rxLineOpen = false;
+static volatile cliTraceStamps_t rxStamps;
+
+/* Thread context: the command in flight */
+static cliTraceState_t traceState = TRACE_IDLE;
+static cliTraceStamps_t traceStamps;
+static const CLI_Command_t* traceCommand = NULL;
+static uint16_t traceMark = 0;
+
+static CLI_TraceEntry_t traceEntries[CLI_MAX_COMMANDS];
+static uint32_t traceSkipped = 0;
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+static inline uint32_t toUs(uint32_t cycles){
+	return cycles / cyclesPerUs;
+}
+
+
+/*
+ * @brief	Core cycles one character takes on the wire at the current BRR and frame format
+ */
+static uint32_t charCycles(void){
+	uint32_t baud = uartGetBaudRate(traceUart);
+	if(baud == 0) return 0;
+
+	uint32_t bits = 1U + ((readUART(12, traceUart, UART_CR1) & 1) ? 9U : 8U); //Start + data (parity included)
+	bits += ((readUART(13, traceUart, UART_CR2) & 1) != 0) ? 2U : 1U; //STOP[1]: 1.5 or 2 stop bits, counted as 2
+	return (uint32_t)(((uint64_t)RCC_getHCLKFreq() * bits) / baud);
+}
+
+
+static uint8_t histBucket(uint32_t us){
+	uint32_t ms = us / 1000U;
+	uint8_t bucket = 0;
+
+	while(ms != 0 && bucket < CLI_TRACE_BUCKETS - 1U){
+		ms >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+
+static CLI_TraceEntry_t* entryFor(const CLI_Command_t* command){
+	for(uint8_t i = 0; i < CLI_MAX_COMMANDS; i++){
+		CLI_TraceEntry_t* entry = &traceEntries[i];
+		if(entry -> command == command) return entry;
+		if(entry -> command == NULL){
+			entry -> command = command;
+			return entry;
+		}
+	}
+	return NULL; //More commands than the registry holds: cannot happen
+}
+
+
+/*
+ * @brief	Fold the finished round trip into its command's entry
+ */
+static void traceComplete(uint32_t now){
+	CLI_TraceEntry_t* entry = entryFor(traceCommand);
+	traceState = TRACE_IDLE;
+	if(entry == NULL) return;
+
+	const cliTraceStamps_t* t = &traceStamps;
+	uint32_t stage[CLI_TRACE_STAGES] = {
+		[CLI_TRACE_WIRE]	= toUs(t -> idle - t -> firstByte),
+		[CLI_TRACE_POLL]	= toUs(t -> lineEnd - t -> idle),
+		[CLI_TRACE_LOOKUP]	= toUs(t -> dispatch - t -> lineEnd),
+		[CLI_TRACE_RUN]		= toUs(t -> handlerDone - t -> dispatch),
+		[CLI_TRACE_DRAIN]	= toUs(now - t -> handlerDone),
+	};
+	uint32_t totalUs = toUs(now - t -> firstByte);
+
+	entry -> count++;
+	for(uint8_t i = 0; i < CLI_TRACE_STAGES; i++){
+		entry -> stageUs[i] += stage[i];
+	}
+	if(totalUs > entry -> maxUs) entry -> maxUs = totalUs;
+	entry -> delayUs += toUs(delayBusyCycles() - t -> delay0);
+	entry -> txBlockedUs += toUs(uartTxBlockedCycles(traceUart) - t -> txBlocked0);
+	entry -> hist[histBucket(totalUs)]++;
+}
+
+
+static void printField(UART_Name_t uartName, const char* label, uint32_t value){
+	uartPrintLog(uartName, (char*)label);
+	uartPrintU32(uartName, value);
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Trace the console on @p uartName. Call after RCC_init() and cycleCounterInit()
+ */
+void cliTraceInit(UART_Name_t uartName){
+	traceUart = uartName;
+	cyclesPerUs = RCC_getHCLKFreq() / 1000000U;
+	if(cyclesPerUs == 0) cyclesPerUs = 1;
+	rxLineOpen = false;
+	traceState = TRACE_IDLE;
+	cliTraceReset();
+}
+
+
+
+void cliTraceReset(void){
+	memset(traceEntries, 0, sizeof traceEntries);
+	traceSkipped = 0;
+}
+
+
+
+/*
+ * @brief	An IDLE-delimited frame of @p len bytes arrived on the console. Call from the
+ * 			UART_RX_FRAME event; the first frame of a line dates its first byte
+ */
+void cliTraceRxFrame(uint32_t len){
+	uint32_t now = CYCLE_COUNT();
+
+	rxStamps.idle = now;
+	if(rxLineOpen) return;
+
+	rxStamps.firstByte = now - (len + 1U) * charCycles(); //IDLE fires one character after the last stop bit
+	rxStamps.delay0 = delayBusyCycles();
+	rxStamps.txBlocked0 = uartTxBlockedCycles(traceUart);
+	rxLineOpen = true;
+}
+
+
+
+/*
+ * @brief	cli.c found the end of a line (or got one through cliExecute())
+ */
+void cliTraceLineEnd(void){
+	uint32_t now = CYCLE_COUNT();
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	bool open = rxLineOpen;
+	cliTraceStamps_t rx = {rxStamps.firstByte, rxStamps.idle, 0, 0, 0, rxStamps.delay0, rxStamps.txBlocked0};
+	rxLineOpen = false;
+	__set_PRIMASK(primask);
+
+	if(traceState >= TRACE_RUN){
+		traceSkipped++; //Still busy with the previous command
+		return;
+	}
+
+	if(open){
+		traceStamps = rx;
+	}
+	else{
+		/* More than one line in the same frame: the rest of them arrived with the first */
+		traceStamps.firstByte = rx.idle;
+		traceStamps.idle = rx.idle;
+		traceStamps.delay0 = delayBusyCycles();
+		traceStamps.txBlocked0 = uartTxBlockedCycles(traceUart);
+	}
+	traceStamps.lineEnd = now;
+	traceState = TRACE_LINE; //A line that never dispatches is dropped by the next one
+}
+
+
+
+void cliTraceDispatch(const CLI_Command_t* command){
+	if(traceState != TRACE_LINE) return;
+	traceCommand = command;
+	traceStamps.dispatch = CYCLE_COUNT();
+	traceState = TRACE_RUN;
+}
+
+
+
+void cliTraceHandlerDone(void){
+	if(traceState != TRACE_RUN) return;
+	traceStamps.handlerDone = CYCLE_COUNT();
+	traceState = TRACE_REPLY;
+}
+
+
+
+/*
+ * @brief	Watch the reply leave. Call from the main loop after muxPoll(), so a reply that went
+ * 			through the mux is already in the TX ring when it is marked
+ */
+void cliTracePoll(void){
+	if(traceState == TRACE_REPLY){
+		traceMark = uartTxMark(traceUart);
+		traceState = TRACE_DRAIN;
+	}
+	if(traceState == TRACE_DRAIN && uartTxSent(traceUart, traceMark)){
+		traceComplete(CYCLE_COUNT());
+	}
+}
+
+
+
+/*
+ * @brief	Entry @p index (0 .. CLI_MAX_COMMANDS - 1) or NULL past the last traced command
+ */
+const CLI_TraceEntry_t* cliTraceEntry(uint8_t index){
+	if(index >= CLI_MAX_COMMANDS || traceEntries[index].command == NULL) return NULL;
+	return &traceEntries[index];
+}
+
+
+
+uint32_t cliTraceSkipped(void){
+	return traceSkipped;
+}
+
+
+
+/*
+ * @brief	One line of stage averages per traced command, then its histogram in ms buckets
+ */
+void cliTracePrint(UART_Name_t uartName){
+	static const char* const stageLabel[CLI_TRACE_STAGES] = {" WIRE ", " POLL ", " LOOKUP ", " RUN ", " DRAIN "};
+
+	for(uint8_t i = 0; i < CLI_MAX_COMMANDS; i++){
+		const CLI_TraceEntry_t* entry = cliTraceEntry(i);
+		if(entry == NULL) break;
+
+		uartPrintLog(uartName, "--> ");
+		uartPrintLog(uartName, (char*)entry -> command -> name);
+		printField(uartName, " N ", entry -> count);
+		for(uint8_t s = 0; s < CLI_TRACE_STAGES; s++){
+			printField(uartName, stageLabel[s], entry -> stageUs[s] / entry -> count);
+		}
+		printField(uartName, " MAX ", entry -> maxUs);
+		printField(uartName, " DELAY ", entry -> delayUs / entry -> count);
+		printField(uartName, " TXWAIT ", entry -> txBlockedUs / entry -> count);
+		uartPrintLog(uartName, " US\n--> MS");
+
+		for(uint8_t b = 0; b < CLI_TRACE_BUCKETS; b++){
+			if(entry -> hist[b] == 0) continue;
+			if(b == CLI_TRACE_BUCKETS - 1U) printField(uartName, " >=", 1U << (b - 1U));
+			else printField(uartName, " <", 1U << b);
+			printField(uartName, ":", entry -> hist[b]);
+		}
+		uartPrintLog(uartName, "\n");
+	}
+	printField(uartName, "--> SKIPPED ", traceSkipped);
+	uartPrintLog(uartName, "\n");
+}
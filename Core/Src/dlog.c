@@ -0,0 +1,137 @@
+/*
+ * dlog.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Deferred logging back end (front end and record layout in dlog.h)
+ * 		Log sites only copy words into a ring with interrupts masked for a few cycles,
+ * 		from thread or interrupt context alike. dlogPoll() packs whole records into
+ * 		telemetry frames in thread context, where the link speed is somebody else's problem.
+ */
+
+#include "dlog.h"
+#include "telemetry.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * Each record is a header word (id | count << 16), the timestamp, then its arguments.
+ * head/tail run freely and count words; a record is written whole or not at all.
+ */
+static uint32_t dlogRing[DLOG_RING_WORDS];
+static volatile uint16_t dlogHead = 0;
+static volatile uint16_t dlogTail = 0;
+static volatile uint32_t dlogLost = 0;
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+static inline uint32_t ringWord(uint16_t index){
+	return dlogRing[index & (DLOG_RING_WORDS - 1U)];
+}
+
+static inline void putU16(uint8_t* out, uint16_t value){
+	out[0] = (uint8_t)value;
+	out[1] = (uint8_t)(value >> 8);
+}
+
+static inline void putU32(uint8_t* out, uint32_t value){
+	putU16(out, (uint16_t)value);
+	putU16(out + 2, (uint16_t)(value >> 16));
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Queue one record. Called by DLOG(), safe from any context
+ *
+ * 			When the ring is full the record is dropped and counted, the caller never waits.
+ */
+void dlogWrite(uint16_t id, uint8_t argCount, const uint32_t* args){
+	uint32_t now = getTick();
+	uint16_t words = 2U + argCount;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint16_t head = dlogHead;
+	if((uint16_t)(DLOG_RING_WORDS - (uint16_t)(head - dlogTail)) < words){
+		dlogLost++;
+		__set_PRIMASK(primask);
+		return;
+	}
+
+	dlogRing[head++ & (DLOG_RING_WORDS - 1U)] = (uint32_t)id | ((uint32_t)argCount << 16);
+	dlogRing[head++ & (DLOG_RING_WORDS - 1U)] = now;
+	for(uint8_t i = 0; i < argCount; i++){
+		dlogRing[head++ & (DLOG_RING_WORDS - 1U)] = args[i];
+	}
+	dlogHead = head;
+
+	__set_PRIMASK(primask);
+}
+
+
+
+/*
+ * @brief	Send queued records, as many per TELEMETRY_MSG_DLOG frame as fit
+ *
+ * 			Records only leave while the link carries frames (binary telemetry or the mux);
+ * 			in ASCII mode they wait in the ring, and the oldest are kept when it fills.
+ *
+ * @note	Thread context, call from the main loop
+ */
+void dlogPoll(void){
+	if(telemetryMode() != TELEMETRY_BINARY && !muxActive()) return;
+
+	uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+
+	while(dlogTail != dlogHead){
+		uint16_t len = 0;
+		uint16_t tail = dlogTail;
+
+		/* Whole records only: the host decodes each frame on its own */
+		while(tail != dlogHead){
+			uint32_t header = ringWord(tail);
+			uint8_t argCount = (uint8_t)(header >> 16);
+			uint16_t recordLen = DLOG_RECORD_HEADER + 4U * argCount;
+			if(len + recordLen > TELEMETRY_MAX_PAYLOAD) break;
+
+			putU16(&payload[len], (uint16_t)header);
+			payload[len + 2] = argCount;
+			putU32(&payload[len + 3], ringWord(tail + 1U));
+			for(uint8_t i = 0; i < argCount; i++){
+				putU32(&payload[len + DLOG_RECORD_HEADER + 4U * i], ringWord(tail + 2U + i));
+			}
+			len += recordLen;
+			tail += 2U + argCount;
+		}
+
+		if(!telemetrySendFrame(TELEMETRY_MSG_DLOG, getTick(), payload, len)) return; //Mux log queue full: retry next pass
+		dlogTail = tail;
+	}
+}
+
+
+
+/*
+ * @brief	Records dropped because the ring was full
+ */
+uint32_t dlogDropped(void){
+	return dlogLost;
+}
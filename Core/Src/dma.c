@@ -5,143 +5,62 @@
  *  Updated on: Jul 23, 2025
  *  	Bug fixed
  *  	More efficient execution
+ *  Updated on: Oct 18, 2026
+ *  	Stream handles for all 16 streams of DMA1 and DMA2
+ *  	Transfer tracing hooks (dmaTrace.c)
  *      Author: dobao
  */
 
 #include "dma.h"
+#include "dmaTrace.h"
 /*
  * ----------------------------------------------------------------------
  * Private Helpers
  * ----------------------------------------------------------------------
  */
-static volatile uint32_t* const dma2RegLookupTable[DMA_REG_COUNT] = {
-		[DMA_LISR] 	= DMA2_GET_REG(DMA_LISR),
-		[DMA_HISR] 	= DMA2_GET_REG(DMA_HISR),
-		[DMA_LIFCR] = DMA2_GET_REG(DMA_LIFCR),
-		[DMA_HIFCR] = DMA2_GET_REG(DMA_HIFCR),
-
-		[DMA_S0CR] 		= DMA2_GET_REG(DMA_S0CR),
-		[DMA_S0NDTR] 	= DMA2_GET_REG(DMA_S0NDTR),
-		[DMA_S0PAR] 	= DMA2_GET_REG(DMA_S0PAR),
-		[DMA_S0M0AR] 	= DMA2_GET_REG(DMA_S0M0AR),
-		[DMA_S0M1AR] 	= DMA2_GET_REG(DMA_S0M1AR),
-		[DMA_S0FCR] 	= DMA2_GET_REG(DMA_S0FCR),
-
-		[DMA_S1CR] 		= DMA2_GET_REG(DMA_S1CR),
-		[DMA_S1NDTR] 	= DMA2_GET_REG(DMA_S1NDTR),
-		[DMA_S1PAR] 	= DMA2_GET_REG(DMA_S1PAR),
-		[DMA_S1M0AR] 	= DMA2_GET_REG(DMA_S1M0AR),
-		[DMA_S1M1AR] 	= DMA2_GET_REG(DMA_S1M1AR),
-		[DMA_S1FCR] 	= DMA2_GET_REG(DMA_S1FCR),
-
-		[DMA_S2CR] 		= DMA2_GET_REG(DMA_S2CR),
-		[DMA_S2NDTR] 	= DMA2_GET_REG(DMA_S2NDTR),
-		[DMA_S2PAR] 	= DMA2_GET_REG(DMA_S2PAR),
-		[DMA_S2M0AR] 	= DMA2_GET_REG(DMA_S2M0AR),
-		[DMA_S2M1AR] 	= DMA2_GET_REG(DMA_S2M1AR),
-		[DMA_S2FCR] 	= DMA2_GET_REG(DMA_S2FCR),
-
-		[DMA_S3CR] 		= DMA2_GET_REG(DMA_S3CR),
-		[DMA_S3NDTR] 	= DMA2_GET_REG(DMA_S3NDTR),
-		[DMA_S3PAR] 	= DMA2_GET_REG(DMA_S3PAR),
-		[DMA_S3M0AR] 	= DMA2_GET_REG(DMA_S3M0AR),
-		[DMA_S3M1AR] 	= DMA2_GET_REG(DMA_S3M1AR),
-		[DMA_S3FCR] 	= DMA2_GET_REG(DMA_S3FCR),
-
-		[DMA_S4CR] 		= DMA2_GET_REG(DMA_S4CR),
-		[DMA_S4NDTR] 	= DMA2_GET_REG(DMA_S4NDTR),
-		[DMA_S4PAR] 	= DMA2_GET_REG(DMA_S4PAR),
-		[DMA_S4M0AR] 	= DMA2_GET_REG(DMA_S4M0AR),
-		[DMA_S4M1AR] 	= DMA2_GET_REG(DMA_S4M1AR),
-		[DMA_S4FCR] 	= DMA2_GET_REG(DMA_S4FCR),
-
-		[DMA_S5CR] 		= DMA2_GET_REG(DMA_S5CR),
-		[DMA_S5NDTR] 	= DMA2_GET_REG(DMA_S5NDTR),
-		[DMA_S5PAR] 	= DMA2_GET_REG(DMA_S5PAR),
-		[DMA_S5M0AR] 	= DMA2_GET_REG(DMA_S5M0AR),
-		[DMA_S5M1AR] 	= DMA2_GET_REG(DMA_S5M1AR),
-		[DMA_S5FCR] 	= DMA2_GET_REG(DMA_S5FCR),
-
-		[DMA_S6CR] 		= DMA2_GET_REG(DMA_S6CR),
-		[DMA_S6NDTR] 	= DMA2_GET_REG(DMA_S6NDTR),
-		[DMA_S6PAR] 	= DMA2_GET_REG(DMA_S6PAR),
-		[DMA_S6M0AR] 	= DMA2_GET_REG(DMA_S6M0AR),
-		[DMA_S6M1AR] 	= DMA2_GET_REG(DMA_S6M1AR),
-		[DMA_S6FCR] 	= DMA2_GET_REG(DMA_S6FCR),
-
-		[DMA_S7CR] 		= DMA2_GET_REG(DMA_S7CR),
-		[DMA_S7NDTR] 	= DMA2_GET_REG(DMA_S7NDTR),
-		[DMA_S7PAR] 	= DMA2_GET_REG(DMA_S7PAR),
-		[DMA_S7M0AR] 	= DMA2_GET_REG(DMA_S7M0AR),
-		[DMA_S7M1AR] 	= DMA2_GET_REG(DMA_S7M1AR),
-		[DMA_S7FCR] 	= DMA2_GET_REG(DMA_S7FCR),
+static volatile dmaRegOffset_t* const dmaControllers[2] = {
+		[my_DMA1] = DMA1_REG,
+		[my_DMA2] = DMA2_REG,
 };
 
-
-
-static volatile uint32_t* const dma1RegLookupTable[DMA_REG_COUNT] = {
-		[DMA_LISR] 	= DMA1_GET_REG(DMA_LISR),
-		[DMA_HISR] 	= DMA1_GET_REG(DMA_HISR),
-		[DMA_LIFCR] = DMA1_GET_REG(DMA_LIFCR),
-		[DMA_HIFCR] = DMA1_GET_REG(DMA_HIFCR),
-
-		[DMA_S0CR] 		= DMA1_GET_REG(DMA_S0CR),
-		[DMA_S0NDTR] 	= DMA1_GET_REG(DMA_S0NDTR),
-		[DMA_S0PAR] 	= DMA1_GET_REG(DMA_S0PAR),
-		[DMA_S0M0AR] 	= DMA1_GET_REG(DMA_S0M0AR),
-		[DMA_S0M1AR] 	= DMA1_GET_REG(DMA_S0M1AR),
-		[DMA_S0FCR] 	= DMA1_GET_REG(DMA_S0FCR),
-
-		[DMA_S1CR] 		= DMA1_GET_REG(DMA_S1CR),
-		[DMA_S1NDTR] 	= DMA1_GET_REG(DMA_S1NDTR),
-		[DMA_S1PAR] 	= DMA1_GET_REG(DMA_S1PAR),
-		[DMA_S1M0AR] 	= DMA1_GET_REG(DMA_S1M0AR),
-		[DMA_S1M1AR] 	= DMA1_GET_REG(DMA_S1M1AR),
-		[DMA_S1FCR] 	= DMA1_GET_REG(DMA_S1FCR),
-
-		[DMA_S2CR] 		= DMA1_GET_REG(DMA_S2CR),
-		[DMA_S2NDTR] 	= DMA1_GET_REG(DMA_S2NDTR),
-		[DMA_S2PAR] 	= DMA1_GET_REG(DMA_S2PAR),
-		[DMA_S2M0AR] 	= DMA1_GET_REG(DMA_S2M0AR),
-		[DMA_S2M1AR] 	= DMA1_GET_REG(DMA_S2M1AR),
-		[DMA_S2FCR] 	= DMA1_GET_REG(DMA_S2FCR),
-
-		[DMA_S3CR] 		= DMA1_GET_REG(DMA_S3CR),
-		[DMA_S3NDTR] 	= DMA1_GET_REG(DMA_S3NDTR),
-		[DMA_S3PAR] 	= DMA1_GET_REG(DMA_S3PAR),
-		[DMA_S3M0AR] 	= DMA1_GET_REG(DMA_S3M0AR),
-		[DMA_S3M1AR] 	= DMA1_GET_REG(DMA_S3M1AR),
-		[DMA_S3FCR] 	= DMA1_GET_REG(DMA_S3FCR),
-
-		[DMA_S4CR] 		= DMA1_GET_REG(DMA_S4CR),
-		[DMA_S4NDTR] 	= DMA1_GET_REG(DMA_S4NDTR),
-		[DMA_S4PAR] 	= DMA1_GET_REG(DMA_S4PAR),
-		[DMA_S4M0AR] 	= DMA1_GET_REG(DMA_S4M0AR),
-		[DMA_S4M1AR] 	= DMA1_GET_REG(DMA_S4M1AR),
-		[DMA_S4FCR] 	= DMA1_GET_REG(DMA_S4FCR),
-
-		[DMA_S5CR] 		= DMA1_GET_REG(DMA_S5CR),
-		[DMA_S5NDTR] 	= DMA1_GET_REG(DMA_S5NDTR),
-		[DMA_S5PAR] 	= DMA1_GET_REG(DMA_S5PAR),
-		[DMA_S5M0AR] 	= DMA1_GET_REG(DMA_S5M0AR),
-		[DMA_S5M1AR] 	= DMA1_GET_REG(DMA_S5M1AR),
-		[DMA_S5FCR] 	= DMA1_GET_REG(DMA_S5FCR),
-
-		[DMA_S6CR] 		= DMA1_GET_REG(DMA_S6CR),
-		[DMA_S6NDTR] 	= DMA1_GET_REG(DMA_S6NDTR),
-		[DMA_S6PAR] 	= DMA1_GET_REG(DMA_S6PAR),
-		[DMA_S6M0AR] 	= DMA1_GET_REG(DMA_S6M0AR),
-		[DMA_S6M1AR] 	= DMA1_GET_REG(DMA_S6M1AR),
-		[DMA_S6FCR] 	= DMA1_GET_REG(DMA_S6FCR),
-
-		[DMA_S7CR] 		= DMA1_GET_REG(DMA_S7CR),
-		[DMA_S7NDTR] 	= DMA1_GET_REG(DMA_S7NDTR),
-		[DMA_S7PAR] 	= DMA1_GET_REG(DMA_S7PAR),
-		[DMA_S7M0AR] 	= DMA1_GET_REG(DMA_S7M0AR),
-		[DMA_S7M1AR] 	= DMA1_GET_REG(DMA_S7M1AR),
-		[DMA_S7FCR] 	= DMA1_GET_REG(DMA_S7FCR),
+static const IRQn_Pos_t streamIrqs[DMA_STREAM_COUNT] = {
+		DMA1_S0, DMA1_S1, DMA1_S2, DMA1_S3, DMA1_S4, DMA1_S5, DMA1_S6, DMA1_S7,
+		DMA2_S0, DMA2_S1, DMA2_S2, DMA2_S3, DMA2_S4, DMA2_S5, DMA2_S6, DMA2_S7,
 };
 
+/* @brief	Callbacks and double-buffer bookkeeping of one stream */
+typedef struct{
+	DMA_StreamCallback_t callback;
+	void* context;
+	DMA_BufferCallback_t bufferCallback;
+	void* bufferContext;
+	uint8_t nextDone;		//Buffer the next double-buffer TC should complete
+	uint32_t missed;		//Buffer completions lost between two interrupts
+}dmaStreamState_t;
+
+static dmaStreamState_t streamState[DMA_STREAM_COUNT];
+
+/* SxCR */
+#define DMA_CR_EN			(1U << 0)
+#define DMA_CR_IE_MASK		0x1EU	//TCIE | HTIE | TEIE | DMEIE
+#define DMA_CR_TCIE			(1U << 4)
+#define DMA_CR_DIR_POS		6U
+#define DMA_CR_CIRC			(1U << 8)
+#define DMA_CR_PINC			(1U << 9)
+#define DMA_CR_MINC			(1U << 10)
+#define DMA_CR_PSIZE_POS	11U
+#define DMA_CR_MSIZE_POS	13U
+#define DMA_CR_PL_POS		16U
+#define DMA_CR_DBM			(1U << 18)
+#define DMA_CR_CT			(1U << 19)
+#define DMA_CR_PBURST_POS	21U
+#define DMA_CR_MBURST_POS	23U
+#define DMA_CR_CHSEL_POS	25U
+
+#define DMA_FCR_RESET		0x21U	//Direct mode, FIFO threshold 1/2
+#define DMA_FCR_DMDIS		(1U << 2)
+#define DMA_FCR_FEIE		(1U << 7)
+
 
 
 /*
@@ -204,6 +123,54 @@ static inline uint32_t readDMABits(const volatile uint32_t* reg,
 
 
 
+/*
+ * @brief	Width of the field that starts at @p bitPosition in @p regName
+ *
+ * 			Every stream has the same 6-register block (CR, NDTR, PAR, M0AR, M1AR, FCR),
+ * 			so the stream registers are decoded by their place inside that block.
+ *
+ * @return	Field width in bits, 0 for an unknown register
+ */
+static uint8_t dmaFieldWidth(uint8_t bitPosition, DMA_RegName_t regName){
+	if(regName <= DMA_HIFCR) return 1; //ISR/IFCR: one flag per bit
+	if(regName >= DMA_REG_COUNT) return 0;
+
+	switch((regName - DMA_S0CR) % DMA_STREAM_REG_COUNT){
+		case 0: //SxCR
+			if(bitPosition == 6 || bitPosition == 11 ||
+			   bitPosition == 13 || bitPosition == 16 ||
+			   bitPosition == 21 || bitPosition == 23){
+				return 2;
+			}
+			else if(bitPosition == 25){
+				return 3;
+			}
+			return 1;
+
+		case 1: //SxNDTR
+			return 16;
+
+		case 2: //SxPAR
+		case 3: //SxM0AR
+		case 4: //SxM1AR
+			return 32;
+
+		default: //SxFCR
+			if(bitPosition == 0) return 2;
+			else if(bitPosition == 3) return 3;
+			return 1;
+	}
+}
+
+
+
+/* DMA_RegName_t follows the register order of dmaRegOffset_t, so the enum is the word offset */
+static inline volatile uint32_t* dmaReg(DMA_Name_t dma, DMA_RegName_t regName){
+	return &dmaControllers[dma] -> DMA_LISR + regName;
+}
+
+
+
 /*
  * @brief	Write a bit-field inside an DMAx register
  *
@@ -211,408 +178,465 @@ static inline uint32_t readDMABits(const volatile uint32_t* reg,
  * 			then writes a bitfield to the corresponding DMAx reg without
  * 			affecting other bits.
  *
- * 			It uses a lookup table to get the DMAx register address, and ensures
- * 			safe bit manipulation even for multi-bit values.
+ * 			The register address is the controller base plus the register's word offset,
+ * 			and multi-bit values are written without touching the neighbouring fields.
  *
+ * @param	dma				my_DMA1 or my_DMA2
  * @param	bitPosition		Starting bit (0-31)
  * @param	regName			Target register (see ::DMA_RegName_t)
  * @param	value			New field value.
  */
-void writeDMA2(uint8_t bitPosition, DMA_RegName_t regName, uint32_t value){
-	uint8_t bitWidth = 1;
+void writeDMA(DMA_Name_t dma, uint8_t bitPosition, DMA_RegName_t regName, uint32_t value){
+	if(dma != my_DMA1 && dma != my_DMA2) return;
 
-	switch(regName){
-		case DMA_LISR:
-			break;
+	uint8_t bitWidth = dmaFieldWidth(bitPosition, regName);
+	if(bitWidth == 0) return;
 
-		case DMA_HISR:
-			break;
+	writeDMABits(dmaReg(dma, regName), bitPosition, bitWidth, value);
+}
 
-		case DMA_LIFCR:
-			break;
 
-		case DMA_HIFCR:
-			break;
 
-		case DMA_S0CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
+/*
+ * @brief	Read a bit-field from a DMAx peripheral register
+ *
+ * @param	dma				my_DMA1 or my_DMA2
+ * @param	bitPosition		The LSB index of the field (0-31)
+ * @param	regName			Which register to access (enum @ref DMA_RegName_t)
+ *
+ * @return	The extracted field value on success.
+ * 			If the call is invalid, the constant @c 0xFFFFFFFF is returned as an ERROR
+ */
+uint32_t readDMA(DMA_Name_t dma, uint8_t bitPosition, DMA_RegName_t regName){
+	uint32_t const ERROR = 0xFFFFFFFF;
+	if(dma != my_DMA1 && dma != my_DMA2) return ERROR;
 
-		case DMA_S0NDTR:
-			bitWidth = 16;
-			break;
+	uint8_t bitWidth = dmaFieldWidth(bitPosition, regName);
+	if(bitWidth == 0) return ERROR;
 
-		case DMA_S0PAR:
-			bitWidth = 32;
-			break;
+	return readDMABits(dmaReg(dma, regName), bitPosition, bitWidth);
+}
 
-		case DMA_S0M0AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S0M1AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S0FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
 
-		//------------------------------------------------//
-		case DMA_S1CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
 
-		case DMA_S1NDTR:
-			bitWidth = 16;
-			break;
 
-		case DMA_S1PAR:
-			bitWidth = 32;
-			break;
+/*
+ * --------------------------------------------------------------
+ * Stream Handles
+ * --------------------------------------------------------------
+ */
 
-		case DMA_S1M0AR:
-			bitWidth = 32;
-			break;
+/*
+ * @brief	Each ISR/IFCR register packs 4 streams: 6 flag bits at offsets 0, 6, 16, 22
+ */
+static inline uint8_t streamFlagShift(DMA_Stream_t stream){
+	static const uint8_t shift[4] = {0, 6, 16, 22};
+	return shift[stream & 3U];
+}
 
-		case DMA_S1M1AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S1FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
+/* LISR/LIFCR for streams 0-3, HISR/HIFCR for streams 4-7 */
+static inline volatile uint32_t* streamFlagReg(DMA_Stream_t stream, bool clear){
+	volatile dmaRegOffset_t* dma = dmaControllers[DMA_STREAM_DMA(stream)];
+	bool high = (stream & 4U) != 0;
+	if(clear) return high ? &dma -> DMA_HIFCR : &dma -> DMA_LIFCR;
+	return high ? &dma -> DMA_HISR : &dma -> DMA_LISR;
+}
 
-		//------------------------------------------------//
-		case DMA_S2CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
 
-		case DMA_S2NDTR:
-			bitWidth = 16;
-			break;
+static inline void enableDmaClock(DMA_Name_t dma){
+	if(dma == my_DMA1) my_RCC_DMA1_CLK_ENABLE();
+	else my_RCC_DMA2_CLK_ENABLE();
+}
 
-		case DMA_S2PAR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S2M0AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S2M1AR:
-			bitWidth = 32;
-			break;
+#if DMA_TRACE
+/* Items are counted in peripheral-size units (for M2M: the source) */
+static inline uint32_t remainingBytes(volatile dmaStreamRegOffset_t* regs){
+	return (regs -> SxNDTR & 0xFFFFU) << ((regs -> SxCR >> DMA_CR_PSIZE_POS) & 0x3U);
+}
 
-		case DMA_S2FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
+static inline void traceStart(DMA_Stream_t stream, volatile dmaStreamRegOffset_t* regs, uint16_t count){
+	uint32_t cr = regs -> SxCR;
+	dmaTraceStart(stream, (uint32_t)count << ((cr >> DMA_CR_PSIZE_POS) & 0x3U),
+				  (cr & DMA_CR_TCIE) != 0, (cr & (DMA_CR_CIRC | DMA_CR_DBM)) != 0);
+}
+#endif
 
-		//------------------------------------------------//
-		case DMA_S3CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
 
-		case DMA_S3NDTR:
-			bitWidth = 16;
-			break;
 
-		case DMA_S3PAR:
-			bitWidth = 32;
-			break;
+/*
+ * @brief	Register block of a stream, NULL for an invalid handle
+ */
+volatile dmaStreamRegOffset_t* dmaStreamRegs(DMA_Stream_t stream){
+	if(stream >= DMA_STREAM_COUNT) return NULL;
+	volatile uint32_t* s0cr = &dmaControllers[DMA_STREAM_DMA(stream)] -> DMA_S0CR;
+	return (volatile dmaStreamRegOffset_t*)(s0cr + DMA_STREAM_NUM(stream) * DMA_STREAM_REG_COUNT);
+}
 
-		case DMA_S3M0AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S3M1AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S3FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
+IRQn_Pos_t dmaStreamIrq(DMA_Stream_t stream){
+	return streamIrqs[stream % DMA_STREAM_COUNT];
+}
 
-		//------------------------------------------------//
-		case DMA_S7CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
 
-		case DMA_S7NDTR:
-			bitWidth = 16;
-			break;
 
-		case DMA_S7PAR:
-			bitWidth = 32;
-			break;
+/*
+ * @brief	FIFO threshold against burst sizes (RM0383 9.3.12, Table 27)
+ *
+ * 			A memory burst is read from or written to the FIFO in one go, so the threshold must
+ * 			hold a whole number of them: 1/4 of the 16-byte FIFO takes one 4-byte burst, full
+ * 			takes four. A peripheral burst must fit in the FIFO. Anything else raises FEIF and
+ * 			the stream stops on its first burst.
+ */
+static bool fifoConfigValid(const DMA_StreamConfig_t* config){
+	static const uint8_t beats[] = {1, 4, 8, 16}; //Index: DMA_Burst_t
+	uint32_t thresholdBytes = 4U * (uint32_t)config -> fifo; //DMA_FIFO_1_4 .. DMA_FIFO_FULL
+	uint32_t memBurstBytes = beats[config -> memBurst] << config -> memWidth;
+	uint32_t periphBurstBytes = beats[config -> periphBurst] << config -> periphWidth;
+
+	if(config -> memBurst != DMA_BURST_SINGLE && (thresholdBytes % memBurstBytes) != 0) return false;
+	return periphBurstBytes <= DMA_FIFO_BYTES;
+}
 
-		case DMA_S7M0AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S7M1AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S7FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
+/*
+ * @brief	Stop @p stream and program it from @p config, ready for dmaStreamStart()
+ *
+ * 			A zeroed FIFO/burst setting leaves the stream in direct mode with single transfers.
+ * 			Its NVIC line is enabled when @p config asks for any interrupt.
+ *
+ * @return	DMA_ERR_PARAM for an invalid handle or field, DMA_OK otherwise
+ */
+DMA_Status_t dmaStreamConfigure(DMA_Stream_t stream, const DMA_StreamConfig_t* config){
+	if(stream >= DMA_STREAM_COUNT || config == NULL) return DMA_ERR_PARAM;
+	if(config -> channel > 7U || config -> dir > DMA_DIR_M2M) return DMA_ERR_PARAM;
+	if(config -> periphWidth > DMA_WIDTH_32 || config -> memWidth > DMA_WIDTH_32) return DMA_ERR_PARAM;
+	if(config -> priority > DMA_PRIO_VERY_HIGH) return DMA_ERR_PARAM;
+	if(config -> fifo > DMA_FIFO_FULL) return DMA_ERR_PARAM;
+	if(config -> periphBurst > DMA_BURST_INCR16 || config -> memBurst > DMA_BURST_INCR16) return DMA_ERR_PARAM;
+
+	/* Bursts are built in the FIFO: direct mode moves single items only */
+	bool direct = (config -> fifo == DMA_FIFO_DIRECT);
+	if(direct && (config -> periphBurst != DMA_BURST_SINGLE || config -> memBurst != DMA_BURST_SINGLE)){
+		return DMA_ERR_PARAM;
+	}
 
-		//...
+	if(!direct && !fifoConfigValid(config)) return DMA_ERR_PARAM;
 
-		default: return;
+	/* Only DMA2 has a memory port on both sides; M2M runs through the FIFO and never circular */
+	if(config -> dir == DMA_DIR_M2M && (DMA_STREAM_DMA(stream) != my_DMA2 || config -> circular || direct)){
+		return DMA_ERR_PARAM;
 	}
 
-	volatile uint32_t* reg = dma2RegLookupTable[regName];
-	writeDMABits(reg, bitPosition, bitWidth, value);
+	uint32_t cr = ((uint32_t)config -> channel << DMA_CR_CHSEL_POS) |
+				  ((uint32_t)config -> memBurst << DMA_CR_MBURST_POS) |
+				  ((uint32_t)config -> periphBurst << DMA_CR_PBURST_POS) |
+				  ((uint32_t)config -> priority << DMA_CR_PL_POS) |
+				  ((uint32_t)config -> memWidth << DMA_CR_MSIZE_POS) |
+				  ((uint32_t)config -> periphWidth << DMA_CR_PSIZE_POS) |
+				  ((uint32_t)config -> dir << DMA_CR_DIR_POS) |
+				  ((config -> irqFlags >> 1) & DMA_CR_IE_MASK); //TC/HT/TE/DME flag n -> interrupt enable n - 1
+	if(config -> memInc) cr |= DMA_CR_MINC;
+	if(config -> periphInc) cr |= DMA_CR_PINC;
+	if(config -> circular) cr |= DMA_CR_CIRC;
+
+	enableDmaClock(DMA_STREAM_DMA(stream));
+	dmaStreamStop(stream);
+
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+	regs -> SxPAR = config -> periphAddr;
+	uint32_t fcr = direct ? DMA_FCR_RESET : (DMA_FCR_DMDIS | ((uint32_t)config -> fifo - 1U)); //FTH: 1/4 .. full
+	if(config -> irqFlags & DMA_FLAG_FE) fcr |= DMA_FCR_FEIE;
+	regs -> SxFCR = fcr;
+	regs -> SxCR = cr;
+
+	if(config -> irqFlags & DMA_FLAG_ALL) NVIC_enableIRQ(streamIrqs[stream]);
+	return DMA_OK;
 }
 
 
 
 /*
- * @brief	Read a bit-field from an DMA2 peripheral register
+ * @brief	Move @p count items between the configured peripheral address and @p memory
  *
- * @param	bitPosition		The LSB index of the field (0-31)
- * @param	mode			Which register of DMA2 to access (enum @ref DMA_regName_t)
+ * @note	The stream must be idle: a normal-mode stream clears EN itself at the end,
+ * 			anything else has to be stopped with dmaStreamStop() first
  *
- * @param	value			The value to write. There is a helper function to check if
- * 							@p value fits into the target field width; if it does not,
- * 							the call ignore
+ * @return	DMA_ERR_BUSY while the stream is still enabled
+ */
+DMA_Status_t dmaStreamStart(DMA_Stream_t stream, const volatile void* memory, uint16_t count){
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+	if(regs == NULL || count == 0) return DMA_ERR_PARAM;
+	if(regs -> SxCR & DMA_CR_EN) return DMA_ERR_BUSY;
+
+	dmaStreamClearFlags(stream, DMA_FLAG_ALL); //EN is ignored while a flag of the stream is still set
+	regs -> SxCR &= ~(DMA_CR_DBM | DMA_CR_CT); //Single buffer, whatever the last run was
+	regs -> SxM0AR = (uint32_t)memory;
+	regs -> SxNDTR = count;
+#if DMA_TRACE
+	traceStart(stream, regs, count); //Before EN: a memory-to-memory TC can beat the next line
+#endif
+	regs -> SxCR |= DMA_CR_EN;
+	return DMA_OK;
+}
+
+
+
+/*
+ * @brief	Run the stream in double-buffer mode: @p count items into (or out of) @p buffer0,
+ * 			then @p count items with @p buffer1, and back, without a gap or a reload
  *
- * @return	The extracted field value on success.
- * 			If the cal is invalid, the constant @c 0xFFFFFFFF is returned as an ERROR
+ * 			The hardware switches buffers (CT) at every TC and is circular by construction.
+ * 			Configure the stream with DMA_FLAG_TC to get the buffer callback.
+ *
+ * @return	DMA_ERR_PARAM for memory-to-memory streams (no double buffering there),
+ * 			DMA_ERR_BUSY while the stream is still enabled
  */
-uint32_t readDMA2(uint8_t bitPosition, DMA_RegName_t regName){
-	uint32_t const ERROR = 0xFFFFFFFF;
-	uint8_t bitWidth = 1;
+DMA_Status_t dmaStreamStartDouble(DMA_Stream_t stream, const volatile void* buffer0, const volatile void* buffer1, uint16_t count){
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+	if(regs == NULL || buffer0 == NULL || buffer1 == NULL || count == 0) return DMA_ERR_PARAM;
+	if(((regs -> SxCR >> DMA_CR_DIR_POS) & 0x3U) == DMA_DIR_M2M) return DMA_ERR_PARAM;
+	if(regs -> SxCR & DMA_CR_EN) return DMA_ERR_BUSY;
+
+	dmaStreamClearFlags(stream, DMA_FLAG_ALL);
+	regs -> SxM0AR = (uint32_t)buffer0;
+	regs -> SxM1AR = (uint32_t)buffer1;
+	regs -> SxNDTR = count;
+	regs -> SxCR = (regs -> SxCR & ~DMA_CR_CT) | DMA_CR_DBM; //DBM is only writable while EN is 0; start on buffer 0
+
+	streamState[stream].nextDone = 0;
+	streamState[stream].missed = 0;
+#if DMA_TRACE
+	traceStart(stream, regs, count);
+#endif
+	regs -> SxCR |= DMA_CR_EN;
+	return DMA_OK;
+}
 
-	switch(regName){
-		case DMA_LISR:
-			break;
 
-		case DMA_HISR:
-			break;
 
-		case DMA_LIFCR:
-			break;
+/*
+ * @brief	Buffer (0 or 1) the double-buffered stream is moving data with right now
+ */
+uint8_t dmaStreamActiveBuffer(DMA_Stream_t stream){
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+	if(regs == NULL) return 0;
+	return (regs -> SxCR & DMA_CR_CT) ? 1U : 0U;
+}
 
-		case DMA_HIFCR:
-			break;
 
-		case DMA_S0CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
 
-		case DMA_S0NDTR:
-			bitWidth = 16;
-			break;
+/*
+ * @brief	Point @p buffer (0 or 1) of a double-buffered stream at @p memory
+ *
+ * 			Only the idle buffer can be retargeted while the stream runs: writing the address
+ * 			of the buffer in use raises TE and stops the stream, so that case is refused.
+ * 			The new address takes effect at the next buffer switch.
+ *
+ * @return	DMA_ERR_BUSY if @p buffer is the one in use
+ */
+DMA_Status_t dmaStreamSetBuffer(DMA_Stream_t stream, uint8_t buffer, const volatile void* memory){
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+	if(regs == NULL || buffer > 1U || memory == NULL) return DMA_ERR_PARAM;
 
-		case DMA_S0PAR:
-			bitWidth = 32;
-			break;
+	DMA_Status_t status = DMA_OK;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq(); //Keep the CT check and the write together
+	uint32_t cr = regs -> SxCR;
 
-		case DMA_S0M0AR:
-			bitWidth = 32;
-			break;
+	if((cr & DMA_CR_EN) && ((cr & DMA_CR_CT) ? 1U : 0U) == buffer){
+		status = DMA_ERR_BUSY;
+	}
+	else if(buffer == 0){
+		regs -> SxM0AR = (uint32_t)memory;
+	}
+	else{
+		regs -> SxM1AR = (uint32_t)memory;
+	}
+	__set_PRIMASK(primask);
+	return status;
+}
 
-		case DMA_S0M1AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S0FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
 
-		//------------------------------------------------//
+/*
+ * @brief	Buffer completions that were never reported: the interrupt came late enough for
+ * 			the stream to switch buffers twice, so one finished buffer was overwritten
+ */
+uint32_t dmaStreamMissedBuffers(DMA_Stream_t stream){
+	if(stream >= DMA_STREAM_COUNT) return 0;
+	return streamState[stream].missed;
+}
 
-		case DMA_S1CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
 
-		case DMA_S1NDTR:
-			bitWidth = 16;
-			break;
 
-		case DMA_S1PAR:
-			bitWidth = 32;
-			break;
+/*
+ * @brief	Clear EN and wait until the stream has really stopped, then drop its flags
+ * 			(disabling a running stream raises TC)
+ */
+void dmaStreamStop(DMA_Stream_t stream){
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+	if(regs == NULL) return;
+
+#if DMA_TRACE
+	bool wasRunning = (regs -> SxCR & DMA_CR_EN) != 0;
+#endif
+	regs -> SxCR &= ~DMA_CR_EN;
+	while(regs -> SxCR & DMA_CR_EN);
+#if DMA_TRACE
+	dmaTraceStop(stream, wasRunning, remainingBytes(regs));
+#endif
+	dmaStreamClearFlags(stream, DMA_FLAG_ALL);
+}
 
-		case DMA_S1M0AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S1M1AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S1FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
+bool dmaStreamBusy(DMA_Stream_t stream){
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+	return (regs != NULL) && (regs -> SxCR & DMA_CR_EN);
+}
 
-		//------------------------------------------------//
 
-		case DMA_S2CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
 
-		case DMA_S2NDTR:
-			bitWidth = 16;
-			break;
+/*
+ * @brief	Change the arbitration priority of a configured stream between two transfers
+ *
+ * 			Streams of one controller are served by PL first and by stream number on a tie,
+ * 			so a stream that must not starve goes above the ones that move bulk data.
+ *
+ * @return	DMA_ERR_BUSY while the stream is enabled (PL is read-only then)
+ */
+DMA_Status_t dmaStreamSetPriority(DMA_Stream_t stream, DMA_Priority_t priority){
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+	if(regs == NULL || priority > DMA_PRIO_VERY_HIGH) return DMA_ERR_PARAM;
+	if(regs -> SxCR & DMA_CR_EN) return DMA_ERR_BUSY;
 
-		case DMA_S2PAR:
-			bitWidth = 32;
-			break;
+	regs -> SxCR = (regs -> SxCR & ~(0x3U << DMA_CR_PL_POS)) | ((uint32_t)priority << DMA_CR_PL_POS);
+	return DMA_OK;
+}
 
-		case DMA_S2M0AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S2M1AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S2FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
+/*
+ * @brief	Items the stream still has to move in the current pass (raw NDTR)
+ */
+uint16_t dmaStreamRemaining(DMA_Stream_t stream){
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+	if(regs == NULL) return 0;
+	return (uint16_t)(regs -> SxNDTR & 0xFFFFU);
+}
 
-		//------------------------------------------------//
-		case DMA_S3CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
 
-		case DMA_S3NDTR:
-			bitWidth = 16;
-			break;
 
-		case DMA_S3PAR:
-			bitWidth = 32;
-			break;
+/*
+ * @brief	Flags of one stream, aligned to bit 0 (DMA_FLAG_FE ... DMA_FLAG_TC)
+ */
+uint32_t dmaStreamFlags(DMA_Stream_t stream){
+	if(stream >= DMA_STREAM_COUNT) return 0;
+	return (*streamFlagReg(stream, false) >> streamFlagShift(stream)) & DMA_FLAG_ALL;
+}
 
-		case DMA_S3M0AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S3M1AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S3FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
+/*
+ * @brief	Clear the given flags of one stream with a single IFCR write
+ */
+void dmaStreamClearFlags(DMA_Stream_t stream, uint32_t flags){
+	if(stream >= DMA_STREAM_COUNT) return;
+	*streamFlagReg(stream, true) = (flags & DMA_FLAG_ALL) << streamFlagShift(stream); //IFCR is write-1-to-clear, no RMW
+}
 
-		//------------------------------------------------//
-		case DMA_S7CR:
-			if(bitPosition == 6 || bitPosition == 11 ||
-			   bitPosition == 13 || bitPosition == 16 ||
-			   bitPosition == 21 || bitPosition == 23){
-				bitWidth = 2;
-			}
-			else if(bitPosition == 25){
-				bitWidth = 3;
-			}
-			break;
 
-		case DMA_S7NDTR:
-			bitWidth = 16;
-			break;
 
-		case DMA_S7PAR:
-			bitWidth = 32;
-			break;
+/*
+ * @brief	Call @p callback with @p context from the stream's interrupt. NULL removes it
+ */
+void dmaStreamSetCallback(DMA_Stream_t stream, DMA_StreamCallback_t callback, void* context){
+	if(stream >= DMA_STREAM_COUNT) return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	streamState[stream].callback = callback;
+	streamState[stream].context = context;
+	__set_PRIMASK(primask);
+}
 
-		case DMA_S7M0AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S7M1AR:
-			bitWidth = 32;
-			break;
 
-		case DMA_S7FCR:
-			if(bitPosition == 0) bitWidth = 2;
-			else if(bitPosition == 3) bitWidth = 3;
-			break;
-		//...
+/*
+ * @brief	Call @p callback with the finished buffer of a double-buffered stream. NULL removes it
+ */
+void dmaStreamSetBufferCallback(DMA_Stream_t stream, DMA_BufferCallback_t callback, void* context){
+	if(stream >= DMA_STREAM_COUNT) return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	streamState[stream].bufferCallback = callback;
+	streamState[stream].bufferContext = context;
+	__set_PRIMASK(primask);
+}
+
+
 
-		default: return ERROR;
+/*
+ * @brief	Common body of the 16 stream vectors: clear what was raised, then report it
+ *
+ * 			In double-buffer mode TC goes to the buffer callback: the buffer that just finished
+ * 			is the one CT no longer points at. Everything else goes to the stream callback.
+ */
+void dmaStreamIRQHandler(DMA_Stream_t stream){
+	if(stream >= DMA_STREAM_COUNT) return;
+	dmaStreamState_t* state = &streamState[stream];
+	volatile dmaStreamRegOffset_t* regs = dmaStreamRegs(stream);
+
+	uint32_t flags = dmaStreamFlags(stream);
+	dmaStreamClearFlags(stream, flags);
+
+	uint32_t cr = regs -> SxCR;
+#if DMA_TRACE
+	dmaTraceEvent(stream, flags, (cr & DMA_CR_EN) != 0, remainingBytes(regs));
+#endif
+	if((flags & DMA_FLAG_TC) && (cr & DMA_CR_DBM)){
+		uint8_t done = (cr & DMA_CR_CT) ? 0U : 1U;
+		if(done != state -> nextDone) state -> missed++; //Two switches since the last TC seen
+		state -> nextDone = done ^ 1U;
+		flags &= ~DMA_FLAG_TC;
+
+		if(state -> bufferCallback != NULL){
+			state -> bufferCallback(stream, done, state -> bufferContext);
+		}
 	}
 
-	volatile uint32_t* reg = dma2RegLookupTable[regName];
-	return readDMABits(reg, bitPosition, bitWidth);
+	if(flags != 0 && state -> callback != NULL){
+		state -> callback(stream, flags, state -> context);
+	}
 }
 
 
 
-
+/*
+ * Vector table entries
+ */
+void DMA1_Stream0_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA1, 0));}
+void DMA1_Stream1_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA1, 1));}
+void DMA1_Stream2_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA1, 2));}
+void DMA1_Stream3_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA1, 3));}
+void DMA1_Stream4_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA1, 4));}
+void DMA1_Stream5_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA1, 5));}
+void DMA1_Stream6_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA1, 6));}
+void DMA1_Stream7_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA1, 7));}
+
+void DMA2_Stream0_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA2, 0));}
+void DMA2_Stream1_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA2, 1));}
+void DMA2_Stream2_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA2, 2));}
+void DMA2_Stream3_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA2, 3));}
+void DMA2_Stream4_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA2, 4));}
+void DMA2_Stream5_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA2, 5));}
+void DMA2_Stream6_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA2, 6));}
+void DMA2_Stream7_IRQHandler(void){dmaStreamIRQHandler(DMA_STREAM(my_DMA2, 7));}
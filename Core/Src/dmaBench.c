@@ -0,0 +1,235 @@
+/*
+ * dmaBench.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * DMA2 contention benchmark
+ * 		Every lane restarts itself from its completion interrupt while the window is open, so
+ * 		the streams compete for the controller the whole time. Thread mode only opens and closes
+ * 		the window and puts the borrowed console stream back.
+ */
+
+#include "dmaBench.h"
+
+#if DMA_BENCHMARK
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+#define LANE_MASK(lane)		(1U << (lane))
+#define LANE_ALL			(LANE_MASK(DMA_BENCH_LANES) - 1U)
+
+/* @brief	Accumulated by the lane's completion interrupt */
+typedef struct{
+	uint32_t startAt;		//Cycle count when the transfer in flight was started
+	uint32_t transfers;
+	uint32_t bytes;
+	uint32_t latencySum;
+	uint32_t latencyMax;
+	uint32_t errors;
+}benchLane_t;
+
+static const char* const laneNames[DMA_BENCH_LANES] = {
+		[DMA_BENCH_LANE_UART] = "UART",
+		[DMA_BENCH_LANE_ADC] = "ADC",
+		[DMA_BENCH_LANE_MEM] = "MEM",
+};
+
+static volatile benchLane_t lanes[DMA_BENCH_LANES];
+static volatile bool windowOpen = false;
+
+static char uartPayload[DMA_BENCH_UART_BYTES];
+static uint16_t adcSamples[3][DMA_BENCH_ADC_SAMPLES];
+static volatile uint8_t adcInStream[2];	//Row of adcSamples behind buffer 0 and buffer 1
+static volatile uint8_t adcParked;		//Row holding the last finished buffer
+static uint32_t memBuf[2][DMA_BENCH_MEM_BYTES / 4U];
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+static void laneComplete(DMA_BenchLane_t lane, uint32_t bytes){
+	volatile benchLane_t* s = &lanes[lane];
+	uint32_t now = CYCLE_COUNT();
+	uint32_t latency = now - s -> startAt;
+
+	s -> transfers++;
+	s -> bytes += bytes;
+	s -> latencySum += latency;
+	if(latency > s -> latencyMax) s -> latencyMax = latency;
+	s -> startAt = now;
+}
+
+
+static void benchMemDone(DMA_Status_t status, void* context){
+	(void)context;
+	if(status != DMA_OK){
+		lanes[DMA_BENCH_LANE_MEM].errors++;
+		return;
+	}
+	laneComplete(DMA_BENCH_LANE_MEM, DMA_BENCH_MEM_BYTES);
+	if(windowOpen) (void)dmaMemcpy(memBuf[1], memBuf[0], DMA_BENCH_MEM_BYTES, benchMemDone, NULL);
+}
+
+
+/*
+ * @brief	ADC lane buffer completion: park the finished row and hand the stream the spare one.
+ * 			The stream is already filling the other buffer, so @p done is idle until its next TC.
+ */
+static void benchAdcBuffer(DMA_Stream_t stream, uint8_t done, void* context){
+	(void)context;
+	laneComplete(DMA_BENCH_LANE_ADC, sizeof adcSamples[0]);
+
+	uint8_t spare = adcParked;
+	if(dmaStreamSetBuffer(stream, done, adcSamples[spare]) != DMA_OK){
+		lanes[DMA_BENCH_LANE_ADC].errors++; //Too late: the stream has switched back to @p done
+		return;
+	}
+	adcParked = adcInStream[done];
+	adcInStream[done] = spare;
+}
+
+
+/* Stream interrupt of the UART lane, and the errors of the ADC lane; @p context is the lane */
+static void benchStreamEvent(DMA_Stream_t stream, uint32_t flags, void* context){
+	DMA_BenchLane_t lane = (DMA_BenchLane_t)(uintptr_t)context;
+
+	if(flags & (DMA_FLAG_TE | DMA_FLAG_DME | DMA_FLAG_FE)){
+		lanes[lane].errors++;
+		return;
+	}
+	if((flags & DMA_FLAG_TC) == 0 || lane != DMA_BENCH_LANE_UART) return;
+
+	laneComplete(lane, DMA_BENCH_UART_BYTES);
+	if(windowOpen) (void)dmaStreamStart(stream, uartPayload, DMA_BENCH_UART_BYTES);
+}
+
+
+static void configureLanes(void){
+	DMA_StreamConfig_t uart = {
+			.channel = 4,
+			.dir = DMA_DIR_M2P,
+			.periphWidth = DMA_WIDTH_8,
+			.memWidth = DMA_WIDTH_8,
+			.memInc = true,
+			.priority = UART_DMA_TX_PRIORITY,
+			.irqFlags = DMA_FLAG_TC | DMA_FLAG_TE,
+			.periphAddr = (uint32_t)UART1_GET_REG(UART_DR),
+	};
+	(void)dmaStreamConfigure(DMA_BENCH_UART_STREAM, &uart);
+	dmaStreamSetCallback(DMA_BENCH_UART_STREAM, benchStreamEvent, (void*)(uintptr_t)DMA_BENCH_LANE_UART);
+
+	DMA_StreamConfig_t adc = {
+			.channel = 0,
+			.dir = DMA_DIR_P2M,
+			.periphWidth = DMA_WIDTH_16,
+			.memWidth = DMA_WIDTH_16,
+			.memInc = true, //Double-buffered, so circular by construction
+			.priority = DMA_BENCH_ADC_PRIORITY,
+			.irqFlags = DMA_FLAG_TC | DMA_FLAG_TE | DMA_FLAG_DME,
+			.periphAddr = ADC_dataRegAddr(),
+	};
+	(void)dmaStreamConfigure(DMA_BENCH_ADC_STREAM, &adc);
+	dmaStreamSetCallback(DMA_BENCH_ADC_STREAM, benchStreamEvent, (void*)(uintptr_t)DMA_BENCH_LANE_ADC);
+	dmaStreamSetBufferCallback(DMA_BENCH_ADC_STREAM, benchAdcBuffer, NULL);
+}
+
+
+/*
+ * @brief	Open the window with the lanes in @p mask running, close it after DMA_BENCH_WINDOW_MS
+ *
+ * @return	Length of the window in core cycles
+ */
+static uint32_t runWindow(uint32_t mask, DMA_BenchLaneStats_t out[DMA_BENCH_LANES]){
+	memset((void*)lanes, 0, sizeof lanes);
+	windowOpen = true;
+	uint32_t startTick = getTick();
+	uint32_t start = CYCLE_COUNT();
+
+	for(uint8_t i = 0; i < DMA_BENCH_LANES; i++) lanes[i].startAt = start;
+	if(mask & LANE_MASK(DMA_BENCH_LANE_ADC)){
+		adcInStream[0] = 0;
+		adcInStream[1] = 1;
+		adcParked = 2;
+		(void)dmaStreamStartDouble(DMA_BENCH_ADC_STREAM, adcSamples[0], adcSamples[1], DMA_BENCH_ADC_SAMPLES);
+		ADC_continuousDmaStart(DMA_BENCH_ADC_CHANNEL);
+	}
+	if(mask & LANE_MASK(DMA_BENCH_LANE_UART)){
+		(void)dmaStreamStart(DMA_BENCH_UART_STREAM, uartPayload, DMA_BENCH_UART_BYTES);
+	}
+	if(mask & LANE_MASK(DMA_BENCH_LANE_MEM)){
+		if(dmaMemcpy(memBuf[1], memBuf[0], DMA_BENCH_MEM_BYTES, benchMemDone, NULL) != DMA_OK){
+			lanes[DMA_BENCH_LANE_MEM].errors++;
+		}
+	}
+
+	while((getTick() - startTick) < DMA_BENCH_WINDOW_MS);
+	windowOpen = false;
+	uint32_t window = CYCLE_COUNT() - start;
+
+	/* Transfers still in flight are not counted */
+	if(mask & LANE_MASK(DMA_BENCH_LANE_ADC)){
+		ADC_continuousDmaStop();
+		if(readADC(5, ADC_SR)) lanes[DMA_BENCH_LANE_ADC].errors++; //OVR: the stream missed a sample
+		dmaStreamStop(DMA_BENCH_ADC_STREAM);
+		lanes[DMA_BENCH_LANE_ADC].errors += dmaStreamMissedBuffers(DMA_BENCH_ADC_STREAM);
+	}
+	while(dmaStreamBusy(DMA_BENCH_UART_STREAM)); //Let the last line out whole
+	dmaMemWait();
+
+	for(uint8_t i = 0; i < DMA_BENCH_LANES; i++){
+		volatile benchLane_t* s = &lanes[i];
+		out[i].transfers = s -> transfers;
+		out[i].bytes = s -> bytes;
+		out[i].latencyAvg = (s -> transfers != 0) ? s -> latencySum / s -> transfers : 0;
+		out[i].latencyMax = s -> latencyMax;
+		out[i].errors = s -> errors;
+	}
+	return window;
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Each lane alone, then all of them at once, DMA_BENCH_WINDOW_MS apiece
+ *
+ * @note	Blocks for four windows. Waits for the console and dmaMemcpy() to go idle first; the
+ * 			console prints the UART lane's payload lines while it runs.
+ */
+void dmaBenchContention(DMA_BenchResult_t* result){
+	if(result == NULL) return;
+
+	memset(uartPayload, '.', sizeof uartPayload);
+	uartPayload[sizeof uartPayload - 1U] = '\n';
+
+	uartTxFlush(DMA_BENCH_UART);
+	dmaMemWait();
+	configureLanes();
+
+	DMA_BenchLaneStats_t solo[DMA_BENCH_LANES];
+	for(uint8_t i = 0; i < DMA_BENCH_LANES; i++){
+		(void)runWindow(LANE_MASK(i), solo);
+		result -> alone[i] = solo[i];
+	}
+	result -> windowCycles = runWindow(LANE_ALL, result -> shared); //All windows are equally long
+
+	UART_DMA_Transmitter_Init(DMA_BENCH_UART); //Stream and callback back to the TX ring
+}
+
+
+
+const char* dmaBenchLaneName(DMA_BenchLane_t lane){
+	return (lane < DMA_BENCH_LANES) ? laneNames[lane] : "?";
+}
+#endif
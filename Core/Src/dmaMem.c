@@ -0,0 +1,290 @@
+/*
+ * dmaMem.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Memory-to-memory copy and fill service on DMA_MEM_STREAM
+ * 		A request is cut into chunks of at most 65532 items (NDTR is 16 bits, and a multiple
+ * 		of 4 keeps bursts whole); the stream's TC interrupt starts the next chunk and the last
+ * 		one calls the completion callback. A fill copies one replicated pattern word with
+ * 		the source increment off.
+ */
+
+#include "dmaMem.h"
+#include "log.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+#define DMA_MEM_MAX_ITEMS	0xFFFCU
+
+typedef struct{
+	uint8_t* dst;
+	const uint8_t* src;		//NULL for a fill
+	uint32_t left;			//Bytes not yet moved
+	uint32_t chunk;			//Bytes of the chunk in flight
+	DMA_Width_t width;
+	DMA_MemCallback_t callback;
+	void* context;
+}dmaMemJob_t;
+
+static dmaMemJob_t job;
+static volatile bool jobBusy = false;
+static volatile uint32_t fillWord = 0; //Source of a fill, read by the stream
+static uint32_t crossover = DMA_MEM_CROSSOVER;
+
+#if DMA_MEM_BENCHMARK
+static uint32_t benchBuf[2][DMA_MEM_BENCH_MAX / 4U];
+static volatile uint32_t benchDoneAt = 0;
+#endif
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+
+/* Widest item that every address and the length are aligned to */
+static DMA_Width_t widthFor(uint32_t alignment){
+	if((alignment & 3U) == 0) return DMA_WIDTH_32;
+	if((alignment & 1U) == 0) return DMA_WIDTH_16;
+	return DMA_WIDTH_8;
+}
+
+
+static void startChunk(void){
+	uint32_t items = job.left >> job.width;
+	if(items > DMA_MEM_MAX_ITEMS) items = DMA_MEM_MAX_ITEMS;
+
+	/* INCR4 only for whole bursts that start on a burst boundary: none can cross 1 KB then */
+	uint32_t burstMask = (4U << job.width) - 1U;
+	uint32_t addresses = (uint32_t)job.dst | (uint32_t)job.src;
+	DMA_Burst_t burst = ((items & 3U) == 0 && (addresses & burstMask) == 0) ? DMA_MEM_BURST : DMA_BURST_SINGLE;
+
+	DMA_StreamConfig_t config = {
+			.dir = DMA_DIR_M2M,
+			.periphWidth = job.width,
+			.memWidth = job.width,
+			.periphInc = (job.src != NULL),
+			.memInc = true,
+			.priority = DMA_MEM_PRIORITY,
+			.fifo = DMA_MEM_FIFO,
+			.periphBurst = burst,
+			.memBurst = burst,
+			.irqFlags = DMA_FLAG_TC | DMA_FLAG_TE,
+			.periphAddr = (job.src != NULL) ? (uint32_t)job.src : (uint32_t)&fillWord, //M2M: PAR is the source
+	};
+	job.chunk = items << job.width;
+	(void)dmaStreamConfigure(DMA_MEM_STREAM, &config);
+	(void)dmaStreamStart(DMA_MEM_STREAM, job.dst, (uint16_t)items);
+}
+
+
+static void finish(DMA_Status_t status){
+	DMA_MemCallback_t callback = job.callback;
+	jobBusy = false; //Before the callback, so it can submit the next request
+	if(callback != NULL) callback(status, job.context);
+}
+
+
+/* Stream interrupt: chain the next chunk or complete */
+static void memStreamEvent(DMA_Stream_t stream, uint32_t flags, void* context){
+	(void)stream;
+	(void)context;
+
+	if(flags & (DMA_FLAG_TE | DMA_FLAG_DME)){
+		LOG_E(DMA, "mem: transfer error at 0x%08x, %u bytes left", (uint32_t)job.dst, job.left);
+		finish(DMA_ERR_TRANSFER);
+		return;
+	}
+	if((flags & DMA_FLAG_TC) == 0) return;
+
+	job.dst += job.chunk;
+	if(job.src != NULL) job.src += job.chunk;
+	job.left -= job.chunk;
+
+	if(job.left != 0) startChunk();
+	else finish(DMA_OK);
+}
+
+
+/*
+ * @brief	Claim the stream and start the first chunk; @p src NULL fills with @p value
+ */
+static DMA_Status_t submit(void* dst, const void* src, uint8_t value, uint32_t len,
+						   DMA_MemCallback_t callback, void* context){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(jobBusy){
+		__set_PRIMASK(primask);
+		return DMA_ERR_BUSY;
+	}
+	jobBusy = true;
+	__set_PRIMASK(primask);
+
+	job.dst = (uint8_t*)dst;
+	job.src = (const uint8_t*)src;
+	job.left = len;
+	job.width = widthFor((uint32_t)dst | (uint32_t)src | len);
+	job.callback = callback;
+	job.context = context;
+	fillWord = value * 0x01010101U;
+
+	startChunk();
+	return DMA_OK;
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Take DMA_MEM_STREAM and, with DMA_MEM_BENCHMARK, measure the CPU/DMA crossover
+ *
+ * @note	Needs cycleCounterInit() and interrupts enabled
+ */
+void dmaMemInit(void){
+	dmaStreamSetCallback(DMA_MEM_STREAM, memStreamEvent, NULL);
+#if DMA_MEM_BENCHMARK
+	dmaMemCalibrate();
+#endif
+}
+
+
+
+/*
+ * @brief	Copy @p len bytes from @p src to @p dst (the blocks must not overlap)
+ *
+ * 			Below the crossover memcpy() does it and @p callback runs before the return.
+ * 			Otherwise the buffers must stay untouched until @p callback has run.
+ *
+ * @return	DMA_ERR_BUSY while the previous request is still moving
+ */
+DMA_Status_t dmaMemcpy(void* dst, const void* src, uint32_t len, DMA_MemCallback_t callback, void* context){
+	if(dst == NULL || src == NULL || len == 0) return DMA_ERR_PARAM;
+
+	if(len < crossover){
+		memcpy(dst, src, len);
+		if(callback != NULL) callback(DMA_OK, context);
+		return DMA_OK;
+	}
+	return submit(dst, src, 0, len, callback, context);
+}
+
+
+
+/*
+ * @brief	Fill @p len bytes at @p dst with @p value, like dmaMemcpy()
+ */
+DMA_Status_t dmaMemset(void* dst, uint8_t value, uint32_t len, DMA_MemCallback_t callback, void* context){
+	if(dst == NULL || len == 0) return DMA_ERR_PARAM;
+
+	if(len < crossover){
+		memset(dst, value, len);
+		if(callback != NULL) callback(DMA_OK, context);
+		return DMA_OK;
+	}
+	return submit(dst, NULL, value, len, callback, context);
+}
+
+
+
+bool dmaMemBusy(void){
+	return jobBusy;
+}
+
+
+
+/* @brief	Blocking: until the request in flight has completed */
+void dmaMemWait(void){
+	while(jobBusy);
+}
+
+
+
+/* @brief	Requests shorter than this many bytes are done by the CPU */
+uint32_t dmaMemCrossover(void){
+	return crossover;
+}
+
+
+
+#if DMA_MEM_BENCHMARK
+static void benchComplete(DMA_Status_t status, void* context){
+	(void)status;
+	(void)context;
+	benchDoneAt = CYCLE_COUNT();
+}
+
+
+/*
+ * @brief	Best of DMA_MEM_BENCH_ROUNDS copies of @p size bytes, CPU and DMA
+ */
+static void measure(uint32_t size, DMA_MemBench_t* out){
+	out -> size = size;
+	out -> cpuCycles = UINT32_MAX;
+	out -> dmaCycles = UINT32_MAX;
+	out -> setupCycles = UINT32_MAX;
+
+	for(uint8_t round = 0; round < DMA_MEM_BENCH_ROUNDS; round++){
+		uint32_t start = CYCLE_COUNT();
+		memcpy(benchBuf[1], benchBuf[0], size);
+		uint32_t cpu = CYCLE_COUNT() - start;
+
+		dmaMemWait();
+		start = CYCLE_COUNT();
+		if(submit(benchBuf[1], benchBuf[0], 0, size, benchComplete, NULL) != DMA_OK) return;
+		uint32_t setup = CYCLE_COUNT() - start;
+		dmaMemWait();
+		uint32_t dma = benchDoneAt - start;
+
+		if(cpu < out -> cpuCycles) out -> cpuCycles = cpu;
+		if(dma < out -> dmaCycles) out -> dmaCycles = dma;
+		if(setup < out -> setupCycles) out -> setupCycles = setup;
+	}
+}
+
+
+
+/*
+ * @brief	Crossover: the smallest power-of-two block from 16 bytes up that DMA copies sooner
+ * 			than memcpy(). If memcpy() always wins, DMA still takes blocks of
+ * 			DMA_MEM_BENCH_MAX and up, where freeing the CPU matters more than the latency.
+ */
+void dmaMemCalibrate(void){
+	DMA_MemBench_t sample;
+	uint32_t found = DMA_MEM_BENCH_MAX;
+
+	for(uint32_t size = 16U; size <= DMA_MEM_BENCH_MAX; size <<= 1){
+		measure(size, &sample);
+		if(sample.dmaCycles < sample.cpuCycles){
+			found = size;
+			break;
+		}
+	}
+	crossover = found;
+	LOG_I(DMA, "mem: crossover %u bytes", crossover);
+}
+
+
+
+/*
+ * @brief	CPU against DMA copy at DMA_MEM_BENCH_SIZES block sizes, always through the stream
+ *
+ * @note	Blocks while it runs; uses the stream, so nothing else may be in flight
+ */
+void dmaMemBenchmark(DMA_MemBench_t result[DMA_MEM_BENCH_SIZES]){
+	for(uint8_t i = 0; i < DMA_MEM_BENCH_SIZES; i++){
+		measure(16U << (2U * i), &result[i]); //16, 64, 256, 1024, 4096
+	}
+}
+#endif
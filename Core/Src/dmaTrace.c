@@ -0,0 +1,315 @@
+/*
+ * dmaTrace.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * DMA transfer tracing and utilisation statistics
+ * 		The hooks run in the stream interrupts as well as in thread mode, so every update of
+ * 		the shared state is made with interrupts masked. A controller counts as busy while at
+ * 		least one of its streams has a timed one-shot transfer in flight: circular and
+ * 		double-buffered streams are always in flight and would keep it at 100%.
+ */
+
+#include "dmaTrace.h"
+
+#if DMA_TRACE
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+#define DMA_TRACE_ERRORS	(DMA_FLAG_TE | DMA_FLAG_DME | DMA_FLAG_FE)
+
+typedef struct{
+	bool active;
+	bool timed;				//The stream has a TC interrupt, so its end will be seen
+	bool oneShot;			//Timed and neither circular nor double-buffered: counts for the controller
+	uint32_t startAt;
+	uint32_t busyFrom;		//startAt, or the last reset if that came later
+	uint32_t passBytes;
+
+	uint32_t transfers;
+	uint32_t bytes;
+	uint32_t latencyCount;
+	uint64_t latencySum;
+	uint32_t latencyMax;
+	uint64_t busyCycles;
+	uint32_t te;
+	uint32_t dme;
+	uint32_t fe;
+	uint32_t stopped;
+}traceStream_t;
+
+typedef struct{
+	uint8_t active;			//Streams with a one-shot transfer in flight
+	uint32_t busyFrom;
+	uint64_t busyCycles;
+}traceController_t;
+
+static traceStream_t streams[DMA_STREAM_COUNT];
+static traceController_t controllers[2];
+static DMA_TraceRecord_t ring[DMA_TRACE_DEPTH];
+static uint32_t recorded = 0;
+static uint32_t resetTick = 0;
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+
+/* Interrupts masked */
+static void record(DMA_Stream_t stream, DMA_TraceEvent_t event, uint32_t startAt, uint32_t endAt,
+				   uint32_t bytes, uint32_t flags){
+	DMA_TraceRecord_t* r = &ring[recorded & (DMA_TRACE_DEPTH - 1U)];
+	r -> startAt = startAt;
+	r -> endAt = endAt;
+	r -> bytes = bytes;
+	r -> stream = stream;
+	r -> event = event;
+	r -> flags = (uint8_t)flags;
+	recorded++;
+}
+
+
+/* Interrupts masked */
+static void traceOpen(DMA_Stream_t stream, uint32_t now, uint32_t bytes, bool timed, bool continuous){
+	traceStream_t* s = &streams[stream];
+	s -> active = true;
+	s -> timed = timed;
+	s -> oneShot = timed && !continuous;
+	s -> startAt = now;
+	s -> busyFrom = now;
+	s -> passBytes = bytes;
+	if(!s -> oneShot) return;
+
+	traceController_t* c = &controllers[DMA_STREAM_DMA(stream)];
+	if(c -> active++ == 0) c -> busyFrom = now;
+}
+
+
+/* Interrupts masked. An untimed close has no latency and no busy time */
+static void traceClose(DMA_Stream_t stream, DMA_TraceEvent_t event, uint32_t now, uint32_t bytes, uint32_t flags){
+	traceStream_t* s = &streams[stream];
+	s -> active = false;
+	s -> transfers++;
+	s -> bytes += bytes;
+	if(event == DMA_TRACE_STOPPED) s -> stopped++;
+	record(stream, event, s -> startAt, now, bytes, flags);
+	if(!s -> timed) return;
+
+	s -> busyCycles += now - s -> busyFrom;
+	if(event == DMA_TRACE_DONE){
+		uint32_t latency = now - s -> startAt;
+		s -> latencyCount++;
+		s -> latencySum += latency;
+		if(latency > s -> latencyMax) s -> latencyMax = latency;
+	}
+	if(!s -> oneShot) return;
+
+	traceController_t* c = &controllers[DMA_STREAM_DMA(stream)];
+	if(--c -> active == 0) c -> busyCycles += now - c -> busyFrom;
+}
+
+
+static uint64_t windowCycles(void){
+	uint64_t cycles = (uint64_t)(getTick() - resetTick) * (RCC_getHCLKFreq() / 1000U);
+	return (cycles != 0) ? cycles : 1U;
+}
+
+
+static uint16_t permille(uint64_t busy){
+	uint64_t value = (busy * 1000U) / windowCycles();
+	return (value > 1000U) ? 1000U : (uint16_t)value; //A transfer can straddle the reset
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Hooks (dma.c)
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	@p stream was enabled for @p bytes (per buffer when double-buffered)
+ *
+ * 			A transfer still open here finished without its TC being seen: the stream is
+ * 			polled, or its flags were cleared before the interrupt ran.
+ */
+void dmaTraceStart(DMA_Stream_t stream, uint32_t bytes, bool timed, bool continuous){
+	if(stream >= DMA_STREAM_COUNT) return;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t now = CYCLE_COUNT();
+
+	if(streams[stream].active) traceClose(stream, DMA_TRACE_UNTIMED, now, streams[stream].passBytes, 0);
+	traceOpen(stream, now, bytes, timed, continuous);
+	__set_PRIMASK(primask);
+}
+
+
+
+/*
+ * @brief	The stream interrupt saw @p flags; @p running: EN is still set (circular, double
+ * 			buffer, or an error that did not stop the stream)
+ */
+void dmaTraceEvent(DMA_Stream_t stream, uint32_t flags, bool running, uint32_t remainingBytes){
+	if(stream >= DMA_STREAM_COUNT) return;
+	traceStream_t* s = &streams[stream];
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t now = CYCLE_COUNT();
+
+	if(flags & DMA_FLAG_TE) s -> te++;
+	if(flags & DMA_FLAG_DME) s -> dme++;
+	if(flags & DMA_FLAG_FE) s -> fe++;
+
+	if(!s -> active){
+		if(flags & DMA_TRACE_ERRORS) record(stream, DMA_TRACE_ERROR, now, now, 0, flags);
+	}
+	else if(flags & DMA_FLAG_TC){
+		uint32_t bytes = s -> passBytes;
+		bool timed = s -> timed;
+		traceClose(stream, DMA_TRACE_DONE, now, bytes, flags);
+		if(running) traceOpen(stream, now, bytes, timed, true); //The next pass started with this TC
+	}
+	else if(flags & DMA_TRACE_ERRORS){
+		if(running) record(stream, DMA_TRACE_ERROR, s -> startAt, now, 0, flags);
+		else traceClose(stream, DMA_TRACE_ERROR, now, s -> passBytes - remainingBytes, flags);
+	}
+	__set_PRIMASK(primask);
+}
+
+
+
+/*
+ * @brief	dmaStreamStop() has disabled the stream; @p wasRunning: EN was still set when it was called
+ */
+void dmaTraceStop(DMA_Stream_t stream, bool wasRunning, uint32_t remainingBytes){
+	if(stream >= DMA_STREAM_COUNT) return;
+	traceStream_t* s = &streams[stream];
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	if(s -> active){
+		traceClose(stream, wasRunning ? DMA_TRACE_STOPPED : DMA_TRACE_UNTIMED, CYCLE_COUNT(),
+				   s -> passBytes - remainingBytes, 0);
+	}
+	__set_PRIMASK(primask);
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Start a new statistics window; the ring and transfers in flight are kept
+ */
+void dmaTraceReset(void){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t now = CYCLE_COUNT();
+
+	for(uint8_t i = 0; i < DMA_STREAM_COUNT; i++){
+		traceStream_t* s = &streams[i];
+		s -> transfers = 0;
+		s -> bytes = 0;
+		s -> latencyCount = 0;
+		s -> latencySum = 0;
+		s -> latencyMax = 0;
+		s -> busyCycles = 0;
+		s -> te = 0;
+		s -> dme = 0;
+		s -> fe = 0;
+		s -> stopped = 0;
+		s -> busyFrom = now;
+	}
+	for(uint8_t i = 0; i < 2U; i++){
+		controllers[i].busyCycles = 0;
+		controllers[i].busyFrom = now;
+	}
+	resetTick = getTick();
+	__set_PRIMASK(primask);
+}
+
+
+
+/*
+ * @brief	@p stream since the last dmaTraceReset(), the transfer in flight included
+ */
+void dmaTraceStats(DMA_Stream_t stream, DMA_TraceStats_t* out){
+	if(stream >= DMA_STREAM_COUNT || out == NULL) return;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	traceStream_t s = streams[stream];
+	uint32_t now = CYCLE_COUNT();
+	__set_PRIMASK(primask);
+
+	if(s.active && s.timed) s.busyCycles += now - s.busyFrom;
+
+	out -> transfers = s.transfers;
+	out -> bytes = s.bytes;
+	out -> latencyAvg = (s.latencyCount != 0) ? (uint32_t)(s.latencySum / s.latencyCount) : 0;
+	out -> latencyMax = s.latencyMax;
+	out -> busyPermille = permille(s.busyCycles);
+	out -> te = s.te;
+	out -> dme = s.dme;
+	out -> fe = s.fe;
+	out -> stopped = s.stopped;
+	out -> active = s.active;
+}
+
+
+
+/*
+ * @brief	Per mille of the window with at least one timed one-shot transfer in flight on @p dma
+ */
+uint16_t dmaTraceControllerBusy(DMA_Name_t dma){
+	if(dma > my_DMA2) return 0;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint64_t busy = controllers[dma].busyCycles;
+	if(controllers[dma].active != 0) busy += CYCLE_COUNT() - controllers[dma].busyFrom;
+	__set_PRIMASK(primask);
+
+	return permille(busy);
+}
+
+
+
+uint32_t dmaTraceWindowMs(void){
+	return getTick() - resetTick;
+}
+
+
+
+/*
+ * @brief	Copy the record @p age transfers back (0: the latest) to @p out
+ *
+ * @return	false once @p age goes past what the ring still holds
+ */
+bool dmaTraceRecord(uint8_t age, DMA_TraceRecord_t* out){
+	if(out == NULL) return false;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	bool held = (age < DMA_TRACE_DEPTH) && (age < recorded);
+	if(held) *out = ring[(recorded - 1U - age) & (DMA_TRACE_DEPTH - 1U)];
+	__set_PRIMASK(primask);
+	return held;
+}
+
+
+
+/* @brief	Records written since boot, overwritten ones included */
+uint32_t dmaTraceRecorded(void){
+	return recorded;
+}
+#endif
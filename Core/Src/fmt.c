@@ -0,0 +1,221 @@
+/*
+ * fmt.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Allocation-free number formatting
+ * 		No heap, no varargs, no format string parsing: each call converts one value straight
+ * 		into the caller's buffer. Floats are split into integer and fraction parts with one
+ * 		float multiply and add (on the FPU), then printed as two integers, so newlib's float
+ * 		printf is not needed for logging.
+ */
+
+#include "fmt.h"
+
+#if FMT_BENCHMARK
+#include <stdio.h>
+#include "timer.h"
+#endif
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+static const uint32_t pow10Table[FMT_MAX_DECIMALS + 1] = {
+	1U, 10U, 100U, 1000U, 10000U, 100000U, 1000000U, 10000000U, 100000000U, 1000000000U
+};
+
+
+/*
+ * @brief	Decimal digits of @p value, left-padded with '0' up to @p minDigits. No terminator
+ */
+static uint8_t writeDigits(char* out, uint32_t value, uint8_t minDigits){
+	char tmp[10];
+	uint8_t n = 0;
+
+	do{
+		tmp[n++] = (char)('0' + value % 10U);
+		value /= 10U;
+	}while(value != 0);
+
+	while(n < minDigits && n < sizeof tmp) tmp[n++] = '0';
+
+	for(uint8_t i = 0; i < n; i++){
+		out[i] = tmp[n - 1U - i]; //Digits were produced least significant first
+	}
+	return n;
+}
+
+
+/* @brief	|value| without the INT32_MIN overflow */
+static inline uint32_t absU32(int32_t value){
+	return (value < 0) ? (uint32_t)(-(value + 1)) + 1U : (uint32_t)value;
+}
+
+
+static uint8_t copyText(char* out, const char* text){
+	uint8_t n = 0;
+	while(text[n] != '\0'){
+		out[n] = text[n];
+		n++;
+	}
+	out[n] = '\0';
+	return n;
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+uint8_t fmtU32(char* out, uint32_t value){
+	uint8_t n = writeDigits(out, value, 1);
+	out[n] = '\0';
+	return n;
+}
+
+
+
+uint8_t fmtI32(char* out, int32_t value){
+	uint8_t n = 0;
+	if(value < 0) out[n++] = '-';
+	n += writeDigits(out + n, absU32(value), 1);
+	out[n] = '\0';
+	return n;
+}
+
+
+
+/*
+ * @brief	Upper-case hex with "0x" prefix
+ *
+ * @param	digits	Fixed width 1..8, 0 for as few digits as needed
+ */
+uint8_t fmtHex32(char* out, uint32_t value, uint8_t digits){
+	static const char hexDigits[] = "0123456789ABCDEF";
+
+	if(digits == 0){
+		digits = 1;
+		while(digits < 8U && (value >> (digits * 4U)) != 0) digits++;
+	}
+	if(digits > 8U) digits = 8U;
+
+	out[0] = '0';
+	out[1] = 'x';
+	for(uint8_t i = 0; i < digits; i++){
+		out[2U + i] = hexDigits[(value >> ((digits - 1U - i) * 4U)) & 0xFU];
+	}
+	out[2U + digits] = '\0';
+	return (uint8_t)(2U + digits);
+}
+
+
+
+/*
+ * @brief	Fixed-point value scaled by 10^decimals, e.g. fmtFixed(out, 2345, 2) -> "23.45"
+ */
+uint8_t fmtFixed(char* out, int32_t value, uint8_t decimals){
+	if(decimals > FMT_MAX_DECIMALS) decimals = FMT_MAX_DECIMALS;
+
+	uint32_t magnitude = absU32(value);
+	uint8_t n = 0;
+
+	if(value < 0) out[n++] = '-';
+	n += writeDigits(out + n, magnitude / pow10Table[decimals], 1);
+
+	if(decimals > 0){
+		out[n++] = '.';
+		n += writeDigits(out + n, magnitude % pow10Table[decimals], decimals);
+	}
+	out[n] = '\0';
+	return n;
+}
+
+
+
+/*
+ * @brief	Float with @p decimals digits after the point (0..9), rounded half away from zero
+ *
+ * @note	Magnitudes of 2^32 and above print as "ovf": logging values never get there
+ * 			and the integer part stays in one 32-bit division chain
+ */
+uint8_t fmtFloat(char* out, float value, uint8_t decimals){
+	if(value != value) return copyText(out, "nan");
+	if(decimals > FMT_MAX_DECIMALS) decimals = FMT_MAX_DECIMALS;
+
+	bool negative = (value < 0.0f);
+	float magnitude = negative ? -value : value;
+	if(magnitude >= 4294967040.0f) return copyText(out, negative ? "-ovf" : "ovf"); //Largest float below 2^32
+
+	uint32_t intPart = (uint32_t)magnitude;
+	uint32_t scale = pow10Table[decimals];
+	uint32_t fracPart = (uint32_t)((magnitude - (float)intPart) * (float)scale + 0.5f);
+	if(fracPart >= scale){ //Rounding carried into the integer part (9.996 -> "10.00")
+		fracPart -= scale;
+		intPart++;
+	}
+
+	uint8_t n = 0;
+	if(negative && (intPart != 0 || fracPart != 0)) out[n++] = '-';
+	n += writeDigits(out + n, intPart, 1);
+
+	if(decimals > 0){
+		out[n++] = '.';
+		n += writeDigits(out + n, fracPart, decimals);
+	}
+	out[n] = '\0';
+	return n;
+}
+
+
+
+#if FMT_BENCHMARK
+/*
+ * @brief	Cycle cost of fmtI32/fmtFloat against snprintf("%ld")/snprintf("%.2f")
+ * 			Each call is timed alone with interrupts masked, so ISRs never land in a sample
+ *
+ * @note	Needs cycleCounterInit()
+ */
+void fmtBenchmark(FMT_Bench_t* result){
+	char buf[FMT_BUF_SIZE];
+	volatile uint32_t sink = 0; //Keeps the calls from being optimised away
+	uint64_t total[4] = {0};
+
+	for(uint32_t i = 0; i < FMT_BENCH_ROUNDS; i++){
+		int32_t intValue = (int32_t)(i * 2654435761U) >> 4; //Spread over the int32 range
+		float floatValue = (float)intValue / 1000.0f;
+		uint32_t start;
+
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+
+		start = CYCLE_COUNT();
+		sink += fmtI32(buf, intValue);
+		total[0] += CYCLE_COUNT() - start;
+
+		start = CYCLE_COUNT();
+		sink += (uint32_t)snprintf(buf, sizeof buf, "%ld", (long)intValue);
+		total[1] += CYCLE_COUNT() - start;
+
+		start = CYCLE_COUNT();
+		sink += fmtFloat(buf, floatValue, 2);
+		total[2] += CYCLE_COUNT() - start;
+
+		start = CYCLE_COUNT();
+		sink += (uint32_t)snprintf(buf, sizeof buf, "%.2f", floatValue);
+		total[3] += CYCLE_COUNT() - start;
+
+		__set_PRIMASK(primask);
+	}
+	(void)sink;
+
+	result -> fmtI32 = (uint32_t)(total[0] / FMT_BENCH_ROUNDS);
+	result -> snprintfI32 = (uint32_t)(total[1] / FMT_BENCH_ROUNDS);
+	result -> fmtFloat = (uint32_t)(total[2] / FMT_BENCH_ROUNDS);
+	result -> snprintfFloat = (uint32_t)(total[3] / FMT_BENCH_ROUNDS);
+}
+#endif
@@ -0,0 +1,235 @@
+/*
+ * fwChain.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Daisy-chain firmware distribution
+ * 		A board that receives an image on FW_CHAIN_SOURCE_UART forwards it on FW_CHAIN_UART
+ * 		to the next board using the same protocol ("Update firmware\n" followed by the raw image).
+ * 		Forwarding is done block by block while the image is still arriving, so a chain of N boards
+ * 		updates in one transfer time plus N block delays.
+ *
+ * 		A block is forwarded only once every byte of it has landed in RAM and the source link
+ * 		counted no parity/framing/noise/overrun error up to that point. The first line error
+ * 		aborts the chain: the downstream board never receives a full image, so it never flashes.
+ * 		Nothing tells it so, and it has no receive timeout: it stays in update mode until reset.
+ */
+
+#include "fwChain.h"
+#include "log.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+static bool chainReady = false;
+static volatile FW_Chain_State_t chainState = FW_CHAIN_IDLE;
+static volatile bool imageComplete = false;
+
+static const char* chainImage = NULL;
+static uint32_t chainImageSize = 0;
+static uint32_t chainForwarded = 0; //Bytes already handed to DMA2 Stream 6
+static uint32_t chainErrorBase = 0; //Source link error count when the image started
+static uint32_t chainSyncTick = 0; //Last tick the sync character was still in the TX ring
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Number of image bytes the source link's RX stream has already written into the image buffer
+ *
+ * @note	The stream is circular: NDTR reloads to the full size as the last byte lands, before
+ * 			the TC interrupt has set imageComplete. A full NDTR after bytes were forwarded is the end.
+ */
+static uint32_t bytesReceived(void){
+	if(imageComplete) return chainImageSize;
+	uint32_t received = chainImageSize - uartRxDmaRemaining(FW_CHAIN_SOURCE_UART);
+	if(received == 0 && chainForwarded != 0) return chainImageSize;
+	return received;
+}
+
+
+/*
+ * @brief	Push @p len bytes starting at @p src to USART6 through DMA2 Stream 6
+ * 			The stream runs in normal mode: EN is cleared by hardware once NDTR reaches 0
+ */
+static void startBlockTransfer(const char* src, uint32_t len){
+	(void)dmaStreamStart(FW_CHAIN_TX_STREAM, src, (uint16_t)len); //Clears the stale stream 6 flags first
+}
+
+
+static inline bool blockTransferBusy(void){
+	return dmaStreamBusy(FW_CHAIN_TX_STREAM);
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Bring up the downstream link: USART6 on PC6/PC7 and DMA2-Stream6-Channel5 for its TX
+ *
+ * @note	Same framing as the command link in main() (9600 baud, odd parity, 9-bit word)
+ */
+void fwChainInit(void){
+	UART_Init(my_GPIO_PIN_6,
+			  my_GPIO_PIN_7,
+			  my_GPIOC,
+			  FW_CHAIN_UART,
+			  9600,
+			  PARITY_ODD,
+			  _9B_WORDLENGTH,
+			  UART_FLOW_NONE);
+	writeUART(5, FW_CHAIN_UART, UART_CR1, RESET); //Nothing is expected back from downstream
+
+	/*
+	 * According to DMA2 request mapping
+	 * 		Choose Stream 6, channel 5 for USART6_TX
+	 */
+	DMA_StreamConfig_t config = {
+			.channel = 5,
+			.dir = DMA_DIR_M2P,
+			.periphWidth = DMA_WIDTH_8, //The 9th bit is the parity bit
+			.memWidth = DMA_WIDTH_8,
+			.memInc = true,
+			.circular = false, //Normal mode, one block per start
+			.priority = UART_DMA_TX_PRIORITY,
+			.irqFlags = 0, //Polled from fwChainPoll()
+			.periphAddr = (uint32_t)UART6_GET_REG(UART_DR), //Receiver is USART6 DR
+	};
+	(void)dmaStreamConfigure(FW_CHAIN_TX_STREAM, &config);
+
+	writeUART(7, FW_CHAIN_UART, UART_CR3, SET); //Enable DMA for transmission
+
+	chainReady = true;
+}
+
+
+
+/*
+ * @brief	Arm the chain for a new image. Called when this board itself enters update mode
+ *
+ * @param	image		Buffer DMA2 Stream 2 is filling with the incoming image
+ * @param	imageSize	Expected image size in bytes
+ */
+void fwChainStart(const char* image, uint32_t imageSize){
+	if(!chainReady) return;
+
+	chainImage = image;
+	chainImageSize = imageSize;
+	chainForwarded = 0;
+	imageComplete = false;
+
+	chainErrorBase = uartErrorCount(FW_CHAIN_SOURCE_UART); //Errors of the command phase do not count
+	chainState = FW_CHAIN_SYNC;
+}
+
+
+
+/*
+ * @brief	Tell the chain the last image byte has arrived (DMA2 Stream 2 transfer complete)
+ */
+void fwChainReceiveComplete(void){
+	imageComplete = true;
+}
+
+
+
+/*
+ * @brief	Forward every block that is fully received and verified. Never blocks on the image,
+ * 			only on the short "Update firmware" announcement.
+ *
+ * 			The announcement waits FW_CHAIN_SYNC_GAP_MS after the sync character has left, so an
+ * 			autobauding downstream board has its receiver back on before the 'U' of "Update".
+ */
+void fwChainPoll(void){
+	switch(chainState){
+		case FW_CHAIN_SYNC:
+			uartPrintLog(FW_CHAIN_UART, FW_CHAIN_SYNC_CHAR);
+			chainSyncTick = getTick();
+			chainState = FW_CHAIN_ANNOUNCE;
+			return;
+
+		case FW_CHAIN_ANNOUNCE:
+			if(uartTxPending(FW_CHAIN_UART) != 0){
+				chainSyncTick = getTick(); //The gap starts once the sync character is out
+				return;
+			}
+			if((getTick() - chainSyncTick) < FW_CHAIN_SYNC_GAP_MS) return;
+			uartPrintLog(FW_CHAIN_UART, FW_CHAIN_START_CMD); //Next board switches its receiver to DMA
+			chainState = FW_CHAIN_FORWARDING;
+			return;
+
+		case FW_CHAIN_FORWARDING:
+			break;
+
+		default: return;
+	}
+
+	if(blockTransferBusy()) return;
+	if(uartTxPending(FW_CHAIN_UART) != 0) return; //Announcement still draining through the TX ring
+
+	/*
+	 * Error count must be read before NDTR: the error interrupt of a byte counted below
+	 * has then already run
+	 */
+	if(uartErrorCount(FW_CHAIN_SOURCE_UART) != chainErrorBase){
+		chainState = FW_CHAIN_ABORTED;
+		LOG_E(FWCHAIN, "aborted on a line error, %u of %u bytes forwarded, reset the downstream board",
+			  chainForwarded, chainImageSize);
+		return;
+	}
+
+	uint32_t received = bytesReceived();
+	uint32_t pending = (received > chainForwarded) ? received - chainForwarded : 0;
+	if(pending > chainImageSize - chainForwarded) pending = chainImageSize - chainForwarded; //Never past the image
+
+	if(pending >= FW_CHAIN_BLOCK_SIZE || (imageComplete && pending > 0)){
+		uint32_t len = (pending > FW_CHAIN_BLOCK_SIZE) ? FW_CHAIN_BLOCK_SIZE : pending;
+		startBlockTransfer(chainImage + chainForwarded, len);
+		chainForwarded += len;
+		return;
+	}
+
+	/* Whole image handed over: done once the last byte has left the shift register */
+	if(imageComplete && chainForwarded == chainImageSize &&
+	  (readUART(6, FW_CHAIN_UART, UART_SR) & 1) == 1){
+		chainState = FW_CHAIN_DONE;
+		LOG_I(FWCHAIN, "%u bytes forwarded", chainForwarded);
+	}
+}
+
+
+
+/*
+ * @brief	Blocking: forward whatever is left of the image before this board erases its own flash
+ */
+void fwChainFlush(void){
+	while(fwChainBusy()){
+		fwChainPoll();
+	}
+}
+
+
+
+bool fwChainBusy(void){
+	return (chainState == FW_CHAIN_SYNC) || (chainState == FW_CHAIN_ANNOUNCE) ||
+		   (chainState == FW_CHAIN_FORWARDING);
+}
+
+
+
+FW_Chain_State_t fwChainState(void){
+	return chainState;
+}
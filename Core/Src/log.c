@@ -0,0 +1,103 @@
+/*
+ * log.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Runtime side of the leveled logger (log.h): per-module levels and their names
+ */
+
+#include "log.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+
+/* Read inline by every LOG_x() site, hence not static */
+uint8_t logLevel[LOG_MOD_COUNT] = {
+	[0 ... LOG_MOD_COUNT - 1] = LOG_DEFAULT_LEVEL
+};
+
+static const char* const moduleNames[LOG_MOD_COUNT] = {
+	[LOG_MOD_APP]		= "app",
+	[LOG_MOD_UART]		= "uart",
+	[LOG_MOD_CLI]		= "cli",
+	[LOG_MOD_FWCHAIN]	= "fwchain",
+	[LOG_MOD_TELEMETRY]	= "telemetry",
+	[LOG_MOD_DMA]		= "dma",
+};
+
+static const char* const levelNames[] = {
+	[LOG_LEVEL_OFF]		= "off",
+	[LOG_LEVEL_ERROR]	= "error",
+	[LOG_LEVEL_WARN]	= "warn",
+	[LOG_LEVEL_INFO]	= "info",
+	[LOG_LEVEL_DEBUG]	= "debug",
+};
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Runtime level of one module. Levels above LOG_COMPILE_LEVEL are accepted
+ * 			but have nothing to enable: those sites were never compiled
+ */
+void logSetLevel(Log_Module_t module, uint8_t level){
+	if(module >= LOG_MOD_COUNT || level > LOG_LEVEL_DEBUG) return;
+	logLevel[module] = level;
+}
+
+
+
+uint8_t logGetLevel(Log_Module_t module){
+	return (module < LOG_MOD_COUNT) ? logLevel[module] : LOG_LEVEL_OFF;
+}
+
+
+
+const char* logModuleName(Log_Module_t module){
+	return (module < LOG_MOD_COUNT) ? moduleNames[module] : "?";
+}
+
+
+
+const char* logLevelName(uint8_t level){
+	return (level <= LOG_LEVEL_DEBUG) ? levelNames[level] : "?";
+}
+
+
+
+/*
+ * @brief	Console name ("uart", "fwchain", ...) to module
+ */
+bool logParseModule(const char* name, Log_Module_t* out){
+	for(uint8_t i = 0; i < LOG_MOD_COUNT; i++){
+		if(strcmp(name, moduleNames[i]) == 0){
+			*out = (Log_Module_t)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+/*
+ * @brief	Console name ("off", "error", "warn", "info", "debug") to level
+ */
+bool logParseLevel(const char* name, uint8_t* out){
+	for(uint8_t i = 0; i <= LOG_LEVEL_DEBUG; i++){
+		if(strcmp(name, levelNames[i]) == 0){
+			*out = i;
+			return true;
+		}
+	}
+	return false;
+}
@@ -14,83 +14,394 @@
 #include "led.h"
 #include "uart.h"
 #include "dma.h"
+#include "dmaMem.h"
+#include "dmaBench.h"
+#include "dmaTrace.h"
 #include "adc.h"
 #include "flash.h"
+#include "fwChain.h"
+#include "cli.h"
+#include "cliTrace.h"
+#include "telemetry.h"
+#include "mux.h"
+#include "log.h"
+#include "autobaud.h"
+#include "waveform.h"
 
 /* ------------------------------------------------------------------------------------ */
 char rxBuf[17992];
 volatile bool updateFirmware = false;
-void DMA2_Stream2_IRQHandler(void){
-	/* Clear all the flags */
-	writeDMA2(21, DMA_LIFCR, SET); //Clear transfer completed interrupt flag of stream 2
-	updateFirmware = true;
+
+/*
+ * @brief	USART1 receive events. Frames are left in the RX ring for cliPoll();
+ * 			only the end of the firmware image needs attention here
+ */
+static void commandLinkEvent(UART_Name_t uartName, UART_RxEvent_t event, uint32_t len){
+	(void)uartName;
+	if(event == UART_RX_FRAME){
+		cliTraceRxFrame(len); //Dates the first byte of the line for the latency tracer
+	}
+	else if(event == UART_RX_BLOCK_COMPLETE){
+		fwChainReceiveComplete();
+		updateFirmware = true;
+	}
+}
+
+
+
+/*
+ * @brief	Control channel of the mux: each frame is one command line for the CLI
+ */
+static void controlChannelEvent(MUX_Channel_t channel, const uint8_t* payload, uint16_t len){
+	(void)channel;
+	cliExecute((const char*)payload, len);
 }
 
 
 
 /*------------------------------------------------------------ */
-static volatile bool rxIndicator = false;
-char rxMessage[25];
-int idx = 0;
-void USART1_IRQHandler(void){
-	if((readUART(5, my_UART1, UART_SR) & 1) == 1){
-		rxIndicator = true;
-	}
+static void cmdOrangeLedOn(const CLI_Args_t* args){
+	ledControl(LED_ORANGE, ON);
+	uartPrintLog(my_UART1, "--> ORANGE LED ON\n");
+}
 
-	/*
-	 * @note	my_UART_Receive clears interrupt itself because:
-	 * 				In this function, it reads SR then DR
-	 */
-	rxMessage[idx++] = my_UART_Receive(my_UART1);
+static void cmdOrangeLedOff(const CLI_Args_t* args){
+	ledControl(LED_ORANGE, OFF);
+	uartPrintLog(my_UART1, "--> ORANGE LED OFF\n");
+}
 
-	if(strstr(rxMessage, "\n")){
-		if(strstr(rxMessage, "Orange led on")){
-			ledControl(LED_ORANGE, ON);
-			uartPrintLog(my_UART1, "--> ORANGE LED ON\n");
-		}
-		else if(strstr(rxMessage, "Orange led off")){
-			ledControl(LED_ORANGE, OFF);
-			uartPrintLog(my_UART1, "--> ORANGE LED OFF\n");
-		}
-		else if(strstr(rxMessage, "Update firmware")){
-			writeUART(5, my_UART1, UART_CR1, RESET); //Clear RXNEIE
-			UART1_DMA_Receiver_Init(rxBuf, sizeof rxBuf);
-			uartPrintLog(my_UART1, "--> UPDATING FIRMWARE");
+static void cmdUpdateFirmware(const CLI_Args_t* args){
+	UART_DMA_Receiver_Init(my_UART1, rxBuf, sizeof rxBuf); //Stops the command ring and IDLE interrupt
+	fwChainStart(rxBuf, sizeof rxBuf); //Pass the image on to the next board while it arrives
+	uartPrintLog(my_UART1, "--> UPDATING FIRMWARE");
+}
+
+static void cmdTelemetryAscii(const CLI_Args_t* args){
+	telemetrySetMode(TELEMETRY_ASCII);
+	uartPrintLog(my_UART1, "--> TELEMETRY ASCII\n");
+}
+
+static void cmdTelemetryBinary(const CLI_Args_t* args){
+	uartPrintLog(my_UART1, "--> TELEMETRY BINARY\n"); //Last ASCII line before the frames start
+	telemetrySetMode(TELEMETRY_BINARY);
+}
+
+static void cmdMuxOn(const CLI_Args_t* args){
+	uartPrintLog(my_UART1, "--> MUX ON\n"); //Last plain line before the frames start
+	cliSetUartInput(false); //Commands now arrive as control frames
+	muxStart();
+}
+
+static void cmdMuxOff(const CLI_Args_t* args){
+	muxStop(); //Pending control replies leave first
+	cliSetUartInput(true);
+	uartPrintLog(my_UART1, "--> MUX OFF\n");
+}
+
+/*
+ * @brief	"Log" lists every module's level, "Log <module|all> <off|error|warn|info|debug>" sets it
+ */
+static void cmdLog(const CLI_Args_t* args){
+	Log_Module_t module = LOG_MOD_APP;
+	uint8_t level;
+	bool all = (args -> argc == 2) && strcmp(args -> argv[0], "all") == 0;
+
+	if(args -> argc == 2){
+		if((!all && !logParseModule(args -> argv[0], &module)) || !logParseLevel(args -> argv[1], &level)){
+			uartPrintLog(my_UART1, "--> INVALID ARGUMENTS\n");
+			return;
 		}
-		else{
-			uartPrintLog(my_UART1, "--> COMMAND NOT FOUND\n");
+		for(uint8_t i = 0; i < LOG_MOD_COUNT; i++){
+			if(all || i == module) logSetLevel((Log_Module_t)i, level);
 		}
-		memset(rxMessage, 0, sizeof rxMessage);
-		idx = 0;
+	}
+	else if(args -> argc != 0){
+		uartPrintLog(my_UART1, "--> INVALID ARGUMENTS\n");
+		return;
+	}
+
+	for(uint8_t i = 0; i < LOG_MOD_COUNT; i++){
+		uartPrintLog(my_UART1, "--> LOG ");
+		uartPrintLog(my_UART1, (char*)logModuleName((Log_Module_t)i));
+		uartPrintLog(my_UART1, " ");
+		uartPrintLog(my_UART1, (char*)logLevelName(logGetLevel((Log_Module_t)i)));
+		uartPrintLog(my_UART1, "\n");
 	}
 }
 
+static void printStat(const char* label, uint32_t value){
+	uartPrintLog(my_UART1, (char*)label);
+	uartPrintU32(my_UART1, value);
+}
 
+static void cmdStats(const CLI_Args_t* args){
+	static const char* const uartLabel[UART_COUNT] = {"--> UART1", "--> UART2", "--> UART6"};
+	UART_Stats_t stats;
 
-/* ------------------------------------------------------------------------------------ */
-static void uartPrintTemperature(UART_Name_t uartName, float temperatureVal, uint8_t decimals){
-	ledControl(LED_GREEN, ON);
+	for(uint8_t i = 0; i < UART_COUNT; i++){
+		uartGetStats((UART_Name_t)i, &stats);
+		uartPrintLog(my_UART1, (char*)uartLabel[i]);
+		printStat(" IN ", stats.bytesIn);
+		printStat(" OUT ", stats.bytesOut);
+		printStat(" FRAMES ", stats.frames);
+		printStat(" PE ", stats.parityErrors);
+		printStat(" FE ", stats.framingErrors);
+		printStat(" NE ", stats.noiseErrors);
+		printStat(" ORE ", stats.overrunErrors);
+		printStat(" HT ", stats.dmaHalf);
+		printStat(" TC ", stats.dmaFull);
+		printStat(" PEAK ", stats.rxPeak);
+		uartPrintLog(my_UART1, "\n");
+	}
+}
+
+static void cmdStatsReset(const CLI_Args_t* args){
+	for(uint8_t i = 0; i < UART_COUNT; i++){
+		uartResetStats((UART_Name_t)i);
+	}
+	uartPrintLog(my_UART1, "--> STATS CLEARED\n");
+}
+
+/*
+ * @brief	Per-command round trip: stage averages, time inside delay() and blocked on TX, histogram
+ */
+static void cmdLatency(const CLI_Args_t* args){
+	cliTracePrint(my_UART1);
+}
+
+static void cmdLatencyReset(const CLI_Args_t* args){
+	cliTraceReset();
+	uartPrintLog(my_UART1, "--> LATENCY CLEARED\n");
+}
+
+/*
+ * @brief	Measure the console rate again from the next sync character (CR or 'U')
+ */
+static void cmdAutobaud(const CLI_Args_t* args){
+	uartPrintLog(my_UART1, "--> AUTOBAUD, SEND CR\n");
+	uartTxFlush(my_UART1); //Last words at the old rate
+	autobaudStart(my_UART1);
+}
+
+#if FMT_BENCHMARK
+static void printBenchLine(const char* name, uint32_t fmtCycles, uint32_t snprintfCycles){
+	uartPrintLog(my_UART1, (char*)name);
+	uartPrintU32(my_UART1, fmtCycles);
+	uartPrintLog(my_UART1, " CYC, SNPRINTF ");
+	uartPrintU32(my_UART1, snprintfCycles);
+	uartPrintLog(my_UART1, " CYC\n");
+}
+
+static void cmdBenchFmt(const CLI_Args_t* args){
+	FMT_Bench_t bench;
+	fmtBenchmark(&bench);
+	printBenchLine("--> INT32: FMT ", bench.fmtI32, bench.snprintfI32);
+	printBenchLine("--> FLOAT: FMT ", bench.fmtFloat, bench.snprintfFloat);
+}
+#endif
+
+#if DMA_MEM_BENCHMARK
+/*
+ * @brief	Per block size: memcpy() and DMA cycles, DMA bandwidth and the share of the copy time
+ * 			the CPU gets back (everything after dmaMemcpy() returned)
+ */
+static void cmdBenchDma(const CLI_Args_t* args){
+	DMA_MemBench_t result[DMA_MEM_BENCH_SIZES];
+	uint32_t hclkMHz = RCC_getHCLKFreq() / 1000000U;
+	dmaMemBenchmark(result);
+
+	for(uint8_t i = 0; i < DMA_MEM_BENCH_SIZES; i++){
+		printStat("--> DMA ", result[i].size);
+		printStat(" B: CPU ", result[i].cpuCycles);
+		printStat(" CYC, DMA ", result[i].dmaCycles);
+		printStat(" CYC, ", result[i].size * hclkMHz / result[i].dmaCycles); //Bytes per us = MB/s
+		printStat(" MB/S, OFFLOAD ", 100U - (result[i].setupCycles * 100U) / result[i].dmaCycles);
+		uartPrintLog(my_UART1, "%\n");
+	}
+	printStat("--> CROSSOVER ", dmaMemCrossover());
+	uartPrintLog(my_UART1, " B\n");
+}
+#endif
+
+#if DMA_BENCHMARK
+static void printLane(const char* scenario, DMA_BenchLane_t lane, const DMA_BenchLaneStats_t* stats, uint32_t windowCycles){
+	uartPrintLog(my_UART1, (char*)scenario);
+	uartPrintLog(my_UART1, (char*)dmaBenchLaneName(lane));
+	printStat(" ", (uint32_t)(((uint64_t)stats -> bytes * RCC_getHCLKFreq()) / windowCycles));
+	printStat(" B/S, LAT AVG ", stats -> latencyAvg);
+	printStat(" MAX ", stats -> latencyMax);
+	printStat(" CYC, ERR ", stats -> errors);
+	uartPrintLog(my_UART1, "\n");
+}
+
+/*
+ * @brief	Console TX, ADC and memcpy streams on DMA2: each alone, then all at once
+ */
+static void cmdBenchContention(const CLI_Args_t* args){
+	DMA_BenchResult_t result;
+	dmaBenchContention(&result);
+
+	for(uint8_t i = 0; i < DMA_BENCH_LANES; i++){
+		printLane("--> ALONE ", (DMA_BenchLane_t)i, &result.alone[i], result.windowCycles);
+	}
+	for(uint8_t i = 0; i < DMA_BENCH_LANES; i++){
+		printLane("--> SHARED ", (DMA_BenchLane_t)i, &result.shared[i], result.windowCycles);
+	}
+}
+#endif
+
+#if DMA_TRACE
+static void printStreamName(DMA_Stream_t stream){
+	printStat("--> DMA", DMA_STREAM_DMA(stream) + 1U);
+	printStat(" S", DMA_STREAM_NUM(stream));
+}
+
+static void printErrorFlags(uint32_t flags){
+	if(flags & DMA_FLAG_TE) uartPrintLog(my_UART1, " TE");
+	if(flags & DMA_FLAG_DME) uartPrintLog(my_UART1, " DME");
+	if(flags & DMA_FLAG_FE) uartPrintLog(my_UART1, " FE");
+}
+
+/*
+ * @brief	Every stream that moved data since "DMA stats reset": throughput, share of the window
+ * 			with a transfer in flight, start-to-TC latency and errors; then both controllers
+ */
+static void cmdDmaStats(const CLI_Args_t* args){
+	uint32_t cyclesPerUs = RCC_getHCLKFreq() / 1000000U;
+	uint32_t windowMs = dmaTraceWindowMs();
+	uint64_t controllerBytes[2] = {0, 0};
+	if(windowMs == 0) windowMs = 1;
 
-	uartPrintLog(uartName, "\n");
-	uartPrintLog(uartName, "STM32's Temperature: ");
-	uartPrintFloat(uartName, temperatureVal, decimals);
-	uartPrintLog(uartName, "*C");
+	for(uint8_t i = 0; i < DMA_STREAM_COUNT; i++){
+		DMA_TraceStats_t stats;
+		dmaTraceStats((DMA_Stream_t)i, &stats);
+		if(stats.transfers == 0 && !stats.active && (stats.te | stats.dme | stats.fe) == 0) continue;
+		controllerBytes[DMA_STREAM_DMA(i)] += stats.bytes;
 
-	ledControl(LED_GREEN, OFF);
+		printStreamName((DMA_Stream_t)i);
+		printStat(": ", stats.transfers);
+		printStat(" XFER, ", (uint32_t)(((uint64_t)stats.bytes * 1000U) / windowMs));
+		printStat(" B/S, BUSY ", stats.busyPermille / 10U);
+		printStat("%, LAT AVG ", stats.latencyAvg / cyclesPerUs);
+		printStat(" MAX ", stats.latencyMax / cyclesPerUs);
+		uartPrintLog(my_UART1, " US");
+		if(stats.te != 0) printStat(", TE ", stats.te);
+		if(stats.dme != 0) printStat(", DME ", stats.dme);
+		if(stats.fe != 0) printStat(", FE ", stats.fe);
+		if(stats.stopped != 0) printStat(", STOPPED ", stats.stopped);
+		uartPrintLog(my_UART1, "\n");
+	}
+	for(uint8_t dma = my_DMA1; dma <= my_DMA2; dma++){
+		printStat("--> DMA", dma + 1U);
+		printStat(": ", (uint32_t)((controllerBytes[dma] * 1000U) / windowMs));
+		printStat(" B/S, ONE-SHOT BUSY ", dmaTraceControllerBusy((DMA_Name_t)dma) / 10U);
+		printStat("% OF ", windowMs);
+		uartPrintLog(my_UART1, " MS\n");
+	}
 }
 
+static void cmdDmaStatsReset(const CLI_Args_t* args){
+	dmaTraceReset();
+	uartPrintLog(my_UART1, "--> DMA STATS CLEARED\n");
+}
+
+/*
+ * @brief	The trace ring, oldest first. Copied before printing: the console's own transfers
+ * 			would push records out while it prints
+ */
+static void cmdDmaTrace(const CLI_Args_t* args){
+	static const char* const eventNames[] = {" DONE ", " ERROR ", " STOPPED ", " UNTIMED "};
+	static DMA_TraceRecord_t records[DMA_TRACE_DEPTH];
+	uint32_t cyclesPerUs = RCC_getHCLKFreq() / 1000000U;
+	uint8_t held = 0;
+
+	while(held < DMA_TRACE_DEPTH && dmaTraceRecord(held, &records[held])) held++;
+
+	while(held != 0){
+		const DMA_TraceRecord_t* r = &records[--held];
+		printStreamName((DMA_Stream_t)r -> stream);
+		uartPrintLog(my_UART1, (char*)eventNames[r -> event & 3U]);
+		printStat("", r -> bytes);
+		printStat(" B AT ", r -> startAt / cyclesPerUs);
+		printStat(" US, ", (r -> endAt - r -> startAt) / cyclesPerUs);
+		uartPrintLog(my_UART1, " US");
+		printErrorFlags(r -> flags);
+		uartPrintLog(my_UART1, "\n");
+	}
+	printStat("--> ", dmaTraceRecorded());
+	uartPrintLog(my_UART1, " RECORDED\n");
+}
+#endif
+
+static const CLI_Command_t appCommands[] = {
+		{"Orange led on",	cmdOrangeLedOn,		NULL},
+		{"Orange led off",	cmdOrangeLedOff,	NULL},
+		{"Update firmware",	cmdUpdateFirmware,	NULL},
+		{"Telemetry ascii",	cmdTelemetryAscii,	NULL},
+		{"Telemetry binary",cmdTelemetryBinary,	NULL},
+		{"Stats",			cmdStats,			NULL},
+		{"Stats reset",		cmdStatsReset,		NULL},
+		{"Mux on",			cmdMuxOn,			NULL},
+		{"Mux off",			cmdMuxOff,			NULL},
+		{"Log",				cmdLog,				cliParseWords},
+		{"Latency",			cmdLatency,			NULL},
+		{"Latency reset",	cmdLatencyReset,	NULL},
+		{"Autobaud",		cmdAutobaud,		NULL},
+#if FMT_BENCHMARK
+		{"Bench fmt",		cmdBenchFmt,		NULL},
+#endif
+#if DMA_MEM_BENCHMARK
+		{"Bench dma",		cmdBenchDma,		NULL},
+#endif
+#if DMA_BENCHMARK
+		{"Bench contention",cmdBenchContention,	NULL},
+#endif
+#if DMA_TRACE
+		{"DMA stats",		cmdDmaStats,		NULL},
+		{"DMA stats reset",	cmdDmaStatsReset,	NULL},
+		{"DMA trace",		cmdDmaTrace,		NULL},
+#endif
+};
+
 
 
 /* ------------------------------------------------------------------------------------ */
+/*
+ * LED patterns for the waveform engine, 50ms per step. The tables stay in RAM: the stream
+ * still reads them while firmwareUpdate() is on its way to erasing flash.
+ */
+#define LED_STEP_US		50000U
+
+/* Green 100ms on out of every 700ms, forever */
+static uint32_t heartbeatSteps[] = {
+		WAVE_SET(LED_GREEN), WAVE_HOLD, WAVE_RESET(LED_GREEN), WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD,
+		WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD,
+};
+static const WAVE_Pattern_t heartbeat = {heartbeatSteps, sizeof heartbeatSteps / sizeof heartbeatSteps[0], LED_STEP_US, 0};
+
+/* Image received: blue 150ms on, 50ms off, twice, then 500ms off; three times */
+static uint32_t updateDoneSteps[] = {
+		WAVE_SET(LED_BLUE) | WAVE_RESET(LED_GREEN), WAVE_HOLD, WAVE_HOLD, WAVE_RESET(LED_BLUE),
+		WAVE_SET(LED_BLUE), WAVE_HOLD, WAVE_HOLD, WAVE_RESET(LED_BLUE),
+		WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD, WAVE_HOLD,
+};
+static const WAVE_Pattern_t updateDone = {updateDoneSteps, sizeof updateDoneSteps / sizeof updateDoneSteps[0], LED_STEP_US, 3};
+
 float temperatureVal = 0;
 int main(void){
+	uint32_t lastSampleTick = 0;
+	bool updateBlinked = false;
+
 	RCC_init();
-	initTimer(my_TIM1); //100MHz, 1 tick per 0.001s
+	initTimer(TICK_TIMER); //100MHz, 1 tick per 0.001s
+	cycleCounterInit();
 
 	ledBlueInit();
 	ledOrangeInit();
 	ledRedInit();
 	ledGreenInit();
+	waveInit(); //TIM1 steps DMA2 Stream 5 through the LED tables
+	(void)wavePlay(&heartbeat);
 
 	UART_Init(my_GPIO_PIN_6,
 			  my_GPIO_PIN_7,
@@ -98,35 +409,63 @@ int main(void){
 			  my_UART1,
 			  9600,
 			  PARITY_ODD,
-			  _9B_WORDLENGTH);
+			  _9B_WORDLENGTH,
+			  UART_FLOW_NONE);
+	uartSetRxCallback(my_UART1, commandLinkEvent);
+	UART_DMA_Transmitter_Init(my_UART1); //Logs leave through DMA2 Stream 7
+	UART_DMA_RxIdle_Init(my_UART1); //Commands arrive through DMA2 Stream 2, one IRQ per message
+
+	cliInit(my_UART1);
+	cliTraceInit(my_UART1);
+#if AUTOBAUD_AT_BOOT
+	autobaudStart(my_UART1); //9600 until the first character says otherwise
+#endif
+	for(uint8_t i = 0; i < sizeof appCommands / sizeof appCommands[0]; i++){
+		cliRegister(&appCommands[i]);
+	}
+	muxInit(my_UART1);
+	muxRegisterHandler(MUX_CH_CONTROL, controlChannelEvent);
 	ADC_temperatureSensorInit();
+	telemetryInit(my_UART1, TELEMETRY_ASCII);
+	LOG_I(APP, "boot: SYSCLK %u Hz, PCLK2 %u Hz", RCC_getSysClockFreq(), RCC_getPCLK2Freq());
+	dmaMemInit(); //Copy/fill on DMA2 Stream 0, crossover measured here
+#if FW_CHAIN_ENABLE
+	fwChainInit();
+#endif
 
 	while(1){
-		ledControl(LED_GREEN, ON);
-		delay(100);
-		ledControl(LED_GREEN, OFF);
-		delay(100);
+		autobaudPoll(); //Program the console rate once a sync character has been measured
+		cliPoll(); //Dispatch every command line received since the last pass
+		muxPoll(); //Control frames in, queued frames out by channel priority
+		cliTracePoll(); //Latency tracer: has the last reply left the shift register
+
+		/* Keep the downstream board fed while our own image is still arriving */
+		if(fwChainBusy() && updateFirmware == false){
+			fwChainPoll();
+			continue;
+		}
+
+		/* Sample at the rate the telemetry format can carry */
+		uint32_t now = getTick();
+		if((now - lastSampleTick) >= telemetryPeriodMs()){
+			lastSampleTick = now;
+			temperatureVal = temperatureSensorRead();
+			telemetryTemperature(temperatureVal);
+		}
+		dlogPoll(); //Deferred log records leave with the telemetry frames
 
 		if(updateFirmware == true){
-			/* Toggle leds 3 times showing uploading process is successful */
-			for(uint8_t j = 0; j < 3; j++){
-				for(uint8_t i = 0; i < 2; i++){
-					ledControl(LED_BLUE, ON);
-					delay(150);
-					ledControl(LED_BLUE, OFF);
-					delay(50);
-				}
-				delay(500);
+			fwChainFlush(); //Downstream must have the whole image before we erase our flash
+			/* Blink blue 3 times showing uploading process is successful; the loop keeps running */
+			if(!updateBlinked){
+				(void)wavePlay(&updateDone); //After the heartbeat pass in progress
+				updateBlinked = true;
 			}
+			if(waveBusy()) continue;
 
-			writeDMA2(0, DMA_S2CR, RESET); //Disable DMA2 Stream 2
-			while((readDMA2(0, DMA_S2CR) & 1) == 1); //Wait for DMA2 Stream 2 is truly turned off
-			__asm("cpsid i");
+			UART_DMA_Receiver_Stop(my_UART1); //DMA2 Stream 2 is truly turned off on return
+			__disable_irq();
 			firmwareUpdate(rxBuf, sizeof rxBuf);
 		}
-
-		delay(500);
-		temperatureVal = temperatureSensorRead();
-		uartPrintTemperature(my_UART1, temperatureVal, 2);
 	}
 }
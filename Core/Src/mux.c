@@ -0,0 +1,260 @@
+/*
+ * mux.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Virtual channels over one UART
+ * 		Every frame carries a channel ID (layout in mux.h). TX keeps one queue per channel
+ * 		and feeds the UART a whole frame at a time, highest priority first, so console
+ * 		replies overtake telemetry that is already waiting. RX splits the stream on 0x00,
+ * 		checks the CRC and hands each payload to the handler registered for its channel.
+ */
+
+#include "mux.h"
+#include "telemetry.h" //crc16Ccitt(), cobsEncode(), cobsDecode()
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+
+/* Encoded frames, delimiter included. Thread context only, head/tail run freely */
+typedef struct{
+	uint8_t buf[MUX_QUEUE_SIZE];
+	uint16_t head;
+	uint16_t tail;
+}muxQueue_t;
+
+static UART_Name_t muxUart = my_UART1;
+static bool muxEnabled = false;
+
+static muxQueue_t txQueue[MUX_CHANNEL_COUNT];
+static MUX_Handler_t rxHandler[MUX_CHANNEL_COUNT];
+
+static uint8_t rxEncoded[MUX_MAX_ENCODED];	//Bytes of the frame being received, delimiter excluded
+static uint16_t rxEncodedLen = 0;
+static bool rxOverflow = false;				//Frame too long: discard until the next 0x00
+
+static uint8_t consoleText[MUX_MAX_PAYLOAD];	//Console output collected into one control frame
+static uint16_t consoleTextLen = 0;
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Hand queued frames to the UART while its TX ring is below MUX_TX_LOW_WATER
+ *
+ * 			Frames move whole: they never interleave on the wire. With the ring below the
+ * 			low-water mark there is always room for a complete MUX_MAX_ENCODED frame.
+ */
+static void muxPump(void){
+	uint8_t frame[MUX_MAX_ENCODED];
+
+	while(uartTxPending(muxUart) < MUX_TX_LOW_WATER){
+		muxQueue_t* queue = NULL;
+		for(uint8_t ch = 0; ch < MUX_CHANNEL_COUNT; ch++){
+			if(txQueue[ch].head != txQueue[ch].tail){
+				queue = &txQueue[ch];
+				break;
+			}
+		}
+		if(queue == NULL) return;
+
+		uint16_t len = 0;
+		uint8_t byte;
+		do{
+			byte = queue -> buf[queue -> tail++ & (MUX_QUEUE_SIZE - 1U)];
+			frame[len++] = byte;
+		}while(byte != 0x00);
+
+		(void)uartWrite(muxUart, (const char*)frame, len);
+	}
+}
+
+
+
+/* @brief	Send the collected console text as one control frame, waiting for queue room */
+static void muxFlushConsole(void){
+	if(consoleTextLen == 0) return;
+
+	while(!muxSend(MUX_CH_CONTROL, consoleText, consoleTextLen)); //muxSend() pumps, the TX ring drains by interrupt
+	consoleTextLen = 0;
+}
+
+
+
+/*
+ * @brief	uartWriteAll() hook while the mux owns the UART: console text becomes control
+ * 			frames, one per line (or per MUX_MAX_PAYLOAD bytes) instead of one per print call
+ */
+static void muxConsoleHook(UART_Name_t uartName, const char* data, uint16_t len){
+	(void)uartName;
+
+	for(uint16_t i = 0; i < len; i++){
+		consoleText[consoleTextLen++] = (uint8_t)data[i];
+		if(data[i] == '\n' || consoleTextLen == MUX_MAX_PAYLOAD) muxFlushConsole();
+	}
+}
+
+
+
+/* @brief	A delimiter closed a frame: decode, check and dispatch it */
+static void muxFrameEnd(void){
+	uint8_t frame[MUX_MAX_ENCODED]; //Decoding never grows the data
+
+	uint16_t len = (rxOverflow || rxEncodedLen == 0) ? 0 : cobsDecode(rxEncoded, rxEncodedLen, frame);
+	rxEncodedLen = 0;
+	rxOverflow = false;
+
+	if(len < 1U + MUX_CRC_SIZE) return; //Empty, malformed or truncated
+
+	len -= MUX_CRC_SIZE;
+	uint16_t crc = (uint16_t)(frame[len] | (frame[len + 1] << 8));
+	if(crc16Ccitt(frame, len, 0xFFFFU) != crc) return;
+
+	MUX_Channel_t channel = (MUX_Channel_t)frame[0];
+	if(channel >= MUX_CHANNEL_COUNT || rxHandler[channel] == NULL) return;
+
+	rxHandler[channel](channel, &frame[1], len - 1U);
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+void muxInit(UART_Name_t uartName){
+	muxUart = uartName;
+	muxEnabled = false;
+	memset(txQueue, 0, sizeof txQueue);
+	memset(rxHandler, 0, sizeof rxHandler);
+}
+
+
+
+/*
+ * @brief	Take over the UART: console output is framed on MUX_CH_CONTROL from here on
+ *
+ * @note	The caller stops reading the RX ring itself (cliSetUartInput(false))
+ */
+void muxStart(void){
+	rxEncodedLen = 0;
+	rxOverflow = false;
+	consoleTextLen = 0;
+	muxEnabled = true;
+	uartSetTxHook(muxUart, muxConsoleHook);
+}
+
+
+
+/*
+ * @brief	Give the UART back to plain text. Control frames still queued are sent first,
+ * 			queued update and log frames are dropped
+ */
+void muxStop(void){
+	if(!muxEnabled) return;
+
+	muxFlushConsole();
+	for(uint8_t ch = MUX_CH_CONTROL + 1U; ch < MUX_CHANNEL_COUNT; ch++){
+		txQueue[ch].tail = txQueue[ch].head;
+	}
+	while(txQueue[MUX_CH_CONTROL].head != txQueue[MUX_CH_CONTROL].tail) muxPump();
+
+	uartSetTxHook(muxUart, NULL);
+	muxEnabled = false;
+}
+
+
+
+bool muxActive(void){
+	return muxEnabled;
+}
+
+
+
+/*
+ * @brief	Route received frames of @p channel to @p handler (NULL drops them)
+ *
+ * @note	Handlers run from muxPoll(), in thread context
+ */
+void muxRegisterHandler(MUX_Channel_t channel, MUX_Handler_t handler){
+	if(channel >= MUX_CHANNEL_COUNT) return;
+	rxHandler[channel] = handler;
+}
+
+
+
+/*
+ * @brief	Frame, COBS-encode and queue @p payload on @p channel, then push what fits to the UART
+ *
+ * @return	false when the mux is stopped, the payload is too long or the channel queue is full
+ *
+ * @note	Thread context only
+ */
+bool muxSend(MUX_Channel_t channel, const uint8_t* payload, uint16_t len){
+	if(!muxEnabled || channel >= MUX_CHANNEL_COUNT) return false;
+	if(len > MUX_MAX_PAYLOAD || (payload == NULL && len != 0)) return false;
+
+	uint8_t frame[MUX_MAX_FRAME];
+	uint8_t encoded[MUX_MAX_ENCODED];
+
+	frame[0] = (uint8_t)channel;
+	memcpy(&frame[1], payload, len);
+	uint16_t crc = crc16Ccitt(frame, 1U + len, 0xFFFFU);
+	frame[1U + len] = (uint8_t)crc;
+	frame[2U + len] = (uint8_t)(crc >> 8);
+
+	uint16_t encodedLen = cobsEncode(frame, 1U + len + MUX_CRC_SIZE, encoded);
+	encoded[encodedLen++] = 0x00; //Delimiter
+
+	muxQueue_t* queue = &txQueue[channel];
+	bool queued = (uint16_t)(MUX_QUEUE_SIZE - (uint16_t)(queue -> head - queue -> tail)) >= encodedLen;
+	if(queued){
+		for(uint16_t i = 0; i < encodedLen; i++){
+			queue -> buf[queue -> head++ & (MUX_QUEUE_SIZE - 1U)] = encoded[i];
+		}
+	}
+
+	muxPump();
+	return queued;
+}
+
+
+
+/*
+ * @brief	Dispatch every frame received since the last pass, send pending console text
+ * 			and keep the UART fed in priority order. Call from the main loop
+ */
+void muxPoll(void){
+	UART_RxSpan_t span[2];
+
+	/* A frame is released from the RX ring before its handler runs, which may stop the mux */
+	while(muxEnabled && uartRxPeek(muxUart, span) > 0){
+		uint16_t used = 0;
+		uint8_t byte;
+
+		do{
+			byte = (uint8_t)span[0].data[used++];
+			if(byte == 0x00) break;
+
+			if(rxEncodedLen < sizeof rxEncoded) rxEncoded[rxEncodedLen++] = byte;
+			else rxOverflow = true;
+		}while(used < span[0].len);
+
+		uartRxConsume(muxUart, used);
+		if(byte == 0x00) muxFrameEnd();
+	}
+
+	if(!muxEnabled) return;
+	muxFlushConsole();
+	muxPump();
+}
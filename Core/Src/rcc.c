@@ -666,8 +666,69 @@ void RCC_init(void){
 
 
 
+/*
+ * --------------------------------------------------------------
+ * Clock Tree Queries
+ * --------------------------------------------------------------
+ */
+
+/*
+ * @brief	SYSCLK as currently selected by SWS: HSI, HSE or main PLL
+ * 			f_pll = f_src / PLLM * PLLN / PLLP
+ */
+uint32_t RCC_getSysClockFreq(void){
+	switch(readRCC(2, RCC_CFGR)){ //SWS[1:0]
+		case 0b01: return HSE_CLK_FREQ;
+
+		case 0b10:{
+			uint32_t src = (readRCC(22, RCC_PLL_CFGR) & 1) ? HSE_CLK_FREQ : HSI_CLK_FREQ;
+			uint32_t pllm = readRCC(0, RCC_PLL_CFGR);
+			uint32_t plln = readRCC(6, RCC_PLL_CFGR);
+			uint32_t pllp = (readRCC(16, RCC_PLL_CFGR) + 1U) * 2U; //00: 2, 01: 4, 10: 6, 11: 8
+			if(pllm == 0) return 0;
+			return (uint32_t)(((uint64_t)src / pllm) * plln / pllp);
+		}
+
+		default: return HSI_CLK_FREQ;
+	}
+}
+
 
 
+/*
+ * @brief	AHB clock: SYSCLK / HPRE
+ * 			HPRE 0xxx: /1, 1000: /2 ... 1011: /16, 1100: /64 ... 1111: /512 (no /32)
+ */
+uint32_t RCC_getHCLKFreq(void){
+	static const uint8_t hpreShift[8] = {1, 2, 3, 4, 6, 7, 8, 9};
+	uint32_t hpre = readRCC(4, RCC_CFGR);
+	uint32_t sysclk = RCC_getSysClockFreq();
 
+	if(hpre < 8) return sysclk;
+	return sysclk >> hpreShift[hpre - 8];
+}
 
 
+
+/*
+ * @brief	APB prescaler decode shared by PPRE1 and PPRE2: 0xx: /1, 100: /2 ... 111: /16
+ */
+static uint32_t apbFreq(uint32_t ppre){
+	uint32_t hclk = RCC_getHCLKFreq();
+	if(ppre < 4) return hclk;
+	return hclk >> (ppre - 3);
+}
+
+
+
+/* @brief	APB1 clock (USART2, TIM2-5). RCC_init() halves it to 50MHz */
+uint32_t RCC_getPCLK1Freq(void){
+	return apbFreq(readRCC(10, RCC_CFGR)); //PPRE1[2:0]
+}
+
+
+
+/* @brief	APB2 clock (USART1, USART6, TIM1, ADC1) */
+uint32_t RCC_getPCLK2Freq(void){
+	return apbFreq(readRCC(13, RCC_CFGR)); //PPRE2[2:0]
+}
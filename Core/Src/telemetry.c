@@ -0,0 +1,272 @@
+/*
+ * telemetry.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Sensor telemetry in ASCII sentences or compact binary frames
+ * 		Binary mode batches samples and sends them as COBS-encoded, CRC-protected frames
+ * 		(layout in telemetry.h). COBS removes every 0x00 from the frame, so 0x00 is a
+ * 		guaranteed frame delimiter and a lost byte costs one frame, never the stream.
+ */
+
+#include "telemetry.h"
+#include "log.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+static UART_Name_t telemetryUart = my_UART1;
+static Telemetry_Mode_t telemetryModeNow = TELEMETRY_ASCII;
+static uint8_t telemetrySeq = 0;
+
+static int16_t tempBatch[TELEMETRY_TEMP_BATCH];
+static uint8_t tempCount = 0;
+static uint32_t tempFirstTick = 0;
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+static inline void putU16(uint8_t* out, uint16_t value){
+	out[0] = (uint8_t)value;
+	out[1] = (uint8_t)(value >> 8);
+}
+
+static inline void putU32(uint8_t* out, uint32_t value){
+	putU16(out, (uint16_t)value);
+	putU16(out + 2, (uint16_t)(value >> 16));
+}
+
+
+/* @brief	Round to centi-degrees and clamp into int16 */
+static int16_t toCentiDegrees(float celsius){
+	float scaled = celsius * 100.0f + ((celsius < 0.0f) ? -0.5f : 0.5f);
+	if(scaled > 32767.0f) return 32767;
+	if(scaled < -32768.0f) return -32768;
+	return (int16_t)scaled;
+}
+
+
+static void printTemperatureSentence(float celsius){
+	/* On the mux the sentence is one log frame, so it can wait behind console replies */
+	if(muxActive()){
+		char text[MUX_MAX_PAYLOAD] = "STM32's Temperature: ";
+		uint16_t len = (uint16_t)strlen(text);
+		len += fmtFloat(&text[len], celsius, 2);
+		memcpy(&text[len], "*C", 2);
+		(void)muxSend(MUX_CH_LOG, (const uint8_t*)text, len + 2U);
+		return;
+	}
+
+	uartPrintLog(telemetryUart, "\n");
+	uartPrintLog(telemetryUart, "STM32's Temperature: ");
+	uartPrintFloat(telemetryUart, celsius, 2);
+	uartPrintLog(telemetryUart, "*C");
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Framing Primitives
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	CRC-16/CCITT-FALSE (poly 0x1021, MSB first), nibble table: 32 bytes of flash
+ *
+ * @param	crc		0xFFFF to start, or the result of the previous chunk
+ */
+uint16_t crc16Ccitt(const uint8_t* data, uint16_t len, uint16_t crc){
+	static const uint16_t nibbleTable[16] = {
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+		0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+	};
+
+	for(uint16_t i = 0; i < len; i++){
+		crc = (uint16_t)((crc << 4) ^ nibbleTable[(crc >> 12) ^ (data[i] >> 4)]);
+		crc = (uint16_t)((crc << 4) ^ nibbleTable[(crc >> 12) ^ (data[i] & 0x0FU)]);
+	}
+	return crc;
+}
+
+
+
+/*
+ * @brief	Consistent Overhead Byte Stuffing
+ * 			Each 0x00 is replaced by the distance to the next one; runs of 254 non-zero bytes
+ * 			get an extra code byte. The output holds no 0x00 and no delimiter.
+ *
+ * @param	out		At least len + len / 254 + 1 bytes
+ *
+ * @return	Encoded length
+ */
+uint16_t cobsEncode(const uint8_t* in, uint16_t len, uint8_t* out){
+	uint16_t codeIdx = 0;
+	uint16_t outIdx = 1;
+	uint8_t code = 1;
+
+	for(uint16_t i = 0; i < len; i++){
+		if(in[i] == 0){
+			out[codeIdx] = code;
+			codeIdx = outIdx++;
+			code = 1;
+			continue;
+		}
+
+		out[outIdx++] = in[i];
+		if(++code == 0xFF){ //Block full: close it without an implied zero
+			out[codeIdx] = code;
+			codeIdx = outIdx++;
+			code = 1;
+		}
+	}
+	out[codeIdx] = code;
+	return outIdx;
+}
+
+
+
+/*
+ * @brief	Inverse of cobsEncode(), delimiter already stripped
+ *
+ * @param	out		At least len bytes
+ *
+ * @return	Decoded length, 0 when @p in is not valid COBS
+ */
+uint16_t cobsDecode(const uint8_t* in, uint16_t len, uint8_t* out){
+	uint16_t inIdx = 0;
+	uint16_t outIdx = 0;
+
+	while(inIdx < len){
+		uint8_t code = in[inIdx++];
+		if(code == 0 || inIdx + code - 1U > len) return 0; //Block runs past the end
+
+		for(uint8_t i = 1; i < code; i++){
+			out[outIdx++] = in[inIdx++];
+		}
+		if(code != 0xFF && inIdx < len) out[outIdx++] = 0x00; //Implied zero, except after the last block
+	}
+	return outIdx;
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+void telemetryInit(UART_Name_t uartName, Telemetry_Mode_t mode){
+	telemetryUart = uartName;
+	telemetryModeNow = mode;
+	telemetrySeq = 0;
+	tempCount = 0;
+}
+
+
+
+/*
+ * @brief	Switch format. A partly filled binary batch is sent first so no sample is lost
+ */
+void telemetrySetMode(Telemetry_Mode_t mode){
+	if(mode == telemetryModeNow) return;
+	telemetryFlush();
+	telemetryModeNow = mode;
+}
+
+
+
+Telemetry_Mode_t telemetryMode(void){
+	return telemetryModeNow;
+}
+
+
+
+/*
+ * @brief	Sampling period suited to the current format's cost per sample
+ */
+uint32_t telemetryPeriodMs(void){
+	return (telemetryModeNow == TELEMETRY_BINARY) ? TELEMETRY_BINARY_PERIOD_MS : TELEMETRY_ASCII_PERIOD_MS;
+}
+
+
+
+/*
+ * @brief	Report one temperature sample
+ * 			ASCII: one sentence per sample. Binary: batched, a frame leaves every TELEMETRY_TEMP_BATCH samples
+ */
+void telemetryTemperature(float celsius){
+	if(telemetryModeNow == TELEMETRY_ASCII){
+		printTemperatureSentence(celsius);
+		return;
+	}
+
+	if(tempCount == 0) tempFirstTick = getTick();
+	tempBatch[tempCount++] = toCentiDegrees(celsius);
+
+	if(tempCount == TELEMETRY_TEMP_BATCH) telemetryFlush();
+}
+
+
+
+/*
+ * @brief	Send the pending temperature batch, however many samples it holds
+ */
+void telemetryFlush(void){
+	if(tempCount == 0) return;
+
+	uint8_t payload[3U + 2U * TELEMETRY_TEMP_BATCH];
+	putU16(payload, (uint16_t)TELEMETRY_BINARY_PERIOD_MS);
+	payload[2] = tempCount;
+	for(uint8_t i = 0; i < tempCount; i++){
+		putU16(&payload[3U + 2U * i], (uint16_t)tempBatch[i]);
+	}
+
+	if(!telemetrySendFrame(TELEMETRY_MSG_TEMPERATURE, tempFirstTick, payload, (uint16_t)(3U + 2U * tempCount))){
+		LOG_D(TELEMETRY, "batch of %u samples dropped", tempCount);
+	}
+	tempCount = 0;
+}
+
+
+
+/*
+ * @brief	Build, CRC, COBS-encode and queue one frame on the telemetry UART
+ *
+ * @return	false when @p len exceeds TELEMETRY_MAX_PAYLOAD or the mux log queue is full
+ *
+ * @note	Thread context: waits for TX ring room like uartPrintLog()
+ */
+bool telemetrySendFrame(uint8_t type, uint32_t timestamp, const uint8_t* payload, uint16_t len){
+	if(len > TELEMETRY_MAX_PAYLOAD || (payload == NULL && len != 0)) return false;
+
+	uint8_t frame[TELEMETRY_MAX_FRAME];
+	uint8_t encoded[TELEMETRY_MAX_ENCODED];
+
+	frame[0] = type;
+	frame[1] = telemetrySeq++;
+	putU32(&frame[2], timestamp);
+	for(uint16_t i = 0; i < len; i++){
+		frame[TELEMETRY_HEADER_SIZE + i] = payload[i];
+	}
+
+	uint16_t frameLen = TELEMETRY_HEADER_SIZE + len;
+	putU16(&frame[frameLen], crc16Ccitt(frame, frameLen, 0xFFFFU));
+	frameLen += TELEMETRY_CRC_SIZE;
+
+	/* The mux frames, protects and schedules it; a full log queue drops the frame (seq shows the gap) */
+	if(muxActive()) return muxSend(MUX_CH_LOG, frame, frameLen);
+
+	uint16_t encodedLen = cobsEncode(frame, frameLen, encoded);
+	encoded[encodedLen++] = 0x00; //Delimiter
+
+	uartWriteAll(telemetryUart, (const char*)encoded, encodedLen);
+	return true;
+}
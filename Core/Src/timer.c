@@ -3,11 +3,13 @@
  * @brief	Timer utilities  for STM32F4 (TIM1 to TIM11)
  * 			Dynamic PSC/ARR calculation to hit target update rates
  * 			Safe bit-field access with validity checks
- * 			1kHz system tick using TIM1 + IRQ 25(TIM1_UP_TIM10)
+ * 			1kHz system tick using TICK_TIMER (TIM5 + IRQ 50)
  *
  *  Created on: Jun 20, 2025
  *  Updated on: Jul 18, 2025
  *  	Improve readability
+ *  Updated on: Oct 18, 2026
+ *  	Tick moved from TIM1 to TIM5, TIM1 clocks the waveform engine
  *
  *      Author: dobao
  */
@@ -20,6 +22,20 @@
  * ------------------------------------------------------------
  */
 static volatile int timeCnt = 0; //Millisecond counter
+static volatile uint32_t delayCycles = 0; //Core cycles spent inside delay() since boot
+static volatile uint32_t msTicks = 0; //Free-running millisecond tick, never reset
+
+/* Update interrupt of each timer, index: TIM_Name_t */
+static const IRQn_Pos_t timerIrqs[] = {
+		[my_TIM1] = TIM1_UP_TIM10,
+		[my_TIM2] = TIM2_user,
+		[my_TIM3] = TIM3_user,
+		[my_TIM4] = TIM4_user,
+		[my_TIM5] = TIM5_user,
+		[my_TIM9] = TIM1_BRK_TIM9,
+		[my_TIM10] = TIM1_UP_TIM10,
+		[my_TIM11] = TIM1_TGR_COM_TIM11,
+};
 
 
 /*
@@ -879,7 +895,7 @@ TIM_Cal_t timerCalculation(uint32_t sysClkFreq, uint32_t targetHz, uint32_t maxA
 	TIM_Cal_t output = {0};
 	TIM_Cal_t error;
 
-	uint32_t psc = (sysClkFreq / (targetHz * (maxArr + 1)));
+	uint32_t psc = (uint32_t)(sysClkFreq / ((uint64_t)targetHz * ((uint64_t)maxArr + 1U))); //maxArr + 1 overflows 32 bits for TIM2/TIM5
 	if(psc > 0xFFFF) psc = 0xFFFF; //PSC is 16-bit on stm32
 
 	for(;; ++psc){
@@ -933,20 +949,56 @@ void initTimer(TIM_Name_t userTIMx){
 
 	writeTimer(0, userTIMx, TIM_PSC, timConfig.psc);
 	writeTimer(0, userTIMx, TIM_ARR, timConfig.arr);
-	writeTimer(0, userTIMx, TIM_DIER, SET); //DMA Interrupt Enable
-	NVIC_enableIRQ(TIM1_UP_TIM10); //Enable interrupt at IRQ 25
+	writeTimer(0, userTIMx, TIM_DIER, SET); //Update Interrupt Enable
+	NVIC_enableIRQ(timerIrqs[userTIMx]);
 	writeTimer(0, userTIMx, TIM_CR1, SET); //Counter enabled
 }
 
 
-void TIM1_UP_TIM10_IRQHandler(){
+/*
+ * @brief	TICK_TIMER update: one millisecond
+ */
+void TIM5_IRQHandler(){
 	timeCnt++;
-	writeTimer(0, my_TIM1, TIM_SR, RESET); //Clear the interrupt flag
+	msTicks++;
+	writeTimer(0, TICK_TIMER, TIM_SR, RESET); //Clear the interrupt flag
 }
 
 void delay(int msec){
+	uint32_t start = CYCLE_COUNT();
 	timeCnt = 0;
 	while(timeCnt < msec); //Busy wait
+	delayCycles += CYCLE_COUNT() - start;
+}
+
+
+
+/*
+ * @brief	Core cycles spent busy-waiting in delay() since boot. Wraps like CYCLE_COUNT(),
+ * 			so take the difference of two readings to cover a window
+ */
+uint32_t delayBusyCycles(void){
+	return delayCycles;
+}
+
+
+
+/*
+ * @brief	Milliseconds since initTimer(TICK_TIMER). Wraps after ~49 days, compare with subtraction
+ */
+uint32_t getTick(void){
+	return msTicks;
+}
+
+
+
+/*
+ * @brief	Start the DWT cycle counter used for profiling (CYCLE_COUNT())
+ */
+void cycleCounterInit(void){
+	*(volatile uint32_t*)DEMCR_ADDR |= (1U << 24); //TRCENA: power the DWT unit
+	*(volatile uint32_t*)DWT_CYCCNT_ADDR = 0;
+	*(volatile uint32_t*)DWT_CTRL_ADDR |= 1U; //CYCCNTENA
 }
 
 
@@ -14,6 +14,101 @@
  */
 
 #include "uart.h"
+#include "log.h"
+
+/*
+ * @brief	DR access with side effects: a read pops RXNE, a write starts the shifter.
+ * 			The host build (Sim/) routes them to the USART model, everything else stays plain memory.
+ */
+#ifdef HOST_SIM
+#include "simHooks.h"
+#define UART_DR_READ(huart)			simUsartReadDR(&(huart) -> UART_DR)
+#define UART_DR_WRITE(huart, value)	simUsartWriteDR(&(huart) -> UART_DR, (value))
+#else
+#define UART_DR_READ(huart)			((huart) -> UART_DR)
+#define UART_DR_WRITE(huart, value)	((huart) -> UART_DR = (value))
+#endif
+
+/*
+ * -----------------------------------------------------------
+ * Private State
+ * -----------------------------------------------------------
+ */
+
+/*
+ * @brief	TX ring per UART. uartWrite() produces at head, the TXE interrupt consumes at tail.
+ * 			Indexes run freely and are masked on access, so head - tail is always the fill level.
+ */
+typedef struct{
+	char buf[UART_TX_BUFFER_SIZE];
+	volatile uint16_t head;
+	volatile uint16_t tail;
+
+	bool dmaMode;				//Ring is drained by DMA instead of the TXE interrupt
+	volatile uint16_t dmaLen;	//Bytes in flight on the TX stream, 0 when the stream is idle
+}uartTxRing_t;
+
+static uartTxRing_t txRing[UART_COUNT];
+
+/*
+ * @brief	RX ring per UART. DMA writes continuously in circular mode; head is advanced on
+ * 			IDLE and on the stream's HT/TC, so the consumer can see part of a frame (a line
+ * 			still arriving) and must assemble frames itself, as cliPoll() does.
+ * 			head/tail run freely like the TX ring; dmaPos is the last NDTR-derived write index.
+ */
+typedef struct{
+	char buf[UART_RX_BUFFER_SIZE];
+	volatile uint16_t head;
+	volatile uint16_t tail;
+	uint16_t dmaPos;
+	bool active;
+
+	bool flowControl;			//RTS/CTS wired: throttle instead of overwriting
+	volatile bool throttled;	//DMAR cleared, RTS held high by the unread DR
+}uartRxRing_t;
+
+static uartRxRing_t rxRing[UART_COUNT];
+
+/*
+ * @brief	Static wiring of each USART: registers, NVIC line and its DMA requests
+ * 			(RM0383 DMA1/DMA2 request mapping). The RX/TX engines below only ever look here,
+ * 			so every port gets the same ring + DMA + IDLE machinery.
+ *
+ * 			Only USART1 (PA11/PA12) and USART2 (PA0/PA1) have CTS/RTS pins. USART6 has none on
+ * 			the F411: PA11/PA12 on AF8 are its TX/RX, so it cannot take UART_FLOW_RTS_CTS.
+ */
+typedef struct{
+	volatile uartRegOffset_t* regs;
+	IRQn_Pos_t irq;
+
+	DMA_Stream_t rxStream;
+	uint8_t rxChannel;
+
+	DMA_Stream_t txStream;
+	uint8_t txChannel;
+
+	bool hasFlowControl;		//CTS/RTS pins exist, UART_FLOW_RTS_CTS is allowed
+	GPIO_PortName_t flowPort;
+	GPIO_Pin_t ctsPin;
+	GPIO_Pin_t rtsPin;
+}uartInstance_t;
+
+static const uartInstance_t uartInstances[UART_COUNT] = {
+	/*				regs		IRQ		RX stream/ch					TX stream/ch					CTS/RTS */
+	[my_UART1] = {UART1_REG,	UART1,	DMA_STREAM(my_DMA2, 2), 4,		DMA_STREAM(my_DMA2, 7), 4,		true, my_GPIOA, my_GPIO_PIN_11, my_GPIO_PIN_12},
+	[my_UART2] = {UART2_REG,	UART2,	DMA_STREAM(my_DMA1, 5), 4,		DMA_STREAM(my_DMA1, 6), 4,		true, my_GPIOA, my_GPIO_PIN_0, my_GPIO_PIN_1},
+	[my_UART6] = {UART6_REG,	UART6,	DMA_STREAM(my_DMA2, 1), 5,		DMA_STREAM(my_DMA2, 6), 5,		false},
+};
+
+static UART_RxCallback_t rxCallback[UART_COUNT];
+static UART_TxHook_t txHook[UART_COUNT]; //Takes uartWriteAll() output instead of the TX ring
+static volatile UART_Stats_t uartStats[UART_COUNT];
+static char* rxBlockBuf[UART_COUNT]; //Buffer given to UART_DMA_Receiver_Init()
+static uint32_t rxBlockSize[UART_COUNT];
+static uint32_t rxBlockHanded[UART_COUNT]; //Bytes of the current lap already handed off: 0 or size/2
+static volatile uint32_t txBlockedCycles[UART_COUNT]; //Core cycles thread mode spun waiting on TX
+
+
 
 /*
  * -----------------------------------------------------------
@@ -22,12 +117,107 @@
  */
 /* Base-Address Lookup */
 static inline volatile uartRegOffset_t* uartBase(UART_Name_t uartName){
-	switch(uartName){
-		case my_UART1: return UART1_REG;
-		case my_UART2: return UART2_REG;
-		case my_UART6: return UART6_REG;
-		default: return NULL;
+	if((unsigned)uartName >= UART_COUNT) return NULL;
+	return uartInstances[uartName].regs;
+}
+
+
+
+static void uartRxDmaEvent(DMA_Stream_t stream, uint32_t flags, void* context);
+static void uartTxDmaEvent(DMA_Stream_t stream, uint32_t flags, void* context);
+
+
+
+/*
+ * @brief	RX stream of a UART as the ring and the block receiver use it: UART DR into 8-bit
+ * 			memory, circular, with HT/TC interrupts when @p halves asks for them
+ */
+static void rxStreamConfigure(UART_Name_t uartName, bool memInc, bool halves){
+	const uartInstance_t* inst = &uartInstances[uartName];
+	DMA_StreamConfig_t config = {
+			.channel = inst -> rxChannel,
+			.dir = DMA_DIR_P2M,
+			.periphWidth = DMA_WIDTH_8,
+			.memWidth = DMA_WIDTH_8,
+			.memInc = memInc,
+			.circular = true,
+			.priority = UART_DMA_RX_PRIORITY,
+			.irqFlags = DMA_FLAG_TC | (halves ? DMA_FLAG_HT : 0U),
+			.periphAddr = (uint32_t)&inst -> regs -> UART_DR, //Sender is UART DR
+	};
+	(void)dmaStreamConfigure(inst -> rxStream, &config);
+	dmaStreamSetCallback(inst -> rxStream, uartRxDmaEvent, (void*)(uintptr_t)uartName);
+}
+
+
+
+/*
+ * @brief	Make everything DMA has written into the RX ring visible to the consumer
+ * 			and apply backpressure when the ring is getting full
+ *
+ * 			Hardware RTS only deasserts while DR holds an unread byte, which never happens
+ * 			with DMA draining DR. Clearing DMAR above the high-water mark leaves the next byte
+ * 			in DR, RTS goes high and the sender pauses until uartRxRead() drains the ring.
+ *
+ * @return	Number of bytes published by this call
+ *
+ * @note	Interrupt context (IDLE, HT, TC of the RX stream)
+ */
+static uint16_t rxPublish(UART_Name_t uartName){
+	uartRxRing_t* ring = &rxRing[uartName];
+
+	uint16_t pos = (UART_RX_BUFFER_SIZE - uartRxDmaRemaining(uartName)) & (UART_RX_BUFFER_SIZE - 1U);
+	uint16_t newBytes = (pos - ring -> dmaPos) & (UART_RX_BUFFER_SIZE - 1U);
+	ring -> dmaPos = pos;
+	ring -> head += newBytes;
+	uartStats[uartName].bytesIn += newBytes;
+
+	/* Consumer fell a whole ring behind: the oldest bytes are already overwritten */
+	uint16_t fill = (uint16_t)(ring -> head - ring -> tail);
+	if(fill > UART_RX_BUFFER_SIZE){
+		ring -> tail = ring -> head - UART_RX_BUFFER_SIZE;
+		fill = UART_RX_BUFFER_SIZE;
 	}
+	if(fill > uartStats[uartName].rxPeak) uartStats[uartName].rxPeak = fill;
+
+	if(ring -> flowControl && !ring -> throttled &&
+	   (uint16_t)(ring -> head - ring -> tail) >= UART_RX_HIGH_WATER){
+		uartInstances[uartName].regs -> UART_CR3 &= ~(1U << 6); //DMAR off: RTS follows RXNE
+		ring -> throttled = true;
+	}
+
+	return newBytes;
+}
+
+
+
+/*
+ * @brief	Hand the largest contiguous run of queued bytes to the TX stream
+ *
+ * 			Everything written while a batch is in flight piles up behind it in the ring and
+ * 			leaves as one transfer at the next TC, so many small prints become a few DMA runs.
+ *
+ * @note	Call with interrupts masked or from the TX stream's own ISR
+ */
+static void uartTxDmaKick(UART_Name_t uartName){
+	uartTxRing_t* ring = &txRing[uartName];
+	if(ring -> dmaLen != 0) return; //Stream busy, the TC interrupt chains the next batch
+
+	uint16_t count = ring -> head - ring -> tail;
+	if(count == 0) return;
+
+	uint16_t idx = ring -> tail & (UART_TX_BUFFER_SIZE - 1U);
+	uint16_t contiguous = UART_TX_BUFFER_SIZE - idx;
+	ring -> dmaLen = (count < contiguous) ? count : contiguous;
+
+	UART_DMA_Transmitter_Start(uartName, &ring -> buf[idx], ring -> dmaLen);
+}
+
+
+
+/* NVIC Position Lookup */
+static inline IRQn_Pos_t uartIRQn(UART_Name_t uartName){
+	return uartInstances[uartName].irq;
 }
 
 
@@ -121,6 +311,13 @@ UART_Status_t writeUART(uint8_t bitPosition, UART_Name_t uartName, UART_RegName_
 	//Mask off the old bit and OR with new value
 	uint32_t mask = ((1U << bitWidth) - 1U) << bitPosition;
 	uint32_t shiftedValue = (value << bitPosition) & mask;
+
+	/* DR is write-only data: a read-modify-write would read DR and swallow a pending RX byte */
+	if(regName == UART_DR){
+		UART_DR_WRITE(UARTx, shiftedValue);
+		return UART_OK;
+	}
+
 	*reg = (*reg & ~mask) | shiftedValue;
 
 	return UART_OK;
@@ -163,7 +360,7 @@ int32_t readUART(uint8_t bitPosition, UART_Name_t uartName, UART_RegName_t regNa
 
 		uint32_t bitMask = nineBits ? 0x1FFu : 0xFFu;
 
-		return (int32_t)(*reg & bitMask); //Return full 9/8 bits depend on setting
+		return (int32_t)(UART_DR_READ(UARTx) & bitMask); //Return full 9/8 bits depend on setting
 	}
 
 	if(bitPosition == 0){
@@ -181,103 +378,429 @@ int32_t readUART(uint8_t bitPosition, UART_Name_t uartName, UART_RegName_t regNa
  */
 
 /*
- * @brief	Set up DMA2-Stream2-Channel4 to move incoming UART1 RX bytes into a user-supplier buffer
+ * @brief	Set up the UART's RX stream to move incoming bytes into a user-supplied buffer
+ * 			(UART1: DMA2-Stream2-Ch4, UART2: DMA1-Stream5-Ch4, UART6: DMA2-Stream1-Ch5)
  *
- * @param	rxBuffer	Pointer to the receive buffer (must be word-aligned if required by ur DMA)
- * 						Its size must be programmed into NDTR before each reception.
+ * @param	rxBuffer	Pointer to the receive buffer
+ * @param	bufferSize	Bytes to receive; the UART_RX_BLOCK_COMPLETE callback fires when it is full
+ *
+ * 			The buffer is a ping-pong: UART_RX_HALF_COMPLETE hands off the first half while DMA
+ * 			fills the second, UART_RX_BLOCK_COMPLETE hands off the second half while DMA wraps
+ * 			into the first. A consumer that finishes each half within one half-buffer time
+ * 			receives a stream of any length without gaps.
  *
  * @routine:
- * 		1. Enable DMA mode for reception in UART1 (UART_CR3)
- * 		2. Enable DMA2 peripheral clock
- * 		3. Programs DMA2 Stream 2 registers:
- * 			PAR 	<- &UART1.DR (feed DR address)
+ * 		1. Enable DMA mode for reception in the UART (UART_CR3)
+ * 		2. Enable the DMA controller clock
+ * 		3. Programs the RX stream registers:
+ * 			PAR 	<- &UARTx.DR (feed DR address)
  * 			M0AR	<- rxBuffer	 (destination in RAM)
  * 			NDTR	<- sizeof(buffer)	(number of bytes to receive)
- * 			CR		<- channel 4 | 8bit | MINC | CIRC | TCIE | EN
- * 		4. Enable the NVIC interrupt for DMA2_Stream2
+ * 			CR		<- channel | 8bit | MINC | CIRC | HTIE | TCIE | EN
+ * 		4. Enable the NVIC interrupt of the RX stream
+ */
+void UART_DMA_Receiver_Init(UART_Name_t uartName, char *rxBuffer, uint32_t bufferSize){
+	if(uartBase(uartName) == NULL) return;
+
+	/* The RX stream is taken over: the IDLE-framed ring stops here */
+	writeUART(4, uartName, UART_CR1, RESET); //IDLEIE off
+	rxRing[uartName].active = false;
+	rxRing[uartName].throttled = false;
+	rxBlockSize[uartName] = bufferSize;
+	rxBlockHanded[uartName] = 0;
+
+	writeUART(6, uartName, UART_CR3, SET); //Enable DMA for reception
+	rxBlockBuf[uartName] = rxBuffer;
+
+	/* A single-byte buffer has no halves and nothing to increment over */
+	rxStreamConfigure(uartName, bufferSize > 1, bufferSize > 1);
+
+	UART_DMA_Receiver_Start(uartName);
+}
+
+
+/*
+ * @brief	(Re)start block reception at the beginning of the UART_DMA_Receiver_Init() buffer
+ */
+void UART_DMA_Receiver_Start(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL || rxBlockBuf[uartName] == NULL) return;
+	DMA_Stream_t stream = uartInstances[uartName].rxStream;
+
+	dmaStreamStop(stream);
+	rxBlockHanded[uartName] = 0;
+	(void)dmaStreamStart(stream, rxBlockBuf[uartName], (uint16_t)rxBlockSize[uartName]); //NDTR is 16 bits
+}
+
+
+void UART_DMA_Receiver_Stop(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return;
+	dmaStreamStop(uartInstances[uartName].rxStream);
+}
+
+
+
+/*
+ * @brief	Variable-length reception: the UART's RX stream fills its RX ring in circular mode
+ * 			and the USART IDLE interrupt marks the end of each message
+ *
+ * @routine:
+ * 		1. Programs the RX stream exactly like UART_DMA_Receiver_Init() but into the RX ring,
+ * 		   with HT/TC as fill-level sampling points
+ * 		2. Replaces RXNEIE (one IRQ per byte) with IDLEIE (one IRQ per message)
+ *
+ * @note	A later UART_DMA_Receiver_Init() on the same UART (e.g. "Update firmware")
+ * 			re-targets the stream to a block buffer and stops this ring
  */
-void UART1_DMA_Receiver_Init(char *rxBuffer, uint32_t bufferSize){
-	writeUART(6, my_UART1, UART_CR3, SET); //Enable DMA for reception
+void UART_DMA_RxIdle_Init(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return;
+	const uartInstance_t* inst = &uartInstances[uartName];
+
+	uartRxRing_t* ring = &rxRing[uartName];
+	ring -> head = 0;
+	ring -> tail = 0;
+	ring -> dmaPos = 0;
+
 	/*
-	 * According to DMA2 request mapping
-	 * 		Choose Stream 2, channel 4 for UART1_RX
+	 * Circular into the RX ring: it never stops. IDLE does the framing; HT/TC also sample the
+	 * fill level every half ring, so a sender that never pauses long enough for IDLE is still
+	 * published, counted and throttled
 	 */
-	my_RCC_DMA2_CLK_ENABLE(); //Enabling clock for DMA2
+	rxStreamConfigure(uartName, true, true);
+	ring -> throttled = false;
+
+	writeUART(6, uartName, UART_CR3, SET); //Enable DMA for reception
+	(void)dmaStreamStart(inst -> rxStream, ring -> buf, UART_RX_BUFFER_SIZE);
+
+	writeUART(5, uartName, UART_CR1, RESET); //RXNEIE off: DMA owns DR
+	(void)readUART(0, uartName, UART_SR);
+	(void)readUART(0, uartName, UART_DR); //Clear a stale IDLE flag
+	ring -> active = true;
+	writeUART(4, uartName, UART_CR1, SET); //IDLEIE on
+}
 
-	/* Assign the address of sender which is UART_DR*/
-	writeDMA2(0, DMA_S2CR, RESET); //Disable stream before configuring
-	while((readDMA2(0, DMA_S2CR) & 0x1) == SET); //Wait until stream 2 is truly disabled
 
-	writeDMA2(0, DMA_S2PAR, (uint32_t)UART1_GET_REG(UART_DR)); //Write sender address to DMA_S2PAR
-	writeDMA2(0, DMA_S2M0AR, (uint32_t)rxBuffer); //Write receiver address to DMA_S2M0AR
-	writeDMA2(0, DMA_S2NDTR, bufferSize); //Let DMA knows the size of the transfered package
 
-	writeDMA2(25, DMA_S2CR, 0b100); //Select channel 4
+/*
+ * @brief	Bytes the RX stream still has to write before its buffer wraps (raw NDTR)
+ */
+uint32_t uartRxDmaRemaining(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return 0;
+	return dmaStreamRemaining(uartInstances[uartName].rxStream);
+}
 
-	writeDMA2(11, DMA_S2CR, 0b00); //Set data size is 8-bit
-	writeDMA2(8, DMA_S2CR, SET); //Enable circular mode
 
-	if(bufferSize > 1){
-		writeDMA2(10, DMA_S2CR, SET); //Set memory increment mode
-	} else writeDMA2(10, DMA_S2CR, RESET); //No memory increment mode
 
-	writeDMA2(4, DMA_S2CR, SET); //Enable transfer complete interrupt
+/*
+ * @brief	IDLE-line service routine. Called from the USARTx_IRQHandler of the matching UART
+ *
+ * 			Samples the DMA write position from NDTR and publishes everything received since
+ * 			the previous IDLE event as one frame.
+ *
+ * @return	Number of bytes in the frame that just closed, 0 when there was no IDLE event
+ */
+uint16_t uartRxIdleIRQHandler(UART_Name_t uartName){
+	volatile uartRegOffset_t* huart = uartBase(uartName);
+	if(huart == NULL) return 0;
+	if(!(huart -> UART_SR & (1U << 4))) return 0; //IDLE
 
-	UART1_DMA_Receiver_Start();
-}
+	(void)UART_DR_READ(huart); //SR then DR read clears IDLE. RXNE is 0 here, DMA already took the byte
 
+	if(!rxRing[uartName].active) return 0;
 
-void UART1_DMA_Receiver_Start(){
-	writeDMA2(0, DMA_S2CR, SET); //Enable Stream 2
-	NVIC_enableIRQ(DMA2_S2);
+	return rxPublish(uartName);
 }
 
 
-void UART1_DMA_Transmitter_Init(void){
+
+/*
+ * @brief	RX stream interrupt (DMA callback, @p context is the UART)
+ * 			Block mode: ping-pong hand-off of the halves of the UART_DMA_Receiver_Init() buffer.
+ * 			Ring mode: HT/TC publish data, feed the RTS/CTS watermark check and the statistics.
+ */
+static void uartRxDmaEvent(DMA_Stream_t stream, uint32_t flags, void* context){
+	(void)stream;
+	UART_Name_t uartName = (UART_Name_t)(uintptr_t)context;
+
+	if(flags & DMA_FLAG_HT) uartStats[uartName].dmaHalf++;
+	if(flags & DMA_FLAG_TC) uartStats[uartName].dmaFull++;
+
+	/* Ring mode: HT/TC publish data and sample the fill level every half ring */
+	if(rxRing[uartName].active){
+		(void)rxPublish(uartName);
+		return;
+	}
+
 	/*
-	 * According to DMA2 request mapping
-	 * 		Choose Stream 7 and channel 4 for UART1_TX
+	 * Block mode. The flags only say that a boundary was crossed at some point, and one can
+	 * be raised between reading and clearing them. The write position from NDTR says which
+	 * half DMA is in now, so each half is handed off exactly once, in order.
 	 */
-	my_RCC_DMA2_CLK_ENABLE();
+	uint32_t size = rxBlockSize[uartName];
+	uint32_t half = size / 2U;
+	uint32_t pos = size - uartRxDmaRemaining(uartName); //Next byte DMA writes, 0 right after a wrap
 
-	writeDMA2(0, DMA_S7CR, RESET); //Disable stream before configuring
-	while((readDMA2(0, DMA_S7CR) & 0x1) == SET); //Wait until stream 2 is truly disabled
+	if(half == 0){ //Single-byte buffer: no halves, every TC is a full block
+		if((flags & DMA_FLAG_TC) == 0) return;
+	}
+	else if(rxBlockHanded[uartName] == 0){
+		if(pos < half) return;
+		rxBlockHanded[uartName] = half; //DMA moved into the second half: ping is stable
+		uartStats[uartName].bytesIn += half;
+		if(rxCallback[uartName] != NULL){
+			rxCallback[uartName](uartName, UART_RX_HALF_COMPLETE, half);
+		}
+		return;
+	}
+	else{
+		if(pos >= half) return;
+		rxBlockHanded[uartName] = 0; //DMA wrapped into the first half: pong is stable
+	}
 
-	/* Assign the address of sender which is UART_DR*/
-	writeDMA2(0, DMA_S7PAR, (uint32_t)UART1_GET_REG(UART_DR)); //Write sender address to DMA_S7PAR
-	writeDMA2(25, DMA_S7CR, 0b100); //Select channel 4
-	writeDMA2(6, DMA_S7CR, 0b01); //Data transfer direction: memory to peripheral
+	uartStats[uartName].bytesIn += size - half;
+	if(rxCallback[uartName] != NULL){
+		rxCallback[uartName](uartName, UART_RX_BLOCK_COMPLETE, size);
+	}
+}
 
-	uint32_t cr1 = UART1_REG -> UART_CR1;
-	bool nineBits = ((cr1 & UART_CR1_M) && (cr1 & UART_CR1_PCE)) ||
-					((cr1 & UART_CR1_M) && !(cr1 & UART_CR1_PCE));
-	uint8_t dataSizeSel = nineBits ? 0b01 : 0b00;
 
-	writeDMA2(11, DMA_S7CR, dataSizeSel); //Set data size is 9 bit or 8 bit
-	writeDMA2(10, DMA_S7CR, SET); //Set memory increment mode
-	writeDMA2(8, DMA_S7CR, SET); //Enable circular mode
-	writeDMA2(4, DMA_S7CR, SET); //Enable transfer complete interrupt
 
-	NVIC_enableIRQ(DMA2_S7);
-	writeUART(7, my_UART1, UART_CR3, SET); //Enable DMA for transmission
+/*
+ * @brief	Unread bytes published to the RX ring so far
+ */
+uint16_t uartRxAvailable(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return 0;
+	return (uint16_t)(rxRing[uartName].head - rxRing[uartName].tail);
+}
+
+
+
+/*
+ * @brief	Lend the unread part of the RX ring without copying it
+ *
+ * 			span[0] runs from the oldest unread byte towards the end of the ring, span[1] holds
+ * 			whatever wrapped to its start. Both stay valid until uartRxConsume() releases them.
+ *
+ * @return	Total bytes lent (span[0].len + span[1].len)
+ *
+ * @note	Only RTS/CTS keeps DMA off lent bytes. Without flow control a sender that outruns
+ * 			the consumer by a whole ring overwrites them, exactly as it would before a copy.
+ */
+uint16_t uartRxPeek(UART_Name_t uartName, UART_RxSpan_t span[2]){
+	if(span == NULL) return 0;
+	span[0].len = 0;
+	span[1].len = 0;
+
+	uint16_t n = uartRxAvailable(uartName);
+	if(n == 0) return 0;
+
+	uartRxRing_t* ring = &rxRing[uartName];
+	uint16_t idx = ring -> tail & (UART_RX_BUFFER_SIZE - 1U);
+	uint16_t contiguous = UART_RX_BUFFER_SIZE - idx;
+
+	span[0].data = &ring -> buf[idx];
+	span[0].len = (n < contiguous) ? n : contiguous;
+	span[1].data = ring -> buf;
+	span[1].len = n - span[0].len;
+	return n;
 }
 
 
-void UART1_DMA_Transmitter_Start(char* txBuffer, uint32_t bufferSize){
-	writeDMA2(0, DMA_S7CR, RESET); //Disable stream before configuring
-	while((readDMA2(0, DMA_S7CR) & 0x1) == SET); //Wait until stream 2 is truly disabled
 
-	/* Clear the flags */
-	writeDMA2(27, DMA_HIFCR, SET); //Clear transfer completed interrupt flag of stream 7
-	writeDMA2(26, DMA_HIFCR, SET); //Clear half transfer completed interrupt flag of stream 7
-	writeDMA2(25, DMA_HIFCR, SET); //Clear transfer error interrupt flag
-	writeDMA2(24, DMA_HIFCR, SET); //Clear direct mode error interrupt flag
-	writeDMA2(22, DMA_HIFCR, SET); //Clear FIFO error interrupt flag
+/*
+ * @brief	Release the first @p len bytes lent by uartRxPeek() back to DMA
+ */
+void uartRxConsume(UART_Name_t uartName, uint16_t len){
+	if(uartBase(uartName) == NULL || len == 0) return;
+	uartRxRing_t* ring = &rxRing[uartName];
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq(); //rxPublish() may clamp tail and modifies CR3 from the RX interrupts
+
+	uint16_t n = (uint16_t)(ring -> head - ring -> tail);
+	ring -> tail += (len < n) ? len : n;
+
+	/* Enough room again: let DMA take the byte parked in DR, RTS drops back low */
+	if(ring -> throttled && (uint16_t)(ring -> head - ring -> tail) <= UART_RX_LOW_WATER){
+		ring -> throttled = false;
+		uartInstances[uartName].regs -> UART_CR3 |= (1U << 6); //DMAR
+	}
+	__set_PRIMASK(primask);
+}
+
 
-	writeDMA2(0, DMA_S7M0AR, (uint32_t)txBuffer); //Write receiver address to DMA_S7M0AR
-	writeDMA2(0, DMA_S7NDTR, bufferSize); //Let DMA knows the size of the transfered package
 
-	writeDMA2(0, DMA_S7CR, SET); //Enable Stream 7, ready to start!
+/*
+ * @brief	Drop everything received so far, published or still waiting for its IDLE,
+ * 			e.g. the bytes of a line that arrived at the wrong rate
+ */
+void uartRxDiscard(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return;
+	uartRxRing_t* ring = &rxRing[uartName];
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(ring -> active) (void)rxPublish(uartName); //Take in what DMA stored since the last IDLE
+	uartRxConsume(uartName, uartRxAvailable(uartName));
+	__set_PRIMASK(primask);
+}
+
+
+
+/*
+ * @brief	Copy up to @p maxLen received bytes out of the RX ring
+ *
+ * @return	Number of bytes copied into @p out
+ */
+uint16_t uartRxRead(UART_Name_t uartName, char* out, uint16_t maxLen){
+	if(out == NULL) return 0;
+
+	UART_RxSpan_t span[2];
+	uint16_t n = uartRxPeek(uartName, span);
+	if(n > maxLen) n = maxLen;
+	if(n == 0) return 0;
+
+	uint16_t first = (n < span[0].len) ? n : span[0].len;
+	memcpy(out, span[0].data, first);
+	memcpy(out + first, span[1].data, n - first);
+
+	uartRxConsume(uartName, n);
+	return n;
+}
+
+
+
+/*
+ * @brief	Snapshot of one UART's counters (consistent: copied with interrupts masked)
+ */
+void uartGetStats(UART_Name_t uartName, UART_Stats_t* out){
+	if(uartBase(uartName) == NULL || out == NULL) return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	memcpy(out, (const void*)&uartStats[uartName], sizeof *out);
+	__set_PRIMASK(primask);
+}
+
+
+
+void uartResetStats(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	memset((void*)&uartStats[uartName], 0, sizeof uartStats[uartName]);
+	__set_PRIMASK(primask);
+}
+
+
+
+/*
+ * @brief	PE + FE + NE + ORE seen so far, for callers that only need "any new error?"
+ */
+uint32_t uartErrorCount(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return 0;
+	volatile UART_Stats_t* stats = &uartStats[uartName];
+	return stats -> parityErrors + stats -> framingErrors + stats -> noiseErrors + stats -> overrunErrors;
+}
+
+
+
+/*
+ * @brief	Register the function told about received frames (IDLE) and completed blocks
+ *
+ * @note	Runs in interrupt context: keep it short, leave parsing to thread context
+ */
+void uartSetRxCallback(UART_Name_t uartName, UART_RxCallback_t callback){
+	if(uartBase(uartName) == NULL) return;
+	rxCallback[uartName] = callback;
+}
+
+
+
+/*
+ * @brief	Divert everything written through uartWriteAll()/uartPrintLog() to @p hook,
+ * 			e.g. to frame console output. NULL restores the TX ring. uartWrite() is not diverted
+ *
+ * @note	The hook runs in thread mode only; output from interrupts is dropped while it is set
+ */
+void uartSetTxHook(UART_Name_t uartName, UART_TxHook_t hook){
+	if(uartBase(uartName) == NULL) return;
+	txHook[uartName] = hook;
+}
+
+
+/*
+ * @brief	Set up the UART's TX stream to drain its TX ring
+ * 			(UART1: DMA2-Stream7-Ch4, UART2: DMA1-Stream6-Ch4, UART6: DMA2-Stream6-Ch5)
+ *
+ * @routine:
+ * 		1. Programs the TX stream registers:
+ * 			PAR		<- &UARTx.DR
+ * 			CR		<- channel | mem-to-periph | 8bit | MINC | TCIE (normal mode)
+ * 		2. Enables the NVIC interrupt of the TX stream and DMAT in UART_CR3
+ * 		3. Switches the UART's TX ring from the TXE interrupt to DMA
+ *
+ * @note	fwChain drives DMA2 Stream 6 itself: do not call this for its USART6 link
+ */
+void UART_DMA_Transmitter_Init(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return;
+	const uartInstance_t* inst = &uartInstances[uartName];
+
+	/*
+	 * The source is the byte-wide TX ring: with parity on, the 9th bit is generated by hardware,
+	 * so both sides stay 8-bit (direct mode forces MSIZE = PSIZE anyway)
+	 */
+	DMA_StreamConfig_t config = {
+			.channel = inst -> txChannel,
+			.dir = DMA_DIR_M2P,
+			.periphWidth = DMA_WIDTH_8,
+			.memWidth = DMA_WIDTH_8,
+			.memInc = true,
+			.circular = false, //Normal mode: each batch is sent once, then TC chains the next one
+			.priority = UART_DMA_TX_PRIORITY,
+			.irqFlags = DMA_FLAG_TC,
+			.periphAddr = (uint32_t)&inst -> regs -> UART_DR, //Receiver is UART DR
+	};
+	(void)dmaStreamConfigure(inst -> txStream, &config);
+	dmaStreamSetCallback(inst -> txStream, uartTxDmaEvent, (void*)(uintptr_t)uartName);
+
+	writeUART(7, uartName, UART_CR3, SET); //Enable DMA for transmission
+
+	/* From now on uartWrite() feeds the TX stream instead of the TXE interrupt */
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	writeUART(7, uartName, UART_CR1, RESET); //TXEIE off
+	txRing[uartName].dmaMode = true;
+	uartTxDmaKick(uartName);
+	__set_PRIMASK(primask);
+}
+
+
+
+/*
+ * @brief	TX stream transfer complete (DMA callback, @p context is the UART): release the batch
+ * 			that just went out and chain the next one
+ */
+static void uartTxDmaEvent(DMA_Stream_t stream, uint32_t flags, void* context){
+	(void)stream;
+	UART_Name_t uartName = (UART_Name_t)(uintptr_t)context;
+	if((flags & DMA_FLAG_TC) == 0) return;
+
+	uartTxRing_t* ring = &txRing[uartName];
+	if(!ring -> dmaMode) return;
+	uartStats[uartName].bytesOut += ring -> dmaLen;
+	ring -> tail += ring -> dmaLen;
+	ring -> dmaLen = 0;
+	uartTxDmaKick(uartName);
+}
+
+
+void UART_DMA_Transmitter_Start(UART_Name_t uartName, char* txBuffer, uint32_t bufferSize){
+	if(uartBase(uartName) == NULL) return;
+	DMA_Stream_t stream = uartInstances[uartName].txStream;
+
+	dmaStreamStop(stream);
+	(void)dmaStreamStart(stream, txBuffer, (uint16_t)bufferSize); //Source in RAM, ready to start!
 }
 
 
@@ -291,17 +814,27 @@ void UART1_DMA_Transmitter_Start(char* txBuffer, uint32_t bufferSize){
  * @param	baudRate	Desired baud rate in bit/s (e.g. 115200)
  * @param	parity		PARITY_NONE, PARITY_EVEN, OR PARITY_ODD
  * @param	wordLength	_8B_WORDLENGTH or _9B_WORDLENGTH
+ * @param	flowControl	UART_FLOW_NONE or UART_FLOW_RTS_CTS (pins from the instance table:
+ * 						USART1 PA11/PA12, USART2 PA0/PA1; USART6 has none)
+ *
+ * @note	The divider is computed from the live APB clock (see uartSetBaudRate())
  *
- * @note	The function assumes SYSCLK_FREQ_100M is set to the current peripheral clock speed.
- * 			Update this constant if the clock tree is changed
+ * @return	INVALID_UART for an unknown port, UART_NOT_OK for UART_FLOW_RTS_CTS on a port
+ * 			without CTS/RTS pins (nothing is configured then)
  */
-void UART_Init(GPIO_Pin_t TXPin,
-			   GPIO_Pin_t RXPin,
-			   GPIO_PortName_t portName,
-			   UART_Name_t uartName,
-			   uint32_t baudRate,
-			   UART_Parity_t parity,
-			   UART_WordLength_t wordLength){
+UART_Status_t UART_Init(GPIO_Pin_t TXPin,
+						GPIO_Pin_t RXPin,
+						GPIO_PortName_t portName,
+						UART_Name_t uartName,
+						uint32_t baudRate,
+						UART_Parity_t parity,
+						UART_WordLength_t wordLength,
+						UART_FlowControl_t flowControl){
+	if((unsigned)uartName >= UART_COUNT) return INVALID_UART;
+	const uartInstance_t* inst = &uartInstances[uartName];
+	bool rtsCts = (flowControl == UART_FLOW_RTS_CTS);
+	if(rtsCts && !inst -> hasFlowControl) return UART_NOT_OK;
+
 	/* Clock */
 	enableUartClock(uartName);
 	enableGpioClock(portName);
@@ -312,31 +845,30 @@ void UART_Init(GPIO_Pin_t TXPin,
 	writePin(TXPin, portName, MODER, AF_MODE);
 	writePin(RXPin, portName, MODER, AF_MODE);
 
-	writePin(TXPin, portName, (TXPin <= 7U) ? AFRL : AFRH, AF7);
-	writePin(RXPin, portName, (RXPin <= 7U) ? AFRL : AFRH, AF7);
+	/* USART1/2 sit on AF7, USART6 on AF8 */
+	GPIO_State_t uartAF = (uartName == my_UART6) ? AF8 : AF7;
+	writePin(TXPin, portName, (TXPin <= 7U) ? AFRL : AFRH, uartAF);
+	writePin(RXPin, portName, (RXPin <= 7U) ? AFRL : AFRH, uartAF);
 
-	/*
-	 * CONFIG UART
-	 *
-	 * Config baud rate
-	 * baud = fclk / (8*(2-OVER8)*UARTDIV)
-	 *
-	 * APB2 supports System Clock upto 100MHz
-	 */
 	volatile uartRegOffset_t* huart = uartBase(uartName);
-	if(huart == NULL) {return;}
-
-	long int f_clk = SYSCLK_FREQ_100M; //Note: Remember to change this when you change clock speed in RCC
-	char over8 = 0; //16x oversampling
-	float uartDiv = (float)f_clk / (8.0f * (2 - over8) * (float)baudRate);
-
-	int divMantissa = (int)uartDiv; //Extract the integer part
-	float divFraction = uartDiv - divMantissa; //Extract the fraction part
-	int convert_divFraction = (int)(roundf(divFraction * 16.0f)); //scale and store divFraction in 4 bits
-	uint16_t fullBRR = (divMantissa << 4) | (convert_divFraction & 0xF);
-
-	/* Write Calculated full values to BRR */
-	writeUART(0, uartName, UART_BRR, fullBRR);
+	if(huart == NULL) {return INVALID_UART;}
+
+	/* Config baud rate */
+	writeUART(13, uartName, UART_CR1, RESET); //UE must be 0 while OVER8 changes
+	(void)uartSetBaudRate(uartName, baudRate, NULL);
+
+	/* Hardware flow control: CTS gates our transmitter, RTS tells the sender to pause */
+	if(rtsCts){
+		enableGpioClock(inst -> flowPort);
+		writePin(inst -> ctsPin, inst -> flowPort, MODER, AF_MODE);
+		writePin(inst -> rtsPin, inst -> flowPort, MODER, AF_MODE);
+		writePin(inst -> ctsPin, inst -> flowPort, (inst -> ctsPin <= 7U) ? AFRL : AFRH, uartAF);
+		writePin(inst -> rtsPin, inst -> flowPort, (inst -> rtsPin <= 7U) ? AFRL : AFRH, uartAF);
+	}
+	writeUART(0, uartName, UART_CR3, SET); //EIE: FE/NE/ORE interrupt while DMA owns DR
+	writeUART(8, uartName, UART_CR3, rtsCts ? SET : RESET); //RTSE
+	writeUART(9, uartName, UART_CR3, rtsCts ? SET : RESET); //CTSE
+	rxRing[uartName].flowControl = rtsCts;
 
 	/* Enable Tx and Rx */
 	writeUART(2, uartName, UART_CR1, 1); //Receiver is enabled and begins searching for a start bit
@@ -347,6 +879,7 @@ void UART_Init(GPIO_Pin_t TXPin,
 		writeUART(10, uartName, UART_CR1, 0); //PCE = 0
 	}else{
 		writeUART(10, uartName, UART_CR1, 1); //PCE = 1
+		writeUART(8, uartName, UART_CR1, 1); //PEIE: count parity errors
 
 		if(parity == PARITY_EVEN){
 			writeUART(9, uartName, UART_CR1, 0); //PS = 0 for EVEN
@@ -361,12 +894,172 @@ void UART_Init(GPIO_Pin_t TXPin,
 	}else if (wordLength == _9B_WORDLENGTH) {
 		writeUART(12, uartName, UART_CR1, 1); //Set data frame size as 9 bits
 	}else{
-		return;
+		return UART_NOT_OK;
 	}
 
 	writeUART(5, uartName, UART_CR1, SET); //Enable receive interrupt
 	writeUART(13, uartName, UART_CR1, 1); //Enable UART
-	NVIC_enableIRQ(UART1); //Position 37 in vector table
+	NVIC_enableIRQ(uartIRQn(uartName)); //UART1: 37, UART2: 38, UART6: 71 in vector table
+	return UART_OK;
+}
+
+
+
+/*
+ * @brief	Kernel clock of a USART: USART1/6 sit on APB2, USART2 on APB1
+ */
+uint32_t uartGetClock(UART_Name_t uartName){
+	switch(uartName){
+		case my_UART1:
+		case my_UART6: return RCC_getPCLK2Freq();
+		case my_UART2: return RCC_getPCLK1Freq();
+		default: return 0;
+	}
+}
+
+
+
+/*
+ * @brief	Integer BRR solver
+ * 			baud = pclk / (8 * (2 - OVER8) * USARTDIV), so in BRR units (1/16 or 1/8 of USARTDIV)
+ * 			div = round(pclk / baud) and the real rate is pclk / div for both oversampling modes.
+ * 			OVER8 keeps 3 fraction bits in BRR[2:0] and BRR[3] must stay 0.
+ *
+ * @return	UART_NOT_OK when the rate is outside what the mantissa (1..4095) can express
+ */
+UART_Status_t uartCalcBaud(uint32_t pclk, uint32_t baudRate, bool over8, UART_Baud_t* result){
+	if(baudRate == 0 || result == NULL) return UART_NOT_OK;
+
+	uint32_t div = (pclk + baudRate / 2U) / baudRate; //Round to nearest
+	uint32_t minDiv = over8 ? 8U : 16U;
+	uint32_t maxDiv = over8 ? ((4095U << 3) | 7U) : 0xFFFFU;
+	if(div < minDiv || div > maxDiv) return UART_NOT_OK;
+
+	result -> over8 = over8;
+	result -> brr = over8 ? (uint16_t)(((div >> 3) << 4) | (div & 0x7U)) : (uint16_t)div;
+	result -> actualBaud = (pclk + div / 2U) / div;
+	result -> errorPpm = (int32_t)(((int64_t)result -> actualBaud - (int64_t)baudRate) * 1000000 / (int64_t)baudRate);
+	return UART_OK;
+}
+
+
+
+/*
+ * @brief	Pick the divider for @p baudRate on this UART without touching the hardware
+ * 			16x oversampling is preferred (better noise immunity); 8x is used only when 16x
+ * 			cannot reach the rate or misses it by more than UART_BAUD_MAX_ERROR_PPM
+ */
+UART_Status_t uartResolveBaud(UART_Name_t uartName, uint32_t baudRate, UART_Baud_t* result){
+	UART_Baud_t baud16, baud8;
+	uint32_t pclk = uartGetClock(uartName);
+	if(pclk == 0 || result == NULL) return INVALID_UART;
+
+	bool ok16 = (uartCalcBaud(pclk, baudRate, false, &baud16) == UART_OK);
+	bool ok8 = (uartCalcBaud(pclk, baudRate, true, &baud8) == UART_OK);
+	if(!ok16 && !ok8) return UART_NOT_OK;
+
+	const UART_Baud_t* pick = &baud16;
+	if(!ok16 || (ok8 && labs(baud16.errorPpm) > UART_BAUD_MAX_ERROR_PPM && labs(baud8.errorPpm) < labs(baud16.errorPpm))){
+		pick = &baud8;
+	}
+	if(labs(pick -> errorPpm) > UART_BAUD_MAX_ERROR_PPM) return UART_NOT_OK;
+
+	*result = *pick;
+	return UART_OK;
+}
+
+
+
+/*
+ * @brief	Program BRR for @p baudRate from the current APB clock
+ *
+ * @param	result		Optional, receives the divider and the achieved rate/error
+ *
+ * @note	Call with the transmitter idle (uartTxFlush()): UE is dropped while BRR/OVER8 change
+ */
+UART_Status_t uartSetBaudRate(UART_Name_t uartName, uint32_t baudRate, UART_Baud_t* result){
+	UART_Baud_t baud;
+	UART_Status_t status = uartResolveBaud(uartName, baudRate, &baud);
+	if(status != UART_OK) return status;
+
+	bool enabled = (readUART(13, uartName, UART_CR1) & 1) == 1;
+	if(enabled) writeUART(13, uartName, UART_CR1, RESET);
+
+	writeUART(15, uartName, UART_CR1, baud.over8 ? SET : RESET);
+	writeUART(0, uartName, UART_BRR, baud.brr);
+
+	if(enabled) writeUART(13, uartName, UART_CR1, SET);
+
+	if(result != NULL) *result = baud;
+	return UART_OK;
+}
+
+
+
+/*
+ * @brief	Baud rate currently programmed in BRR, derived back from the APB clock
+ */
+uint32_t uartGetBaudRate(UART_Name_t uartName){
+	uint32_t pclk = uartGetClock(uartName);
+	uint32_t brr = (uint32_t)readUART(0, uartName, UART_BRR) & 0xFFFFU;
+	bool over8 = (readUART(15, uartName, UART_CR1) & 1) == 1;
+
+	uint32_t div = over8 ? (((brr >> 4) << 3) | (brr & 0x7U)) : brr;
+	if(pclk == 0 || div == 0) return 0;
+	return (pclk + div / 2U) / div;
+}
+
+
+
+/*
+ * @brief	Blocking: wait until the TX ring (and its DMA batch) is empty and the last stop bit has left
+ */
+void uartTxFlush(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return;
+	uint32_t start = CYCLE_COUNT();
+	while(uartTxPending(uartName) != 0);
+	while((readUART(6, uartName, UART_SR) & 1) == 0); //TC
+	txBlockedCycles[uartName] += CYCLE_COUNT() - start;
+}
+
+
+
+/*
+ * @brief	TX ring position after the last byte queued so far, for uartTxSent()
+ */
+uint16_t uartTxMark(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return 0;
+	return txRing[uartName].head;
+}
+
+
+
+/*
+ * @brief	Has every byte queued before @p mark (from uartTxMark()) left the shift register?
+ *
+ * @note	Once the ring has moved past the mark the answer is yes even if TC is low: the
+ * 			bytes behind ours are what is shifting out. With DMA the ring moves a batch at a
+ * 			time, so a caller polling this sees the end at most one batch late
+ */
+bool uartTxSent(UART_Name_t uartName, uint16_t mark){
+	volatile uartRegOffset_t* huart = uartBase(uartName);
+	if(huart == NULL) return true;
+
+	int16_t ahead = (int16_t)(uint16_t)(txRing[uartName].tail - mark);
+	if(ahead < 0) return false; //Still in the ring or in the DMA batch
+	if(ahead > 0) return true;
+	return (huart -> UART_SR & (1U << 6)) != 0; //TC: the last stop bit is out
+}
+
+
+
+/*
+ * @brief	Core cycles thread mode has spent blocked on a full TX ring (uartWriteAll())
+ * 			or draining it (uartTxFlush()) since boot. Wraps, take differences
+ */
+uint32_t uartTxBlockedCycles(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return 0;
+	return txBlockedCycles[uartName];
 }
 
 
@@ -414,8 +1107,16 @@ int32_t my_UART_Receive(UART_Name_t uartName){
 	 * 		Worst case: DR wont get new data, leading to data loss or lockup
 	 */
 
-	//Check parity error (bitPosition = 0)
-	if(readUART(0, uartName, UART_SR) == 1){
+	//Check line errors: SR read first, the DR read below completes the clear sequence
+	uint32_t sr = (uint32_t)readUART(0, uartName, UART_SR);
+	volatile UART_Stats_t* stats = &uartStats[uartName];
+	if(sr & (1U << 0)) stats -> parityErrors++;
+	if(sr & (1U << 1)) stats -> framingErrors++;
+	if(sr & (1U << 2)) stats -> noiseErrors++;
+	if(sr & (1U << 3)) stats -> overrunErrors++;
+	stats -> bytesIn++;
+
+	if(sr & (1U << 0)){
 		(void)readUART(0, uartName, UART_DR); //read and discard error
 		return UART_NOT_OK; //There is parity error
 	}
@@ -427,47 +1128,224 @@ int32_t my_UART_Receive(UART_Name_t uartName){
 
 
 
+/*
+ * @brief	Queue bytes into the UART's TX ring without waiting
+ *
+ * @param	uartName	UART peripheral (my_UART1, my_UART2, my_UART6)
+ * @param	data		Bytes to send
+ * @param	len			Number of bytes in @p data
+ *
+ * @return	Number of bytes accepted. Less than @p len when the ring is full;
+ * 			the caller decides whether to retry the rest or drop it.
+ *
+ * @note	Safe from both thread and interrupt context: the copy runs with interrupts masked
+ */
+uint16_t uartWrite(UART_Name_t uartName, const char* data, uint16_t len){
+	volatile uartRegOffset_t* huart = uartBase(uartName);
+	if(huart == NULL || data == NULL) return 0;
+
+	uartTxRing_t* ring = &txRing[uartName];
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint16_t space = UART_TX_BUFFER_SIZE - (uint16_t)(ring -> head - ring -> tail);
+	uint16_t accepted = (len < space) ? len : space;
+
+	for(uint16_t i = 0; i < accepted; i++){
+		ring -> buf[(ring -> head + i) & (UART_TX_BUFFER_SIZE - 1U)] = data[i];
+	}
+	ring -> head += accepted;
+
+	if(accepted > 0){
+		if(ring -> dmaMode){
+			uartTxDmaKick(uartName); //No-op while a batch is in flight
+		}
+		else{
+			huart -> UART_CR1 |= (1U << 7); //TXEIE: the interrupt drains the ring
+		}
+	}
+
+	__set_PRIMASK(primask);
+	return accepted;
+}
+
+
+
+/*
+ * @brief	Bytes still waiting in the TX ring (not yet handed to DR)
+ */
+uint16_t uartTxPending(UART_Name_t uartName){
+	if(uartBase(uartName) == NULL) return 0;
+	return (uint16_t)(txRing[uartName].head - txRing[uartName].tail);
+}
+
+
+
+/*
+ * @brief	TXE service routine. Call from the USARTx_IRQHandler of the matching UART
+ *
+ * 			Moves one byte from the ring to DR per TXE event
+ * 			and masks TXEIE once the ring is empty so the interrupt stops firing.
+ */
+void uartTxIRQHandler(UART_Name_t uartName){
+	volatile uartRegOffset_t* huart = uartBase(uartName);
+	if(huart == NULL) return;
+
+	if(!(huart -> UART_CR1 & (1U << 7)) || !(huart -> UART_SR & (1U << 7))) return; //TXEIE and TXE
+
+	uartTxRing_t* ring = &txRing[uartName];
+	if(ring -> head == ring -> tail){
+		huart -> UART_CR1 &= ~(1U << 7); //Ring empty, stop TXE interrupts
+		return;
+	}
+
+	UART_DR_WRITE(huart, (uint8_t)ring -> buf[ring -> tail & (UART_TX_BUFFER_SIZE - 1U)]);
+	ring -> tail++;
+	uartStats[uartName].bytesOut++;
+}
+
+
+
+/*
+ * @brief	Count and clear line errors (PEIE, and EIE for FE/NE/ORE in DMA mode)
+ *
+ * 			The flags clear on an SR read followed by a DR read. While DMA still has the byte
+ * 			to pick up (RXNE and DMAR), its own DR read finishes the sequence; otherwise the
+ * 			byte is either gone already or nobody will read it (throttled, or corrupt), so DR
+ * 			is read here to stop the interrupt from re-firing.
+ */
+void uartErrorIRQHandler(UART_Name_t uartName){
+	volatile uartRegOffset_t* huart = uartBase(uartName);
+	if(huart == NULL) return;
+
+	uint32_t sr = huart -> UART_SR;
+	if((sr & UART_SR_ERROR_MASK) == 0) return;
+	LOG_W(UART, "port %u line error, SR 0x%02x", uartName, sr);
+
+	volatile UART_Stats_t* stats = &uartStats[uartName];
+	if(sr & (1U << 0)) stats -> parityErrors++;
+	if(sr & (1U << 1)) stats -> framingErrors++;
+	if(sr & (1U << 2)) stats -> noiseErrors++;
+	if(sr & (1U << 3)) stats -> overrunErrors++;
+
+	bool dmaWillRead = (sr & (1U << 5)) && (huart -> UART_CR3 & (1U << 6));
+	bool rxneConsumer = (huart -> UART_CR1 & (1U << 5)) != 0; //RXNEIE path reads it below
+	if(!dmaWillRead && !rxneConsumer) (void)UART_DR_READ(huart);
+}
+
+
+
+/*
+ * @brief	Common USART interrupt: TX ring service, IDLE framing, and RX discard when
+ * 			no DMA engine owns the receiver
+ */
+void uartIRQHandler(UART_Name_t uartName){
+	volatile uartRegOffset_t* huart = uartBase(uartName);
+	if(huart == NULL) return;
+
+	uartTxIRQHandler(uartName);
+	uartErrorIRQHandler(uartName);
+
+	/*
+	 * Constant time: the IDLE event only publishes the bytes DMA already stored,
+	 * line assembly and command matching happen in thread context
+	 */
+	uint16_t frameLen = uartRxIdleIRQHandler(uartName);
+	if(frameLen != 0){
+		uartStats[uartName].frames++;
+		LOG_D(UART, "port %u frame, %u bytes", uartName, frameLen);
+		if(rxCallback[uartName] != NULL) rxCallback[uartName](uartName, UART_RX_FRAME, frameLen);
+	}
+
+	if((huart -> UART_CR1 & (1U << 5)) && (huart -> UART_SR & (1U << 5))){
+		(void)UART_DR_READ(huart); //RXNEIE without an RX engine: nobody consumes it
+		uartStats[uartName].bytesIn++;
+	}
+}
+
+
+
+/*
+ * Vector table entries
+ */
+void USART1_IRQHandler(void){uartIRQHandler(my_UART1);}
+void USART2_IRQHandler(void){uartIRQHandler(my_UART2);}
+void USART6_IRQHandler(void){uartIRQHandler(my_UART6);}
+
+
+
+/*
+ * @brief	Queue all @p len bytes, binary-safe
+ *
+ * @note	Only when the ring is full does a thread-mode caller wait for room;
+ * 			from an interrupt the part that does not fit is dropped instead.
+ * 			A hook set with uartSetTxHook() gets the data in place of the ring.
+ */
+void uartWriteAll(UART_Name_t uartName, const char* data, uint16_t len){
+	if(uartBase(uartName) != NULL && txHook[uartName] != NULL){
+		if(__get_IPSR() == 0 && __get_PRIMASK() == 0) txHook[uartName](uartName, data, len);
+		return;
+	}
+
+	uint16_t sent = uartWrite(uartName, data, len);
+
+	if(__get_IPSR() != 0 || __get_PRIMASK() != 0) return; //Never spin inside an ISR or with IRQs masked
+	if(sent == len) return;
+
+	uint32_t start = CYCLE_COUNT();
+	while(sent < len){
+		sent += uartWrite(uartName, data + sent, len - sent);
+	}
+	txBlockedCycles[uartName] += CYCLE_COUNT() - start;
+}
+
+
+
 /*
  * @brief	Send a zero-terminated ASCII string over the selected UART port
  *
  * @param	uartName	UART peripheral (example: my_UART1, my_UART2, and my_UART6)
  * @param	message		Pointer to a C-string that ends with '\0'
  *
- * @note!	The routine is blocking: it waits inside my_UART_Transmit()
- * 			until each byte has physically left the shift register.
- * 			For short status messages that is fine; for large logs consider
- * 			an IRQ or DMA-drivin Tx buffer so the CPU can do other work.
+ * @note	The string is copied into the TX ring and the call returns right away,
+ * 			with the same full-ring rules as uartWriteAll()
  */
 void uartPrintLog(UART_Name_t uartName, char* message){
-	int messageLength = strlen(message);
-	for(short i = 0; i < messageLength; i++){
-		my_UART_Transmit(uartName, message[i]);
-	}
+	uartWriteAll(uartName, message, (uint16_t)strlen(message));
 }
 
 
 
 /*
- * @brief	The function formats @p val with the number of digits specifies by decimals (0-9)
- * 			Transmits the resulting string through uartPrintLog()
- *
- * @note:
- * 		A 20-byte local buffer, @c buf, temporarily holds the formatted string.
- * 		The conversion format string @c fmt starts as "%.1f"; the precision character
- * 		(index 2) is overwritten with @c '0' + decimal, allowing any precision from %.0f to %.9f
+ * @brief	Format @p val with @p decimals digits after the point (0-9) and queue it on the UART
  *
- * 		snprintf)() is used for safe and bounded formatting
+ * @note	fmtFloat() writes into a stack buffer: no float printf, no format string
+ * 			and no varargs
  */
 void uartPrintFloat(UART_Name_t uartName, float val, uint8_t decimals){
-	char buf[20]; //20 bytes array (each index stores a byte value)
-	char fmt[] = "%.1f"; //C-string stored in a writable character array
-	/*
-	 * fmt[0] = '%'		Start of conversion specification
-	 * fmt[1] = '.'		Dot introduces the precision field
-	 * fmt[2] = '1'		Precision digit (one digit after the decimal)
-	 * fmt[3] = 'f'		Format as floating point
-	 */
-	fmt[2] = '0' + decimals; //Allow 0-9 decimals
-	snprintf(buf, sizeof buf, fmt, val);
+	char buf[FMT_BUF_SIZE];
+	fmtFloat(buf, val, decimals);
+	uartPrintLog(uartName, buf);
+}
+
+
+
+/* @brief	Integer printers on top of fmt.c, same queuing rules as uartPrintLog() */
+void uartPrintU32(UART_Name_t uartName, uint32_t val){
+	char buf[FMT_BUF_SIZE];
+	fmtU32(buf, val);
+	uartPrintLog(uartName, buf);
+}
+
+void uartPrintI32(UART_Name_t uartName, int32_t val){
+	char buf[FMT_BUF_SIZE];
+	fmtI32(buf, val);
+	uartPrintLog(uartName, buf);
+}
+
+void uartPrintHex(UART_Name_t uartName, uint32_t val, uint8_t digits){
+	char buf[FMT_BUF_SIZE];
+	fmtHex32(buf, val, digits);
 	uartPrintLog(uartName, buf);
 }
@@ -0,0 +1,228 @@
+/*
+ * waveform.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * Timer-triggered GPIO waveforms on WAVE_STREAM
+ * 		TIM1 runs with URS set, so only its overflows (not the UG that loads PSC/ARR) request
+ * 		the stream, and with ARPE set, so a new step length waits for the next update event.
+ * 		Thread mode only hands patterns over; the stream's TC interrupt does every switch.
+ */
+
+#include "waveform.h"
+#include "log.h"
+
+/*
+ * ----------------------------------------------------------------------
+ * Private State
+ * ----------------------------------------------------------------------
+ */
+#define TIM_CR1_CEN_POS		0U
+#define TIM_CR1_URS_POS		2U
+#define TIM_CR1_ARPE_POS	7U
+#define TIM_DIER_UDE_POS	8U
+#define TIM_EGR_UG_POS		0U
+
+static const WAVE_Pattern_t* volatile current = NULL;	//NULL: idle
+static const WAVE_Pattern_t* volatile replacement = NULL;	//Takes over at the end of the pass
+static volatile uint16_t loopsLeft = 0;
+
+static const WAVE_Pattern_t* queue[WAVE_QUEUE_DEPTH];
+static volatile uint8_t queueHead = 0;
+static volatile uint8_t queueCount = 0;
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Private Helpers
+ * ----------------------------------------------------------------------
+ */
+static bool patternValid(const WAVE_Pattern_t* pattern){
+	return pattern != NULL && pattern -> steps != NULL && pattern -> length != 0 &&
+		   pattern -> stepUs >= WAVE_MIN_STEP_US;
+}
+
+
+static void timerStop(void){
+	writeTimer(TIM_CR1_CEN_POS, my_TIM1, TIM_CR1, RESET);
+	writeTimer(TIM_DIER_UDE_POS, my_TIM1, TIM_DIER, RESET);
+}
+
+
+/*
+ * @brief	Running: the new step length applies from the next update event on.
+ * 			Idle: load it and start counting, the first request comes one step later.
+ */
+static void timerSetStep(uint16_t stepUs){
+	writeTimer(0, my_TIM1, TIM_ARR, stepUs - 1U);
+	if(readTimer(TIM_CR1_CEN_POS, my_TIM1, TIM_CR1) == SET) return;
+
+	writeTimer(TIM_EGR_UG_POS, my_TIM1, TIM_EGR, SET); //Load ARR now; URS keeps it from requesting
+	writeTimer(0, my_TIM1, TIM_SR, RESET);
+	writeTimer(TIM_DIER_UDE_POS, my_TIM1, TIM_DIER, SET);
+	writeTimer(TIM_CR1_CEN_POS, my_TIM1, TIM_CR1, SET);
+}
+
+
+/* Interrupts masked, or in the stream's interrupt */
+static void startPattern(const WAVE_Pattern_t* pattern){
+	dmaStreamStop(WAVE_STREAM);
+	current = pattern;
+	loopsLeft = pattern -> loops;
+	timerSetStep(pattern -> stepUs);
+	(void)dmaStreamStart(WAVE_STREAM, pattern -> steps, pattern -> length);
+}
+
+
+static void idle(void){
+	dmaStreamStop(WAVE_STREAM);
+	timerStop();
+	current = NULL;
+	replacement = NULL;
+	queueCount = 0;
+}
+
+
+/* Stream interrupt: one pass is out, go round again or move on */
+static void waveStreamEvent(DMA_Stream_t stream, uint32_t flags, void* context){
+	(void)stream;
+	(void)context;
+
+	if(flags & (DMA_FLAG_TE | DMA_FLAG_DME)){
+		LOG_E(DMA, "wave: transfer error, pattern dropped");
+		idle();
+		return;
+	}
+	if((flags & DMA_FLAG_TC) == 0 || current == NULL) return;
+
+	const WAVE_Pattern_t* next;
+	if(replacement != NULL){
+		next = replacement;
+		replacement = NULL;
+	}
+	else if(current -> loops == 0 || --loopsLeft != 0){
+		return; //Circular: the stream is already on the next pass
+	}
+	else if(queueCount != 0){
+		next = queue[queueHead];
+		queueHead = (queueHead + 1U) % WAVE_QUEUE_DEPTH;
+		queueCount--;
+	}
+	else{
+		idle(); //The pins keep the last step
+		return;
+	}
+	startPattern(next);
+}
+
+
+
+/*
+ * ----------------------------------------------------------------------
+ * Public API
+ * ----------------------------------------------------------------------
+ */
+
+/*
+ * @brief	Clock TIM1 at WAVE_TICK_HZ and point WAVE_STREAM at WAVE_PORT_BSRR
+ *
+ * @note	The pins must already be outputs (ledXInit())
+ */
+void waveInit(void){
+	my_RCC_TIM1_CLK_ENABLE();
+	timerStop();
+	writeTimer(0, my_TIM1, TIM_PSC, (SYSCLK_FREQ_100M / WAVE_TICK_HZ) - 1U); //APB2 timers run at 100MHz
+	writeTimer(TIM_CR1_URS_POS, my_TIM1, TIM_CR1, SET);
+	writeTimer(TIM_CR1_ARPE_POS, my_TIM1, TIM_CR1, SET);
+
+	DMA_StreamConfig_t config = {
+			.channel = WAVE_CHANNEL,
+			.dir = DMA_DIR_M2P,
+			.periphWidth = DMA_WIDTH_32,
+			.memWidth = DMA_WIDTH_32,
+			.memInc = true,
+			.circular = true,
+			.priority = WAVE_PRIORITY,
+			.irqFlags = DMA_FLAG_TC | DMA_FLAG_TE | DMA_FLAG_DME,
+			.periphAddr = (uint32_t)WAVE_PORT_BSRR,
+	};
+	(void)dmaStreamConfigure(WAVE_STREAM, &config);
+	dmaStreamSetCallback(WAVE_STREAM, waveStreamEvent, NULL);
+}
+
+
+
+/*
+ * @brief	Play @p pattern instead of whatever is playing or queued
+ *
+ * 			Idle: it starts at once. Otherwise the pass in progress finishes first (loop counts
+ * 			and the queue are dropped), so the switch never lands in the middle of a pass.
+ */
+WAVE_Status_t wavePlay(const WAVE_Pattern_t* pattern){
+	if(!patternValid(pattern)) return WAVE_ERR_PARAM;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	queueCount = 0;
+	if(current == NULL) startPattern(pattern);
+	else replacement = pattern;
+	__set_PRIMASK(primask);
+	return WAVE_OK;
+}
+
+
+
+/*
+ * @brief	Play @p pattern once everything playing or queued before it has finished
+ *
+ * @note	Nothing queued behind a pattern with loops 0 ever plays; use wavePlay() to end it
+ *
+ * @return	WAVE_ERR_FULL with WAVE_QUEUE_DEPTH patterns already waiting
+ */
+WAVE_Status_t waveQueue(const WAVE_Pattern_t* pattern){
+	if(!patternValid(pattern)) return WAVE_ERR_PARAM;
+
+	WAVE_Status_t status = WAVE_OK;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if(current == NULL){
+		startPattern(pattern);
+	}
+	else if(queueCount == WAVE_QUEUE_DEPTH){
+		status = WAVE_ERR_FULL;
+	}
+	else{
+		queue[(queueHead + queueCount) % WAVE_QUEUE_DEPTH] = pattern;
+		queueCount++;
+	}
+	__set_PRIMASK(primask);
+	return status;
+}
+
+
+
+/*
+ * @brief	Stop at once and drop the queue, then write @p finalBsrr (0: leave the pins as they are)
+ */
+void waveStop(uint32_t finalBsrr){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	idle();
+	__set_PRIMASK(primask);
+	if(finalBsrr != WAVE_HOLD) *WAVE_PORT_BSRR = finalBsrr;
+}
+
+
+
+/* @brief	A pattern is playing (or waiting for its first step) */
+bool waveBusy(void){
+	return current != NULL;
+}
+
+
+
+const WAVE_Pattern_t* waveCurrent(void){
+	return current;
+}
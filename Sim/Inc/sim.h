@@ -0,0 +1,88 @@
+/*
+ * sim.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * @brief	Host simulation of the parts of the STM32F411 the serial stack runs on.
+ *
+ * 			The peripheral and Cortex-M system windows are mapped at their real addresses, so the
+ * 			drivers in Core/ run unmodified against plain memory. Two host threads play the hardware:
+ *
+ * 				hardware thread		USART shifters and line timing, DMA streams, TIM1 update,
+ * 									TIM4 capture on PB7, RCC ready bits, ADC injected and regular
+ * 									conversions, DWT cycle counter
+ * 				NVIC thread			Runs the enabled handlers whose flags are raised, holding the
+ * 									interrupt lock that __disable_irq() takes in thread mode
+ *
+ * 			The firmware's own main() is the thread-mode code and runs on the process main thread.
+ */
+
+#ifndef SIM_INC_SIM_H_
+#define SIM_INC_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define SIM_USART_COUNT		3U	//USART1, USART2, USART6 - same order as UART_Name_t
+#define SIM_DMA_STREAMS		16U	//DMA1 streams 0-7, then DMA2 streams 0-7
+
+/* Hardware thread lock: the USART/DMA model state and every DR side effect run under it */
+extern pthread_mutex_t simHwLock;
+
+uint64_t simNow(void); //Monotonic nanoseconds
+
+/*
+ * -----------------------------------------------------------
+ * Core (simCore.c)
+ * -----------------------------------------------------------
+ */
+void simCoreInit(void);
+void simCoreStart(void);
+
+/* ADC1 regular conversions as a DMA source */
+bool simAdcRequest(void);
+uint32_t simAdcDmaRead(void);
+
+/* TIM1 update as the waveform stream's request line */
+bool simTim1UpdateRequest(void);
+
+/*
+ * -----------------------------------------------------------
+ * USART model (simUsart.c)
+ * -----------------------------------------------------------
+ */
+bool simUsartOpen(uint8_t port, const char* link, bool strictBaud);
+void simUsartReset(void);
+void simUsartStep(uint64_t now);
+bool simUsartIrqPending(uint8_t port);
+int simUsartPortOf(uint32_t addr);
+
+/* DMA request lines and the DR accesses a stream makes when it serves them */
+bool simUsartRxRequest(uint8_t port);
+bool simUsartTxRequest(uint8_t port);
+uint32_t simUsartDmaRead(uint8_t port);
+void simUsartDmaWrite(uint8_t port, uint32_t value);
+
+/*
+ * -----------------------------------------------------------
+ * TIM4 capture on PB7 (simCapture.c)
+ * -----------------------------------------------------------
+ */
+bool simCaptureOwnsPin(void);
+void simCaptureLine(uint32_t line, uint8_t bits, uint32_t baud, uint64_t now);
+void simCaptureStep(uint64_t now);
+bool simCaptureIrqPending(uint8_t arg);
+
+/*
+ * -----------------------------------------------------------
+ * DMA model (simDma.c)
+ * -----------------------------------------------------------
+ */
+void simDmaReset(void);
+void simDmaService(void);
+void simDmaApplyClears(void);
+bool simDmaIrqPending(uint8_t index);
+
+#endif /* SIM_INC_SIM_H_ */
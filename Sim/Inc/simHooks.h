@@ -0,0 +1,21 @@
+/*
+ * simHooks.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * @brief	Register accesses the host build cannot leave to plain memory.
+ * 			Reading or writing USART DR has side effects (RXNE, TXE, TC, the shifter), so uart.c
+ * 			routes DR through these when built with HOST_SIM. Every other register is plain memory
+ * 			mapped at its real address and the models poll it.
+ */
+
+#ifndef SIM_INC_SIMHOOKS_H_
+#define SIM_INC_SIMHOOKS_H_
+
+#include <stdint.h>
+
+uint32_t simUsartReadDR(volatile uint32_t* dr);
+void simUsartWriteDR(volatile uint32_t* dr, uint32_t value);
+
+#endif /* SIM_INC_SIMHOOKS_H_ */
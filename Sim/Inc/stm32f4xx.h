@@ -0,0 +1,39 @@
+/*
+ * stm32f4xx.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * @brief	Host stand-in for the CMSIS device header. Only what Core/ uses outside the
+ * 			register maps of stm32PeripheralAddr.h: the flag enum and the PRIMASK/IPSR intrinsics,
+ * 			which the simulator backs with its interrupt lock (simCore.c).
+ */
+
+#ifndef SIM_INC_STM32F4XX_H_
+#define SIM_INC_STM32F4XX_H_
+
+#include <stdint.h>
+
+#define __IO	volatile
+
+typedef enum{
+	RESET = 0U,
+	SET = !RESET
+}FlagStatus, ITStatus;
+
+typedef enum{
+	DISABLE = 0U,
+	ENABLE = !DISABLE
+}FunctionalState;
+
+uint32_t simGetPrimask(void);
+void simSetPrimask(uint32_t value);
+uint32_t simGetIpsr(void);
+
+static inline uint32_t __get_PRIMASK(void)			{return simGetPrimask();}
+static inline void __set_PRIMASK(uint32_t priMask)	{simSetPrimask(priMask);}
+static inline void __disable_irq(void)				{simSetPrimask(1U);}
+static inline void __enable_irq(void)				{simSetPrimask(0U);}
+static inline uint32_t __get_IPSR(void)				{return simGetIpsr();}
+
+#endif /* SIM_INC_STM32F4XX_H_ */
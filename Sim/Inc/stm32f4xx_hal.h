@@ -0,0 +1,15 @@
+/*
+ * stm32f4xx_hal.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * @brief	Host stand-in for the HAL umbrella header: the drivers in Core/ only need the device header
+ */
+
+#ifndef SIM_INC_STM32F4XX_HAL_H_
+#define SIM_INC_STM32F4XX_HAL_H_
+
+#include "stm32f4xx.h"
+
+#endif /* SIM_INC_STM32F4XX_HAL_H_ */
@@ -0,0 +1,158 @@
+/*
+ * simCapture.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * @brief	TIM4 input capture on PB7, the USART1 RX pin, for the autobaud measurement.
+ *
+ * 			Only the configuration autobaud.c uses is modelled: PWM input on TI2, IC2 capturing
+ * 			falling edges and resetting the counter (slave reset mode), IC1 capturing the rising
+ * 			edge in between. Characters the terminal writes while the pin is routed to TIM4 are
+ * 			turned into their line waveform at the terminal's own rate, and every falling edge
+ * 			becomes one capture event. An event waits until the previous CC2IF was cleared, so a
+ * 			slow host never produces overcaptures the hardware would not.
+ *
+ * 			SR is rc_w0: the firmware clears flags by writing 0 to them and 1 to the rest, which
+ * 			plain memory would keep, so only the bits this model raised survive a step.
+ */
+#include <stdio.h>
+
+#include "sim.h"
+#include "stm32PeripheralAddr.h"
+#include "rcc.h"
+
+#define SR_UIF			(1U << 0)
+#define SR_CC1IF		(1U << 1)
+#define SR_CC2IF		(1U << 2)
+#define SR_CC2OF		(1U << 10)
+
+#define CAPTURE_QUEUE	64U		//Pending falling edges, a character has at most 6
+
+typedef struct{
+	uint64_t due;		//Time of the falling edge
+	uint32_t ccr1;
+	uint32_t ccr2;
+	uint32_t flags;		//SR bits raised with the capture
+}simCaptureEvent_t;
+
+static simCaptureEvent_t queue[CAPTURE_QUEUE];
+static uint8_t queueHead;
+static uint8_t queueTail;
+
+static uint64_t lineFree;		//End of the last stop bit sent
+static uint64_t lastFall;		//Counter reset: the previous falling edge, 0 for none
+static uint64_t lastRise;
+static uint32_t srModel;		//SR bits this model has raised and the firmware not yet cleared
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Private Helpers
+ * -----------------------------------------------------------
+ */
+/* @brief	Capture clock: APB1 timer clock through PSC */
+static uint64_t tickHz(void){
+	uint32_t ppre1 = (RCC_REG -> RCC_CFGR >> 10) & 0x7U;
+	uint64_t timClk = (uint64_t)RCC_getPCLK1Freq() * ((ppre1 < 4U) ? 1U : 2U);
+	return timClk / ((TIM4_REG -> TIM_PSC & 0xFFFFU) + 1U);
+}
+
+
+static uint64_t ticksBetween(uint64_t from, uint64_t to){
+	return (to - from) * tickHz() / 1000000000ULL;
+}
+
+
+static void edgeFalling(uint64_t t){
+	simCaptureEvent_t* ev = &queue[queueHead % CAPTURE_QUEUE];
+	if((uint8_t)(queueHead - queueTail) >= CAPTURE_QUEUE) return; //Host flooded the pin: edges lost
+
+	uint64_t period = (lastFall == 0) ? 0x10000U : ticksBetween(lastFall, t);
+	ev -> due = t;
+	ev -> flags = SR_CC2IF;
+	ev -> ccr1 = 0;
+	if(period > 0xFFFFU){
+		ev -> flags |= SR_UIF; //The counter wrapped since the last reset
+		period &= 0xFFFFU;
+	}
+	if(lastFall != 0 && lastRise > lastFall){
+		ev -> ccr1 = (uint32_t)(ticksBetween(lastFall, lastRise) & 0xFFFFU);
+		ev -> flags |= SR_CC1IF;
+	}
+	ev -> ccr2 = (uint32_t)period;
+	queueHead++;
+	lastFall = t;
+}
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Model API
+ * -----------------------------------------------------------
+ */
+/* @brief	PB7 on AF2 (TIM4_CH2), TIM4 counting with capture channel 2 enabled */
+bool simCaptureOwnsPin(void){
+	bool af2 = ((GPIOB_REG -> AFRL >> 28) & 0xFU) == 2U;
+	bool moder = ((GPIOB_REG -> MODER >> 14) & 0x3U) == 2U;
+	return af2 && moder && (TIM4_REG -> TIM_CR1 & 1U) && (TIM4_REG -> TIM_CCER & (1U << 4));
+}
+
+
+
+/*
+ * @brief	One character on the pin: @p line holds @p bits line levels LSB first, start bit
+ * 			to stop bits, each 1e9 / @p baud ns long. It starts at @p now or when the line is free
+ */
+void simCaptureLine(uint32_t line, uint8_t bits, uint32_t baud, uint64_t now){
+	if(baud == 0) return;
+	uint64_t start = (lineFree > now) ? lineFree : now;
+	uint8_t level = 1; //Idle high
+
+	for(uint8_t i = 0; i < bits; i++){
+		uint8_t bit = (line >> i) & 1U;
+		uint64_t t = start + (uint64_t)i * 1000000000ULL / baud;
+		if(level == 1 && bit == 0) edgeFalling(t);
+		if(level == 0 && bit == 1) lastRise = t;
+		level = bit;
+	}
+	lineFree = start + (uint64_t)bits * 1000000000ULL / baud;
+}
+
+
+
+/* @brief	Latch the due captures into TIM4 (hardware thread, simHwLock held) */
+void simCaptureStep(uint64_t now){
+	volatile timerRegOffset_t* tim = TIM4_REG;
+
+	/* rc_w0: whatever the firmware wrote 0 to is gone, bits it wrote 1 to were never ours */
+	uint32_t sr = tim -> TIM_SR;
+	while(!__atomic_compare_exchange_n(&tim -> TIM_SR, &sr, sr & srModel, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+	srModel &= sr;
+
+	if(!simCaptureOwnsPin()){
+		queueTail = queueHead;
+		lastFall = 0;
+		return;
+	}
+
+	while(queueTail != queueHead && (srModel & SR_CC2IF) == 0){
+		const simCaptureEvent_t* ev = &queue[queueTail % CAPTURE_QUEUE];
+		if(ev -> due > now) break;
+
+		if(ev -> flags & SR_CC1IF) tim -> TIM_CCR1 = ev -> ccr1;
+		tim -> TIM_CCR2 = ev -> ccr2;
+		srModel |= ev -> flags;
+		__atomic_fetch_or(&tim -> TIM_SR, ev -> flags, __ATOMIC_SEQ_CST);
+		queueTail++;
+	}
+}
+
+
+
+bool simCaptureIrqPending(uint8_t arg){
+	(void)arg;
+	return (TIM4_REG -> TIM_DIER & TIM4_REG -> TIM_SR & 0x1FU) != 0;
+}
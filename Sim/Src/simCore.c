@@ -0,0 +1,402 @@
+/*
+ * simCore.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * @brief	Memory map, interrupt emulation and the small peripherals the firmware waits on.
+ *
+ * 			PRIMASK is a lock: thread-mode __disable_irq() takes it, the NVIC thread holds it while
+ * 			a handler runs, so handlers never overlap a critical section just like on the core.
+ * 			Handler priorities are the default ones (lowest IRQ number first), there is no nesting.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "sim.h"
+#include "stm32PeripheralAddr.h"
+#include "exti.h"
+#include "rcc.h"
+
+/* Windows mapped at their real addresses */
+#define SIM_PERIPH_BASE		0x40000000UL	//APB1, APB2, AHB1 (TIM2 .. DMA2)
+#define SIM_PERIPH_SIZE		0x00030000UL
+#define SIM_SYSTEM_BASE		0xE0000000UL	//DWT, NVIC, SCB
+#define SIM_SYSTEM_SIZE		0x00010000UL
+
+#define SIM_STEP_NS			20000L			//Period of the hardware and NVIC threads
+
+/* Reset state of the clock tree, with the oscillators and PLL already settled */
+#define SIM_RCC_CR			((1U << 0) | (1U << 1) | (1U << 17) | (1U << 25))	//HSION/RDY, HSERDY, PLLRDY
+#define SIM_RCC_PLL_CFGR	0x24003010U
+#define SIM_RCC_CFGR		(0x2U << 2)		//SWS = PLL, so RCC_init() never waits on the switch
+#define SIM_ADC_TEMP_RAW	1037U			//0.76 V on the 3.0 V reference: 25 degC
+
+#define SIM_WEAK			__attribute__((weak))
+
+pthread_mutex_t simHwLock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t irqLock = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool irqWaiting;		//NVIC thread wants the lock thread mode keeps taking
+static __thread uint32_t primask;
+static __thread uint32_t ipsr;
+
+static uint32_t rccSwSeen;
+static uint64_t cycleLast;
+static uint64_t cycleRemainder;
+static bool adcRegular;		//Regular conversions running: SWSTART seen, CONT still set
+
+/* The timers the firmware runs: TIM1 (APB2) clocks the waveform stream, TIM5 (APB1) the tick */
+typedef struct{
+	volatile timerRegOffset_t* regs;
+	bool apb2;
+	uint32_t arrMask;
+	uint64_t next;
+	bool dmaRequest;	//Update DMA request waiting for its stream (UDE)
+}simTimer_t;
+
+static simTimer_t timers[] = {
+		{TIM1_REG, true, 0xFFFFU},
+		{TIM5_REG, false, 0xFFFFFFFFU},
+};
+#define SIM_TIM1	0U
+#define SIM_TIM5	1U
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Vector Table
+ * -----------------------------------------------------------
+ */
+void DMA1_Stream0_IRQHandler(void) SIM_WEAK;
+void DMA1_Stream1_IRQHandler(void) SIM_WEAK;
+void DMA1_Stream2_IRQHandler(void) SIM_WEAK;
+void DMA1_Stream3_IRQHandler(void) SIM_WEAK;
+void DMA1_Stream4_IRQHandler(void) SIM_WEAK;
+void DMA1_Stream5_IRQHandler(void) SIM_WEAK;
+void DMA1_Stream6_IRQHandler(void) SIM_WEAK;
+void DMA1_Stream7_IRQHandler(void) SIM_WEAK;
+void DMA2_Stream0_IRQHandler(void) SIM_WEAK;
+void DMA2_Stream1_IRQHandler(void) SIM_WEAK;
+void DMA2_Stream2_IRQHandler(void) SIM_WEAK;
+void DMA2_Stream3_IRQHandler(void) SIM_WEAK;
+void DMA2_Stream4_IRQHandler(void) SIM_WEAK;
+void DMA2_Stream5_IRQHandler(void) SIM_WEAK;
+void DMA2_Stream6_IRQHandler(void) SIM_WEAK;
+void DMA2_Stream7_IRQHandler(void) SIM_WEAK;
+void TIM1_UP_TIM10_IRQHandler(void) SIM_WEAK;
+void TIM4_IRQHandler(void) SIM_WEAK;
+void TIM5_IRQHandler(void) SIM_WEAK;
+void USART1_IRQHandler(void) SIM_WEAK;
+void USART2_IRQHandler(void) SIM_WEAK;
+void USART6_IRQHandler(void) SIM_WEAK;
+
+static bool timerIrqPending(uint8_t arg);
+
+typedef struct{
+	IRQn_Pos_t irqn;
+	void (*handler)(void);
+	bool (*pending)(uint8_t arg);
+	uint8_t arg;
+	const char* name;
+}simIrq_t;
+
+/* Sorted by IRQ number, which is also the order of equal-priority handlers */
+static const simIrq_t irqTable[] = {
+		{DMA1_S0,		DMA1_Stream0_IRQHandler,	simDmaIrqPending,	0,		"DMA1_Stream0"},
+		{DMA1_S1,		DMA1_Stream1_IRQHandler,	simDmaIrqPending,	1,		"DMA1_Stream1"},
+		{DMA1_S2,		DMA1_Stream2_IRQHandler,	simDmaIrqPending,	2,		"DMA1_Stream2"},
+		{DMA1_S3,		DMA1_Stream3_IRQHandler,	simDmaIrqPending,	3,		"DMA1_Stream3"},
+		{DMA1_S4,		DMA1_Stream4_IRQHandler,	simDmaIrqPending,	4,		"DMA1_Stream4"},
+		{DMA1_S5,		DMA1_Stream5_IRQHandler,	simDmaIrqPending,	5,		"DMA1_Stream5"},
+		{DMA1_S6,		DMA1_Stream6_IRQHandler,	simDmaIrqPending,	6,		"DMA1_Stream6"},
+		{TIM1_UP_TIM10,	TIM1_UP_TIM10_IRQHandler,	timerIrqPending,	SIM_TIM1,	"TIM1_UP_TIM10"},
+		{TIM4_user,		TIM4_IRQHandler,			simCaptureIrqPending,	0,	"TIM4"},
+		{UART1,			USART1_IRQHandler,			simUsartIrqPending,	0,		"USART1"},
+		{UART2,			USART2_IRQHandler,			simUsartIrqPending,	1,		"USART2"},
+		{DMA1_S7,		DMA1_Stream7_IRQHandler,	simDmaIrqPending,	7,		"DMA1_Stream7"},
+		{TIM5_user,		TIM5_IRQHandler,			timerIrqPending,	SIM_TIM5,	"TIM5"},
+		{DMA2_S0,		DMA2_Stream0_IRQHandler,	simDmaIrqPending,	8 + 0,	"DMA2_Stream0"},
+		{DMA2_S1,		DMA2_Stream1_IRQHandler,	simDmaIrqPending,	8 + 1,	"DMA2_Stream1"},
+		{DMA2_S2,		DMA2_Stream2_IRQHandler,	simDmaIrqPending,	8 + 2,	"DMA2_Stream2"},
+		{DMA2_S3,		DMA2_Stream3_IRQHandler,	simDmaIrqPending,	8 + 3,	"DMA2_Stream3"},
+		{DMA2_S4,		DMA2_Stream4_IRQHandler,	simDmaIrqPending,	8 + 4,	"DMA2_Stream4"},
+		{DMA2_S5,		DMA2_Stream5_IRQHandler,	simDmaIrqPending,	8 + 5,	"DMA2_Stream5"},
+		{DMA2_S6,		DMA2_Stream6_IRQHandler,	simDmaIrqPending,	8 + 6,	"DMA2_Stream6"},
+		{DMA2_S7,		DMA2_Stream7_IRQHandler,	simDmaIrqPending,	8 + 7,	"DMA2_Stream7"},
+		{UART6,			USART6_IRQHandler,			simUsartIrqPending,	2,		"USART6"},
+};
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Core Registers (stm32f4xx.h intrinsics)
+ * -----------------------------------------------------------
+ */
+uint32_t simGetPrimask(void){return primask;}
+uint32_t simGetIpsr(void){return ipsr;}
+
+void simSetPrimask(uint32_t value){
+	value &= 1U;
+	if(ipsr == 0 && value != primask){
+		if(value){
+			pthread_mutex_lock(&irqLock);
+		}
+		else{
+			pthread_mutex_unlock(&irqLock);
+			if(irqWaiting) sched_yield(); //Let a pending handler in before thread mode locks again
+		}
+	}
+	primask = value;
+}
+
+
+
+uint64_t simNow(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Small Peripherals
+ * -----------------------------------------------------------
+ */
+/*
+ * @brief	The system clock switch follows a change of SW. Polling is slower than the firmware's
+ * 			switch timeout, so SWS already reads PLL out of reset and only later changes are copied.
+ */
+static void rccStep(void){
+	uint32_t cfgr = RCC_REG -> RCC_CFGR;
+	uint32_t sw = cfgr & 0x3U;
+	if(sw == rccSwSeen) return;
+	rccSwSeen = sw;
+	__atomic_fetch_and(&RCC_REG -> RCC_CFGR, ~(0x3U << 2), __ATOMIC_SEQ_CST);
+	__atomic_fetch_or(&RCC_REG -> RCC_CFGR, sw << 2, __ATOMIC_SEQ_CST);
+}
+
+
+
+/*
+ * @brief	JSWSTART converts the injected channel at once and reads the temperature sensor at 25 degC.
+ * 			SWSTART converts the regular channel once, or once per step while CONT is set; a
+ * 			result nobody read (EOC still set) raises OVR.
+ */
+static void adcStep(void){
+	uint32_t cr2 = ADC1_REG -> ADC_CR2;
+	if(cr2 & (1U << 22)){
+		ADC1_REG -> ADC_JDR1 = SIM_ADC_TEMP_RAW;
+		__atomic_fetch_and(&ADC1_REG -> ADC_CR2, ~(1U << 22), __ATOMIC_SEQ_CST);
+		__atomic_fetch_or(&ADC1_REG -> ADC_SR, (1U << 2) | (1U << 3), __ATOMIC_SEQ_CST); //JEOC, JSTRT
+	}
+
+	if(cr2 & (1U << 30)){
+		__atomic_fetch_and(&ADC1_REG -> ADC_CR2, ~(1U << 30), __ATOMIC_SEQ_CST);
+		adcRegular = true;
+	}
+	if(!adcRegular) return;
+
+	if(ADC1_REG -> ADC_SR & (1U << 1)) __atomic_fetch_or(&ADC1_REG -> ADC_SR, 1U << 5, __ATOMIC_SEQ_CST); //OVR
+	ADC1_REG -> ADC_DR = SIM_ADC_TEMP_RAW;
+	__atomic_fetch_or(&ADC1_REG -> ADC_SR, (1U << 1) | (1U << 4), __ATOMIC_SEQ_CST); //EOC, STRT
+	adcRegular = (cr2 & (1U << 1)) != 0; //CONT
+}
+
+
+
+/* @brief	ADC1 DMA request line: a regular result is waiting, DMA is on and no overrun stopped it */
+bool simAdcRequest(void){
+	return (ADC1_REG -> ADC_CR2 & (1U << 8)) && (ADC1_REG -> ADC_SR & ((1U << 1) | (1U << 5))) == (1U << 1);
+}
+
+/* @brief	A stream reading ADC_DR: clears EOC like the real read does */
+uint32_t simAdcDmaRead(void){
+	__atomic_fetch_and(&ADC1_REG -> ADC_SR, ~(1U << 1), __ATOMIC_SEQ_CST);
+	return ADC1_REG -> ADC_DR;
+}
+
+
+
+/* @brief	Update event every (PSC + 1) * (ARR + 1) timer clocks, on each running timer */
+static void timerStep(simTimer_t* t, uint64_t now){
+	volatile timerRegOffset_t* tim = t -> regs;
+	if((tim -> TIM_CR1 & 1U) == 0){
+		t -> next = 0;
+		return;
+	}
+
+	uint32_t ppre = t -> apb2 ? (RCC_REG -> RCC_CFGR >> 13) & 0x7U : (RCC_REG -> RCC_CFGR >> 10) & 0x7U;
+	uint32_t pclk = t -> apb2 ? RCC_getPCLK2Freq() : RCC_getPCLK1Freq();
+	uint64_t timClk = (uint64_t)pclk * ((ppre < 4U) ? 1U : 2U);
+	if(timClk == 0) return;
+
+	uint64_t period = (uint64_t)((tim -> TIM_PSC & 0xFFFFU) + 1U) * ((tim -> TIM_ARR & t -> arrMask) + 1ULL) * 1000000000ULL / timClk;
+	if(period == 0) return;
+
+	if(t -> next == 0 || now > t -> next + 100U * period) t -> next = now + period; //Started, or the host stalled us
+	if(now >= t -> next){
+		__atomic_fetch_or(&tim -> TIM_SR, 1U, __ATOMIC_SEQ_CST); //UIF
+		if(tim -> TIM_DIER & (1U << 8)) t -> dmaRequest = true; //UDE
+		t -> next += period;
+	}
+}
+
+static bool timerIrqPending(uint8_t arg){
+	volatile timerRegOffset_t* tim = timers[arg].regs;
+	return (tim -> TIM_DIER & 1U) && (tim -> TIM_SR & 1U);
+}
+
+/* @brief	TIM1_UP DMA request line: served (and dropped) by the one item it moves */
+bool simTim1UpdateRequest(void){
+	simTimer_t* t = &timers[SIM_TIM1];
+	if(!t -> dmaRequest || (t -> regs -> TIM_DIER & (1U << 8)) == 0) return false;
+	t -> dmaRequest = false;
+	return true;
+}
+
+
+
+/* @brief	DWT_CYCCNT runs at HCLK once TRCENA and CYCCNTENA are set */
+static void cycleCounterStep(uint64_t now){
+	uint64_t elapsed = now - cycleLast;
+	cycleLast = now;
+
+	bool trcena = (*(volatile uint32_t*)DEMCR_ADDR >> 24) & 1U;
+	bool enabled = *(volatile uint32_t*)DWT_CTRL_ADDR & 1U;
+	if(!trcena || !enabled) return;
+
+	uint64_t cycles = elapsed * RCC_getHCLKFreq() + cycleRemainder;
+	cycleRemainder = cycles % 1000000000ULL;
+	*(volatile uint32_t*)DWT_CYCCNT_ADDR += (uint32_t)(cycles / 1000000000ULL);
+}
+
+
+
+/*
+ * -----------------------------------------------------------
+ * NVIC
+ * -----------------------------------------------------------
+ */
+static void nvicApplyClears(void){
+	for(uint8_t i = 0; i < 8U; i++){
+		uint32_t clear = __atomic_exchange_n(&NVIC_REG -> _ICER[i], 0U, __ATOMIC_SEQ_CST);
+		if(clear) __atomic_fetch_and(&NVIC_REG -> _ISER[i], ~clear, __ATOMIC_SEQ_CST);
+	}
+}
+
+static inline bool nvicEnabled(IRQn_Pos_t irqn){
+	return (NVIC_REG -> _ISER[irqn / 32U] >> (irqn % 32U)) & 1U;
+}
+
+
+
+static void* nvicThread(void* arg){
+	(void)arg;
+	const struct timespec step = {0, SIM_STEP_NS};
+
+	for(;;){
+		irqWaiting = true;
+		pthread_mutex_lock(&irqLock);
+		irqWaiting = false;
+
+		nvicApplyClears();
+		simDmaApplyClears();
+		for(uint8_t i = 0; i < sizeof irqTable / sizeof irqTable[0]; i++){
+			const simIrq_t* irq = &irqTable[i];
+			if(!nvicEnabled(irq -> irqn) || !irq -> pending(irq -> arg)) continue;
+
+			if(irq -> handler == NULL){
+				//Default_Handler would spin forever, keep the rest of the system alive instead
+				fprintf(stderr, "sim: %s enabled without a handler, disabling it\n", irq -> name);
+				NVIC_REG -> _ICER[irq -> irqn / 32U] = 1U << (irq -> irqn % 32U);
+				continue;
+			}
+			ipsr = (uint32_t)irq -> irqn + 16U;
+			irq -> handler();
+			ipsr = 0;
+			primask = 0;
+			simDmaApplyClears();
+			nvicApplyClears();
+		}
+
+		pthread_mutex_unlock(&irqLock);
+		nanosleep(&step, NULL);
+	}
+	return NULL;
+}
+
+
+
+static void* hardwareThread(void* arg){
+	(void)arg;
+	const struct timespec step = {0, SIM_STEP_NS};
+	cycleLast = simNow();
+
+	for(;;){
+		uint64_t now = simNow();
+		pthread_mutex_lock(&simHwLock);
+		rccStep();
+		adcStep();
+		timerStep(&timers[SIM_TIM1], now);
+		timerStep(&timers[SIM_TIM5], now);
+		cycleCounterStep(now);
+		simUsartStep(now);
+		simCaptureStep(now);
+		simDmaService();
+		pthread_mutex_unlock(&simHwLock);
+		nanosleep(&step, NULL);
+	}
+	return NULL;
+}
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Public API
+ * -----------------------------------------------------------
+ */
+static void mapWindow(uintptr_t base, size_t size){
+	void* p = mmap((void*)base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if(p != (void*)base){
+		fprintf(stderr, "sim: cannot map 0x%08lx: %s\n", (unsigned long)base, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+
+/* @brief	Map the register windows and put the modelled peripherals in their reset state */
+void simCoreInit(void){
+	mapWindow(SIM_PERIPH_BASE, SIM_PERIPH_SIZE);
+	mapWindow(SIM_SYSTEM_BASE, SIM_SYSTEM_SIZE);
+
+	RCC_REG -> RCC_CR = SIM_RCC_CR;
+	RCC_REG -> RCC_PLL_CFGR = SIM_RCC_PLL_CFGR;
+	RCC_REG -> RCC_CFGR = SIM_RCC_CFGR;
+	simUsartReset();
+	simDmaReset();
+}
+
+
+
+/* @brief	Start the hardware and NVIC threads. The caller goes on as thread mode */
+void simCoreStart(void){
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, hardwareThread, NULL) != 0 ||
+	   pthread_create(&thread, NULL, nvicThread, NULL) != 0){
+		fprintf(stderr, "sim: cannot start the model threads\n");
+		exit(EXIT_FAILURE);
+	}
+}
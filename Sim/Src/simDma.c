@@ -0,0 +1,297 @@
+/*
+ * simDma.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * @brief	DMA1/DMA2 stream model over the dmaRegOffset_t blocks.
+ *
+ * 			A stream latches NDTR, PAR and M0AR/M1AR when EN goes high, like the real controller.
+ * 			Peripheral streams move one item per asserted request line (only the USART and ADC1 lines
+ * 			are wired), memory-to-memory streams run to the end at once. NDTR counts down in place so
+ * 			the drivers can read the write position, HT/TC are raised at half and end of a pass,
+ * 			CIRC and DBM reload, and the flag clear registers act like the write-1-to-clear bits.
+ *
+ * 			Addresses are 32-bit register values, so everything a stream touches must live below
+ * 			4 GB: static data in the non-PIE host build does, the peripheral window does.
+ */
+#include <stdio.h>
+
+#include "sim.h"
+#include "stm32PeripheralAddr.h"
+
+/* SxCR */
+#define CR_EN			(1U << 0)
+#define CR_DMEIE		(1U << 1)
+#define CR_TEIE			(1U << 2)
+#define CR_HTIE			(1U << 3)
+#define CR_TCIE			(1U << 4)
+#define CR_DIR_POS		6U
+#define CR_CIRC			(1U << 8)
+#define CR_PINC			(1U << 9)
+#define CR_MINC			(1U << 10)
+#define CR_PSIZE_POS	11U
+#define CR_MSIZE_POS	13U
+#define CR_DBM			(1U << 18)
+#define CR_CT			(1U << 19)
+#define CR_CHSEL_POS	25U
+
+#define FCR_RESET		0x21U		//FS = empty, direct mode
+#define FCR_FEIE		(1U << 7)
+
+/* Per-stream flags in LISR/HISR */
+#define FLAG_FE			(1U << 0)
+#define FLAG_DME		(1U << 2)
+#define FLAG_TE			(1U << 3)
+#define FLAG_HT			(1U << 4)
+#define FLAG_TC			(1U << 5)
+
+typedef enum{
+	DIR_P2M = 0,
+	DIR_M2P = 1,
+	DIR_M2M = 2
+}simDmaDir_t;
+
+/* @brief	One stream's six registers, same layout as DMA_SxCR..DMA_SxFCR in dmaRegOffset_t */
+typedef struct{
+	volatile uint32_t CR;
+	volatile uint32_t NDTR;
+	volatile uint32_t PAR;
+	volatile uint32_t M0AR;
+	volatile uint32_t M1AR;
+	volatile uint32_t FCR;
+}simDmaStreamRegs_t;
+
+/* @brief	What the controller latched when the stream was enabled */
+typedef struct{
+	bool active;
+	uint32_t total;		//NDTR at enable
+	uint32_t done;		//Items moved in the current pass
+	uint32_t par;		//Current peripheral (M2M: source) address
+	uint32_t mar;		//Current memory address
+	uint32_t parBase;	//PAR and M0AR as latched, to spot a reprogrammed stream
+	uint32_t m0Base;
+}simDmaStream_t;
+
+/* @brief	Request line of a peripheral on one stream/channel pair (RM0383 Tables 27 and 28) */
+typedef struct{
+	uint8_t index;		//DMA1 streams 0-7, DMA2 streams 8-15
+	uint8_t channel;
+	uint8_t port;		//USART model port, REQ_ADC1 or REQ_TIM1_UP
+	bool rx;
+}simDmaRequest_t;
+
+#define REQ_ADC1		0xFFU
+#define REQ_TIM1_UP		0xFEU
+
+static const simDmaRequest_t requests[] = {
+		{8 + 2, 4, 0, true},	//USART1_RX
+		{8 + 5, 4, 0, true},	//USART1_RX
+		{8 + 7, 4, 0, false},	//USART1_TX
+		{5,		4, 1, true},	//USART2_RX
+		{6,		4, 1, false},	//USART2_TX
+		{8 + 1, 5, 2, true},	//USART6_RX
+		{8 + 2, 5, 2, true},	//USART6_RX
+		{8 + 6, 5, 2, false},	//USART6_TX
+		{8 + 7, 5, 2, false},	//USART6_TX
+		{8 + 0, 0, REQ_ADC1, true},	//ADC1
+		{8 + 4, 0, REQ_ADC1, true},	//ADC1
+		{8 + 5, 6, REQ_TIM1_UP, false},	//TIM1_UP
+};
+
+static volatile dmaRegOffset_t* const controllers[2] = {DMA1_REG, DMA2_REG};
+static const uint8_t flagShift[4] = {0, 6, 16, 22};
+static simDmaStream_t streams[SIM_DMA_STREAMS];
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Private Helpers
+ * -----------------------------------------------------------
+ */
+static inline volatile simDmaStreamRegs_t* streamRegs(uint8_t index){
+	return (volatile simDmaStreamRegs_t*)&controllers[index >> 3] -> DMA_S0CR + (index & 7U);
+}
+
+static inline volatile uint32_t* flagReg(uint8_t index){
+	volatile dmaRegOffset_t* dma = controllers[index >> 3];
+	return ((index & 7U) < 4U) ? &dma -> DMA_LISR : &dma -> DMA_HISR;
+}
+
+static inline void flagSet(uint8_t index, uint32_t flags){
+	__atomic_fetch_or(flagReg(index), flags << flagShift[index & 3U], __ATOMIC_SEQ_CST);
+}
+
+
+
+static uint32_t busRead(uint32_t addr, uint8_t size){
+	int port = simUsartPortOf(addr);
+	if(port >= 0) return simUsartDmaRead((uint8_t)port);
+	if(addr == (uint32_t)(uintptr_t)&ADC1_REG -> ADC_DR) return simAdcDmaRead();
+
+	switch(size){
+		case 1: return *(volatile uint8_t*)(uintptr_t)addr;
+		case 2: return *(volatile uint16_t*)(uintptr_t)addr;
+		default: return *(volatile uint32_t*)(uintptr_t)addr;
+	}
+}
+
+static void busWrite(uint32_t addr, uint8_t size, uint32_t value){
+	int port = simUsartPortOf(addr);
+	if(port >= 0){
+		simUsartDmaWrite((uint8_t)port, value);
+		return;
+	}
+
+	switch(size){
+		case 1: *(volatile uint8_t*)(uintptr_t)addr = (uint8_t)value; break;
+		case 2: *(volatile uint16_t*)(uintptr_t)addr = (uint16_t)value; break;
+		default: *(volatile uint32_t*)(uintptr_t)addr = value; break;
+	}
+}
+
+
+
+static bool requestAsserted(uint8_t index, uint32_t cr, simDmaDir_t dir){
+	uint8_t channel = (cr >> CR_CHSEL_POS) & 0x7U;
+	for(uint8_t i = 0; i < sizeof requests / sizeof requests[0]; i++){
+		const simDmaRequest_t* req = &requests[i];
+		if(req -> index != index || req -> channel != channel) continue;
+		if(req -> port == REQ_ADC1) return dir == DIR_P2M && simAdcRequest();
+		if(req -> port == REQ_TIM1_UP) return dir == DIR_M2P && simTim1UpdateRequest();
+		if(req -> rx && dir == DIR_P2M) return simUsartRxRequest(req -> port);
+		if(!req -> rx && dir == DIR_M2P) return simUsartTxRequest(req -> port);
+	}
+	return false;
+}
+
+
+
+static void streamStart(simDmaStream_t* s, volatile simDmaStreamRegs_t* regs, uint32_t cr){
+	s -> total = regs -> NDTR & 0xFFFFU;
+	if(s -> total == 0){
+		__atomic_fetch_and(&regs -> CR, ~CR_EN, __ATOMIC_SEQ_CST); //Nothing to move: the stream never starts
+		return;
+	}
+	s -> done = 0;
+	s -> parBase = regs -> PAR;
+	s -> m0Base = regs -> M0AR;
+	s -> par = s -> parBase;
+	s -> mar = ((cr & CR_DBM) && (cr & CR_CT)) ? regs -> M1AR : s -> m0Base;
+	s -> active = true;
+}
+
+
+
+/*
+ * @brief	The real EN takes a while to read back 0, here it drops at once and the hardware
+ * 			thread can miss a disable/reprogram/enable sequence. Registers that differ from what
+ * 			the stream latched give it away. M0AR is only fixed outside double-buffer mode.
+ */
+static bool streamReprogrammed(const simDmaStream_t* s, volatile simDmaStreamRegs_t* regs, uint32_t cr){
+	if((regs -> NDTR & 0xFFFFU) != s -> total - s -> done) return true;
+	if(regs -> PAR != s -> parBase) return true;
+	return ((cr & CR_DBM) == 0) && regs -> M0AR != s -> m0Base;
+}
+
+
+
+/* @brief	One item, then NDTR, HT/TC and the end-of-pass reload or stop */
+static void moveItem(uint8_t index, simDmaStream_t* s, volatile simDmaStreamRegs_t* regs, uint32_t cr, simDmaDir_t dir){
+	uint8_t psize = 1U << ((cr >> CR_PSIZE_POS) & 0x3U);
+	uint8_t msize = 1U << ((cr >> CR_MSIZE_POS) & 0x3U);
+
+	if(dir == DIR_M2P) busWrite(s -> par, psize, busRead(s -> mar, msize));
+	else busWrite(s -> mar, msize, busRead(s -> par, psize)); //P2M, and M2M from PAR to M0AR
+
+	if(cr & CR_PINC) s -> par += psize;
+	if(cr & CR_MINC) s -> mar += msize;
+	s -> done++;
+	regs -> NDTR = s -> total - s -> done;
+
+	if(s -> total >= 2U && s -> done == s -> total / 2U) flagSet(index, FLAG_HT);
+	if(s -> done != s -> total) return;
+
+	flagSet(index, FLAG_TC);
+	if(cr & (CR_CIRC | CR_DBM)){
+		s -> done = 0;
+		s -> par = s -> parBase;
+		regs -> NDTR = s -> total;
+		if(cr & CR_DBM){
+			uint32_t now = __atomic_xor_fetch(&regs -> CR, CR_CT, __ATOMIC_SEQ_CST);
+			s -> mar = (now & CR_CT) ? regs -> M1AR : regs -> M0AR;
+		}
+		else{
+			s -> mar = s -> m0Base;
+		}
+		return;
+	}
+	__atomic_fetch_and(&regs -> CR, ~CR_EN, __ATOMIC_SEQ_CST); //Hardware clears EN at the end of a normal transfer
+	s -> active = false;
+}
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Model API
+ * -----------------------------------------------------------
+ */
+void simDmaReset(void){
+	for(uint8_t i = 0; i < SIM_DMA_STREAMS; i++){
+		streamRegs(i) -> FCR = FCR_RESET;
+		streams[i].active = false;
+	}
+}
+
+
+
+/* @brief	Apply LIFCR/HIFCR writes to LISR/HISR */
+void simDmaApplyClears(void){
+	for(uint8_t d = 0; d < 2U; d++){
+		volatile dmaRegOffset_t* dma = controllers[d];
+		uint32_t low = __atomic_exchange_n(&dma -> DMA_LIFCR, 0U, __ATOMIC_SEQ_CST);
+		uint32_t high = __atomic_exchange_n(&dma -> DMA_HIFCR, 0U, __ATOMIC_SEQ_CST);
+		if(low) __atomic_fetch_and(&dma -> DMA_LISR, ~low, __ATOMIC_SEQ_CST);
+		if(high) __atomic_fetch_and(&dma -> DMA_HISR, ~high, __ATOMIC_SEQ_CST);
+	}
+}
+
+
+
+/* @brief	Serve every enabled stream as far as its request line allows (simHwLock held) */
+void simDmaService(void){
+	simDmaApplyClears();
+	for(uint8_t i = 0; i < SIM_DMA_STREAMS; i++){
+		volatile simDmaStreamRegs_t* regs = streamRegs(i);
+		simDmaStream_t* s = &streams[i];
+
+		uint32_t cr = regs -> CR;
+		if((cr & CR_EN) == 0){
+			s -> active = false;
+			continue;
+		}
+		if(!s -> active || streamReprogrammed(s, regs, cr)) streamStart(s, regs, cr);
+
+		simDmaDir_t dir = (simDmaDir_t)((cr >> CR_DIR_POS) & 0x3U);
+		while(s -> active && (regs -> CR & CR_EN) && (dir == DIR_M2M || requestAsserted(i, cr, dir))){
+			moveItem(i, s, regs, cr, dir);
+		}
+	}
+}
+
+
+
+/* @brief	Level of a stream's NVIC line */
+bool simDmaIrqPending(uint8_t index){
+	volatile simDmaStreamRegs_t* regs = streamRegs(index);
+	uint32_t flags = (*flagReg(index) >> flagShift[index & 3U]) & 0x3DU;
+	uint32_t cr = regs -> CR;
+
+	return ((cr & CR_TCIE) && (flags & FLAG_TC)) ||
+		   ((cr & CR_HTIE) && (flags & FLAG_HT)) ||
+		   ((cr & CR_TEIE) && (flags & FLAG_TE)) ||
+		   ((cr & CR_DMEIE) && (flags & FLAG_DME)) ||
+		   ((regs -> FCR & FCR_FEIE) && (flags & FLAG_FE));
+}
@@ -0,0 +1,80 @@
+/*
+ * simMain.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * @brief	Host entry point: maps the simulated STM32F411, wires the USARTs to pseudo-terminals
+ * 			and runs the firmware's main() (built as firmwareMain()) as thread mode.
+ *
+ * 			The update path runs as on the board up to firmwareUpdate(): the linker routes that
+ * 			call here (-Wl,--wrap=firmwareUpdate) and the received image goes to a file instead of
+ * 			sector 0, then the process exits the way the board would reset.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#define SIM_DEFAULT_IMAGE	"firmware.bin"
+
+int firmwareMain(void);
+
+static const char* imagePath = SIM_DEFAULT_IMAGE;
+
+
+
+/* @brief	Stands in for the flash programming of flash.c */
+void __wrap_firmwareUpdate(uint8_t* programBuf, int bufSize){
+	FILE* f = fopen(imagePath, "wb");
+	if(f == NULL || fwrite(programBuf, 1, (size_t)bufSize, f) != (size_t)bufSize){
+		perror(imagePath);
+		exit(EXIT_FAILURE);
+	}
+	fclose(f);
+	printf("sim: firmware image of %d bytes written to %s, resetting\n", bufSize, imagePath);
+	exit(EXIT_SUCCESS);
+}
+
+
+
+static void usage(const char* prog){
+	fprintf(stderr,
+			"usage: %s [-1 link] [-2 link] [-6 link] [-o image] [-s]\n"
+			"  -1/-2/-6 link  symlink to the pty of USART1/USART2/USART6\n"
+			"  -o image       where \"Update firmware\" stores the received image (default %s)\n"
+			"  -s             strict baud: characters sent at another terminal rate arrive with FE\n",
+			prog, SIM_DEFAULT_IMAGE);
+}
+
+
+
+int main(int argc, char* argv[]){
+	const char* links[SIM_USART_COUNT] = {NULL, NULL, NULL};
+	bool strictBaud = false;
+	int opt;
+
+	while((opt = getopt(argc, argv, "1:2:6:o:sh")) != -1){
+		switch(opt){
+			case '1': links[0] = optarg; break;
+			case '2': links[1] = optarg; break;
+			case '6': links[2] = optarg; break;
+			case 'o': imagePath = optarg; break;
+			case 's': strictBaud = true; break;
+			default: usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	simCoreInit();
+	for(uint8_t i = 0; i < SIM_USART_COUNT; i++){
+		if(!simUsartOpen(i, links[i], strictBaud)){
+			fprintf(stderr, "sim: cannot create a pty for port %u\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+	simCoreStart();
+
+	return firmwareMain();
+}
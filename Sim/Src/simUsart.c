@@ -0,0 +1,464 @@
+/*
+ * simUsart.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: dobao
+ *
+ * @brief	USART model behind the uartRegOffset_t blocks, one Linux pseudo-terminal per wired port.
+ *
+ * 			Line timing follows the configured frame: baud from BRR/OVER8 and the APB clock the
+ * 			firmware set up, 1 start + 8/9 data + 0.5..2 stop bits per character. A character written
+ * 			by a terminal program reaches DR one character time after the previous one; a character
+ * 			written to DR leaves on the pty when its shift register time is over.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "sim.h"
+#include "simHooks.h"
+#include "stm32PeripheralAddr.h"
+#include "rcc.h"
+
+/* SR */
+#define SR_PE		(1U << 0)
+#define SR_FE		(1U << 1)
+#define SR_NE		(1U << 2)
+#define SR_ORE		(1U << 3)
+#define SR_IDLE		(1U << 4)
+#define SR_RXNE		(1U << 5)
+#define SR_TC		(1U << 6)
+#define SR_TXE		(1U << 7)
+#define SR_RESET	(SR_TXE | SR_TC)
+
+/* CR1 */
+#define CR1_RE		(1U << 2)
+#define CR1_IDLEIE	(1U << 4)
+#define CR1_RXNEIE	(1U << 5)
+#define CR1_TCIE	(1U << 6)
+#define CR1_TXEIE	(1U << 7)
+#define CR1_PEIE	(1U << 8)
+#define CR1_PS		(1U << 9)
+#define CR1_PCE		(1U << 10)
+#define CR1_M		(1U << 12)
+#define CR1_UE		(1U << 13)
+#define CR1_OVER8	(1U << 15)
+
+/* CR3 */
+#define CR3_EIE		(1U << 0)
+#define CR3_DMAR	(1U << 6)
+#define CR3_DMAT	(1U << 7)
+#define CR3_RTSE	(1U << 8)
+
+#define SIM_RX_CHUNK			64U		//Bytes taken from the pty at once
+#define SIM_BAUD_TOLERANCE_PCT	3U		//Strict mode: terminal and USART rates may differ this much
+
+typedef struct{
+	volatile uartRegOffset_t* regs;
+	bool apb2;						//USART1/6 run from PCLK2, USART2 from PCLK1
+	const char* name;
+
+	int fd;							//pty master, -1 when the port is not wired
+	int slaveFd;					//Held open so the line survives terminal programs coming and going
+	bool strictBaud;				//Characters sent at another rate arrive with FE
+	uint64_t modelTime;				//Time the model is at while the hardware thread catches up
+
+	/* Transmitter: TDR -> shift register -> pty */
+	bool tdrFull;
+	uint32_t tdr;
+	bool shifting;
+	uint32_t shiftValue;
+	uint64_t shiftEnd;
+
+	/* Receiver: pty -> shift register -> RDR */
+	uint8_t rxBuf[SIM_RX_CHUNK];
+	uint16_t rxLen;
+	uint16_t rxIdx;
+	uint64_t rxNext;				//Time the character in the shift register is complete
+	bool rxHeld;					//RTS high: the sender is waiting for DR to be read
+	uint32_t rdr;
+	bool idleArmed;					//A character arrived since the last IDLE
+	uint64_t lastRx;
+}simUsart_t;
+
+static simUsart_t usarts[SIM_USART_COUNT] = {
+		{UART1_REG, true,	"USART1", -1, -1},
+		{UART2_REG, false,	"USART2", -1, -1},
+		{UART6_REG, true,	"USART6", -1, -1},
+};
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Private Helpers
+ * -----------------------------------------------------------
+ */
+/* The model and the firmware both write SR, so the model only ever sets or clears its own bits */
+static inline void srSet(simUsart_t* u, uint32_t bits)		{__atomic_fetch_or(&u -> regs -> UART_SR, bits, __ATOMIC_SEQ_CST);}
+static inline void srClear(simUsart_t* u, uint32_t bits)	{__atomic_fetch_and(&u -> regs -> UART_SR, ~bits, __ATOMIC_SEQ_CST);}
+
+
+
+/* @brief	Baud rate the USART really runs at: pclk / USARTDIV in BRR units */
+static uint32_t usartBaud(const simUsart_t* u){
+	uint32_t pclk = u -> apb2 ? RCC_getPCLK2Freq() : RCC_getPCLK1Freq();
+	uint32_t brr = u -> regs -> UART_BRR & 0xFFFFU;
+	uint32_t div = (u -> regs -> UART_CR1 & CR1_OVER8) ? (((brr >> 4) << 3) | (brr & 0x7U)) : brr;
+	return (div == 0) ? 0 : pclk / div;
+}
+
+
+
+/* @brief	Nanoseconds one character takes on the line, 0 while the USART cannot run */
+static uint64_t charTime(const simUsart_t* u){
+	static const uint8_t stopHalves[4] = {2, 1, 4, 3}; //STOP[1:0]: 1, 0.5, 2, 1.5 bits
+	uint32_t cr1 = u -> regs -> UART_CR1;
+	if((cr1 & CR1_UE) == 0) return 0;
+
+	uint32_t baud = usartBaud(u);
+	if(baud == 0) return 0;
+
+	uint32_t halfBits = 2U * (1U + ((cr1 & CR1_M) ? 9U : 8U)) + stopHalves[(u -> regs -> UART_CR2 >> 12) & 0x3U];
+	return (uint64_t)halfBits * 1000000000ULL / (2ULL * baud);
+}
+
+
+
+/* @brief	RDR content for a byte from the terminal: the parity bit is the MSB of the frame */
+static uint32_t rxFrameValue(uint32_t cr1, uint8_t byte){
+	uint32_t bits = (cr1 & CR1_M) ? 9U : 8U;
+	uint32_t value = byte;
+	if(cr1 & CR1_PCE){
+		value &= (1U << (bits - 1U)) - 1U;
+		uint32_t odd = __builtin_parity(value);
+		uint32_t parity = (cr1 & CR1_PS) ? !odd : odd;
+		value |= parity << (bits - 1U);
+	}
+	return value;
+}
+
+
+
+/* @brief	Rate the terminal program set on its end of the pty */
+static uint32_t terminalBaud(const simUsart_t* u){
+	static const struct{speed_t speed; uint32_t baud;} rates[] = {
+			{B1200, 1200}, {B2400, 2400}, {B4800, 4800}, {B9600, 9600}, {B19200, 19200},
+			{B38400, 38400}, {B57600, 57600}, {B115200, 115200}, {B230400, 230400},
+			{B460800, 460800}, {B921600, 921600},
+	};
+	struct termios tio;
+	if(tcgetattr(u -> slaveFd, &tio) != 0) return 0;
+	speed_t speed = cfgetispeed(&tio);
+	for(uint8_t i = 0; i < sizeof rates / sizeof rates[0]; i++){
+		if(rates[i].speed == speed) return rates[i].baud;
+	}
+	return 0;
+}
+
+
+
+static bool baudMismatch(const simUsart_t* u){
+	if(!u -> strictBaud) return false;
+	uint32_t ours = usartBaud(u);
+	uint32_t theirs = terminalBaud(u);
+	uint32_t diff = (ours > theirs) ? ours - theirs : theirs - ours;
+	return (uint64_t)diff * 100U > (uint64_t)ours * SIM_BAUD_TOLERANCE_PCT;
+}
+
+
+
+static void loadShifter(simUsart_t* u, uint64_t start, uint64_t tChar){
+	u -> shiftValue = u -> tdr;
+	u -> tdrFull = false;
+	u -> shifting = true;
+	u -> shiftEnd = start + tChar;
+	srSet(u, SR_TXE);
+}
+
+
+
+/* @brief	DR write: TDR takes the value, the shifter picks it up as soon as it is free */
+static void usartWrite(simUsart_t* u, uint32_t value, uint64_t when){
+	if((u -> regs -> UART_CR1 & CR1_UE) == 0) return;
+
+	u -> tdr = value & 0x1FFU;
+	u -> tdrFull = true;
+	srClear(u, SR_TXE | SR_TC);
+
+	uint64_t tChar = charTime(u);
+	if(!u -> shifting && tChar != 0) loadShifter(u, when, tChar);
+}
+
+
+
+static void txStep(simUsart_t* u, uint64_t now, uint64_t tChar){
+	if(!u -> shifting && u -> tdrFull) loadShifter(u, now, tChar);
+
+	while(u -> shifting && now >= u -> shiftEnd){
+		uint8_t byte = (uint8_t)u -> shiftValue; //9th bit has no place on a pty
+		if(u -> fd >= 0 && write(u -> fd, &byte, 1) != 1){
+			//Nobody reading and the pty buffer is full: the character is lost like on an open line
+		}
+		u -> shifting = false;
+		u -> modelTime = u -> shiftEnd;
+		if(u -> tdrFull) loadShifter(u, u -> shiftEnd, tChar);
+		else srSet(u, SR_TC);
+		simDmaService(); //A TX stream refills TDR right after TXE
+	}
+}
+
+
+
+static bool rxFill(simUsart_t* u){
+	if(u -> rxIdx < u -> rxLen) return true;
+	if(u -> fd < 0) return false;
+
+	ssize_t n = read(u -> fd, u -> rxBuf, sizeof u -> rxBuf);
+	if(n <= 0) return false;
+	u -> rxLen = (uint16_t)n;
+	u -> rxIdx = 0;
+	return true;
+}
+
+
+
+/*
+ * @brief	Receiver off: characters pass the pin unseen. USART1's RX pin may be routed to the
+ * 			TIM4 capture instead, which gets them as line levels at the terminal's own frame format
+ */
+static void rxToPin(simUsart_t* u, uint64_t now){
+	struct termios tio;
+	bool capture = (u == &usarts[0]) && simCaptureOwnsPin() && tcgetattr(u -> slaveFd, &tio) == 0;
+
+	while(rxFill(u)){
+		uint8_t byte = u -> rxBuf[u -> rxIdx++];
+		if(!capture) continue;
+
+		uint8_t dataBits = 5U + (uint8_t)((tio.c_cflag & CSIZE) >> 4); //Linux CS5..CS8 are 0x00..0x30
+		uint32_t data = byte & ((1U << dataBits) - 1U);
+		uint32_t line = data << 1; //Start bit 0
+		uint8_t bits = 1U + dataBits;
+
+		if(tio.c_cflag & PARENB){
+			uint32_t odd = __builtin_parity(data);
+			line |= ((tio.c_cflag & PARODD) ? !odd : odd) << bits;
+			bits++;
+		}
+		uint8_t stop = (tio.c_cflag & CSTOPB) ? 2U : 1U;
+		line |= ((1U << stop) - 1U) << bits;
+		bits += stop;
+
+		uint32_t baud = terminalBaud(u);
+		simCaptureLine(line, bits, (baud != 0) ? baud : usartBaud(u), now);
+	}
+}
+
+
+
+static void rxStep(simUsart_t* u, uint64_t now, uint64_t tChar){
+	uint32_t cr1 = u -> regs -> UART_CR1;
+	if((cr1 & CR1_RE) == 0){
+		rxToPin(u, now);
+		return;
+	}
+
+	/* RTS goes low again once DR is read, and the sender starts the held character */
+	if(u -> rxHeld){
+		if(u -> regs -> UART_SR & SR_RXNE) return;
+		u -> rxHeld = false;
+		u -> rxNext = now + tChar;
+	}
+
+	while(rxFill(u)){
+		if(u -> rxNext + tChar < now){
+			u -> rxNext = now; //Line was idle: this character started when it came out of the pty
+		}
+		if(u -> rxNext > now) break;
+
+		uint32_t sr = u -> regs -> UART_SR;
+		bool rts = (u -> regs -> UART_CR3 & CR3_RTSE) != 0;
+		if((sr & SR_RXNE) && rts){
+			u -> rxHeld = true;
+			break;
+		}
+
+		uint8_t byte = u -> rxBuf[u -> rxIdx++];
+		if(sr & SR_RXNE){
+			srSet(u, SR_ORE); //RDR keeps the old character, this one is lost
+		}
+		else{
+			u -> rdr = rxFrameValue(cr1, byte);
+			srSet(u, SR_RXNE | (baudMismatch(u) ? SR_FE : 0U));
+		}
+		u -> lastRx = u -> rxNext;
+		u -> idleArmed = true;
+		u -> modelTime = u -> rxNext;
+		u -> rxNext += tChar;
+		simDmaService(); //An RX stream empties RDR before the next character lands
+	}
+
+	/* IDLE: a whole character time without a start bit after at least one character */
+	if(u -> idleArmed && u -> rxIdx == u -> rxLen && now >= u -> lastRx + tChar){
+		u -> idleArmed = false;
+		srSet(u, SR_IDLE);
+	}
+}
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Model API
+ * -----------------------------------------------------------
+ */
+/*
+ * @brief	Create the pseudo-terminal of a port. @p link, when given, becomes a symlink to it
+ * 			so terminal programs can use a fixed name
+ */
+bool simUsartOpen(uint8_t port, const char* link, bool strictBaud){
+	if(port >= SIM_USART_COUNT) return false;
+	simUsart_t* u = &usarts[port];
+
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if(fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) return false;
+
+	const char* path = ptsname(fd);
+	int slaveFd = (path != NULL) ? open(path, O_RDWR | O_NOCTTY) : -1;
+	if(slaveFd < 0){
+		close(fd);
+		return false;
+	}
+
+	struct termios tio;
+	tcgetattr(slaveFd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slaveFd, TCSANOW, &tio);
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	u -> fd = fd;
+	u -> slaveFd = slaveFd;
+	u -> strictBaud = strictBaud;
+
+	if(link != NULL){
+		unlink(link);
+		if(symlink(path, link) != 0) perror(link);
+	}
+	printf("sim: %s on %s%s%s\n", u -> name, path, link ? " -> " : "", link ? link : "");
+	return true;
+}
+
+
+
+void simUsartReset(void){
+	for(uint8_t i = 0; i < SIM_USART_COUNT; i++){
+		usarts[i].regs -> UART_SR = SR_RESET;
+	}
+}
+
+
+
+/* @brief	Advance every USART to @p now (hardware thread, simHwLock held) */
+void simUsartStep(uint64_t now){
+	for(uint8_t i = 0; i < SIM_USART_COUNT; i++){
+		simUsart_t* u = &usarts[i];
+		uint64_t tChar = charTime(u);
+		if(tChar == 0) continue;
+
+		u -> modelTime = now;
+		txStep(u, now, tChar);
+		rxStep(u, now, tChar);
+		u -> modelTime = now;
+	}
+}
+
+
+
+/* @brief	Level of the USART's NVIC line (RM0383 USART interrupt mapping) */
+bool simUsartIrqPending(uint8_t port){
+	volatile uartRegOffset_t* regs = usarts[port].regs;
+	uint32_t sr = regs -> UART_SR;
+	uint32_t cr1 = regs -> UART_CR1;
+	uint32_t cr3 = regs -> UART_CR3;
+
+	return ((cr1 & CR1_RXNEIE) && (sr & (SR_RXNE | SR_ORE))) ||
+		   ((cr1 & CR1_TXEIE) && (sr & SR_TXE)) ||
+		   ((cr1 & CR1_TCIE) && (sr & SR_TC)) ||
+		   ((cr1 & CR1_IDLEIE) && (sr & SR_IDLE)) ||
+		   ((cr1 & CR1_PEIE) && (sr & SR_PE)) ||
+		   ((cr3 & CR3_EIE) && (cr3 & CR3_DMAR) && (sr & (SR_FE | SR_NE | SR_ORE)));
+}
+
+
+
+/* @brief	Port whose DR sits at @p addr, -1 for any other address */
+int simUsartPortOf(uint32_t addr){
+	for(uint8_t i = 0; i < SIM_USART_COUNT; i++){
+		if((uint32_t)(uintptr_t)&usarts[i].regs -> UART_DR == addr) return i;
+	}
+	return -1;
+}
+
+
+
+bool simUsartRxRequest(uint8_t port){
+	volatile uartRegOffset_t* regs = usarts[port].regs;
+	return (regs -> UART_CR3 & CR3_DMAR) && (regs -> UART_SR & SR_RXNE);
+}
+
+bool simUsartTxRequest(uint8_t port){
+	volatile uartRegOffset_t* regs = usarts[port].regs;
+	return (regs -> UART_CR3 & CR3_DMAT) && (regs -> UART_SR & SR_TXE);
+}
+
+
+
+/* @brief	DMA read of DR: only RXNE clears, the SR-then-DR sequence is a CPU thing */
+uint32_t simUsartDmaRead(uint8_t port){
+	simUsart_t* u = &usarts[port];
+	srClear(u, SR_RXNE);
+	return u -> rdr;
+}
+
+void simUsartDmaWrite(uint8_t port, uint32_t value){
+	simUsart_t* u = &usarts[port];
+	usartWrite(u, value, u -> modelTime);
+}
+
+
+
+/*
+ * -----------------------------------------------------------
+ * Firmware Hooks (simHooks.h)
+ * -----------------------------------------------------------
+ */
+/* @brief	CPU read of DR. Firmware always reads SR first, so the error flags and IDLE clear too */
+uint32_t simUsartReadDR(volatile uint32_t* dr){
+	int port = simUsartPortOf((uint32_t)(uintptr_t)dr);
+	if(port < 0) return *dr;
+
+	pthread_mutex_lock(&simHwLock);
+	simUsart_t* u = &usarts[port];
+	srClear(u, SR_RXNE | SR_IDLE | SR_ORE | SR_NE | SR_FE | SR_PE);
+	uint32_t value = u -> rdr;
+	pthread_mutex_unlock(&simHwLock);
+	return value;
+}
+
+
+
+void simUsartWriteDR(volatile uint32_t* dr, uint32_t value){
+	int port = simUsartPortOf((uint32_t)(uintptr_t)dr);
+	if(port < 0){
+		*dr = value;
+		return;
+	}
+
+	pthread_mutex_lock(&simHwLock);
+	usartWrite(&usarts[port], value, simNow());
+	pthread_mutex_unlock(&simHwLock);
+}
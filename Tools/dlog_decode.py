@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+dlog_decode.py
+
+Host side of the deferred logger in Core/Src/dlog.c. The board sends only a log ID, a
+timestamp and raw 32-bit arguments; the format strings stay in the .dlog section of the
+ELF, where a string's address is its ID.
+
+Records arrive in TELEMETRY_MSG_DLOG telemetry frames (see telemetry_decode.py):
+
+    | id (2) | arg count (1) | timestamp ms (4) | args (4 x count) |
+
+Usage:
+    dlog_decode.py firmware.elf /dev/ttyUSB0          # live, 9600 baud 8O1 (needs pyserial)
+    dlog_decode.py firmware.elf capture.bin --file    # recorded byte stream
+    dlog_decode.py firmware.elf /dev/ttyUSB0 --mux    # link in "Mux on" mode
+
+Records are sent while the board is in "Telemetry binary" mode or the mux is on.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import telemetry_decode as telemetry  # noqa: E402
+
+MSG_DLOG = 0x02
+
+SPEC = re.compile(r"%([-+ 0#]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l|z|j|t)?([diouxXcfFeEgGp%])")
+
+
+def load_formats(elf_path):
+    """Map log ID -> format string from the .dlog section of a little-endian ELF32 file."""
+    with open(elf_path, "rb") as elf:
+        image = elf.read()
+    if image[:4] != b"\x7fELF" or image[4] != 1 or image[5] != 1:
+        raise ValueError("%s is not a little-endian ELF32 file" % elf_path)
+
+    shoff, = struct.unpack_from("<I", image, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", image, 0x2E)
+
+    def section(index):
+        name, _, _, addr, offset, size = struct.unpack_from("<IIIIII", image, shoff + index * shentsize)
+        return name, addr, offset, size
+
+    names_offset = section(shstrndx)[2]
+    for index in range(shnum):
+        name, addr, offset, size = section(index)
+        end = image.index(b"\0", names_offset + name)
+        if image[names_offset + name:end] != b".dlog":
+            continue
+
+        formats = {}
+        data = image[offset:offset + size]
+        start = 0
+        while start < len(data):
+            stop = data.index(b"\0", start)
+            if stop > start:
+                formats[addr + start] = data[start:stop].decode("ascii", "replace")
+            start = stop + 1
+        return formats
+
+    raise ValueError("%s has no .dlog section" % elf_path)
+
+
+def render(fmt, args):
+    """printf with 32-bit words: signedness and float-ness come from the conversion."""
+    words = iter(args)
+
+    def convert(match):
+        flags, width, precision, conv = match.groups()
+        if conv == "%":
+            return "%"
+        word = next(words, None)
+        if word is None:
+            return "<missing>"
+        spec = "%" + flags + width + ("." + precision if precision is not None else "")
+        if conv in "di":
+            return (spec + "d") % struct.unpack("<i", struct.pack("<I", word))[0]
+        if conv in "fFeEgG":
+            return (spec + conv) % struct.unpack("<f", struct.pack("<I", word))[0]
+        if conv == "c":
+            return chr(word & 0xFF)
+        if conv == "p":
+            return "0x%08x" % word
+        return (spec + ("d" if conv == "u" else conv)) % word
+
+    return SPEC.sub(convert, fmt)
+
+
+def records(payload):
+    offset = 0
+    while offset + 7 <= len(payload):
+        log_id, count, timestamp = struct.unpack_from("<HBI", payload, offset)
+        args = struct.unpack_from("<%dI" % count, payload, offset + 7)
+        offset += 7 + 4 * count
+        yield log_id, timestamp, args
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware ELF the board is running")
+    parser.add_argument("source", help="serial port or capture file")
+    parser.add_argument("--file", action="store_true", help="read a recorded byte stream")
+    parser.add_argument("--mux", action="store_true", help="stream is channel-multiplexed")
+    args = parser.parse_args()
+
+    formats = load_formats(args.elf)
+    chunks = telemetry.file_chunks(args.source) if args.file else telemetry.serial_chunks(args.source)
+
+    for block in telemetry.frames(chunks):
+        try:
+            frame = telemetry.cobs_decode(block)
+            if args.mux:
+                channel, frame = telemetry.parse_mux(frame)
+                if channel != telemetry.MUX_LOG:
+                    continue
+            if len(frame) < 8 or telemetry.crc16_ccitt(frame[:-2]) != struct.unpack_from("<H", frame, len(frame) - 2)[0]:
+                raise ValueError("CRC mismatch")
+        except (ValueError, struct.error) as err:
+            print("# dropped frame: %s" % err, file=sys.stderr)
+            continue
+
+        if frame[0] != MSG_DLOG:
+            continue
+        for log_id, timestamp, words in records(frame[6:-2]):
+            fmt = formats.get(log_id)
+            text = render(fmt, words) if fmt is not None else "<unknown log id 0x%04x>" % log_id
+            print("%10d ms  %s" % (timestamp, text))
+
+
+if __name__ == "__main__":
+    main()
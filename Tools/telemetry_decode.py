@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""
+telemetry_decode.py
+
+Host-side decoder for the binary telemetry frames sent by Core/Src/telemetry.c
+
+    | type (1) | seq (1) | timestamp ms (4) | payload | CRC-16/CCITT-FALSE (2) |
+
+COBS-encoded and terminated by 0x00, little-endian fields.
+
+Usage:
+    telemetry_decode.py /dev/ttyUSB0            # live, 9600 baud 8O1 (needs pyserial)
+    telemetry_decode.py capture.bin --file      # recorded byte stream
+    telemetry_decode.py /dev/ttyUSB0 --mux --command "Stats"
+
+Put the board in binary mode first with the console command "Telemetry binary".
+
+With --mux the stream is the channel multiplexer of Core/Src/mux.c ("Mux on"):
+
+    | channel (1) | payload | CRC-16/CCITT-FALSE (2) |
+
+Control replies and log lines are printed as text, telemetry frames on the log channel
+are decoded as above. --command sends one command line as a control frame first.
+"""
+
+import argparse
+import struct
+import sys
+
+MSG_TEMPERATURE = 0x01
+MSG_DLOG = 0x02  # deferred log records, decoded by dlog_decode.py
+
+MUX_CONTROL = 0
+MUX_UPDATE = 1
+MUX_LOG = 2
+MUX_NAMES = {MUX_CONTROL: "control", MUX_UPDATE: "update", MUX_LOG: "log"}
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_idx, code = 0, 1
+    for byte in data:
+        if byte == 0:
+            out[code_idx] = code
+            code_idx, code = len(out), 1
+            out.append(0)
+            continue
+        out.append(byte)
+        code += 1
+        if code == 0xFF:
+            out[code_idx] = code
+            code_idx, code = len(out), 1
+            out.append(0)
+    out[code_idx] = code
+    return bytes(out)
+
+
+def mux_frame(channel, payload):
+    body = bytes([channel]) + payload
+    return cobs_encode(body + struct.pack("<H", crc16_ccitt(body))) + b"\x00"
+
+
+def parse_mux(frame):
+    if len(frame) < 3:
+        raise ValueError("short mux frame")
+    body, crc = frame[:-2], struct.unpack_from("<H", frame, len(frame) - 2)[0]
+    if crc16_ccitt(body) != crc:
+        raise ValueError("mux CRC mismatch")
+    return body[0], body[1:]
+
+
+def parse_frame(frame):
+    if len(frame) < 8:
+        raise ValueError("short frame")
+    body, crc = frame[:-2], struct.unpack_from("<H", frame, len(frame) - 2)[0]
+    if crc16_ccitt(body) != crc:
+        raise ValueError("CRC mismatch")
+
+    msg_type, seq, timestamp = struct.unpack_from("<BBI", body, 0)
+    payload = body[6:]
+
+    if msg_type == MSG_TEMPERATURE:
+        period, count = struct.unpack_from("<HB", payload, 0)
+        samples = struct.unpack_from("<%dh" % count, payload, 3)
+        return [(seq, timestamp + n * period, value / 100.0) for n, value in enumerate(samples)]
+
+    return [(seq, timestamp, payload.hex())]
+
+
+def frames(stream):
+    """Yield raw COBS blocks split on the 0x00 delimiter; text before the first one is skipped."""
+    pending = bytearray()
+    synced = False
+    for chunk in stream:
+        for byte in chunk:
+            if byte == 0:
+                if synced and pending:
+                    yield bytes(pending)
+                pending.clear()
+                synced = True
+            else:
+                pending.append(byte)
+
+
+def serial_chunks(port, command=None):
+    import serial  # pyserial
+    link = serial.Serial(port, 9600, bytesize=serial.EIGHTBITS, parity=serial.PARITY_ODD,
+                         stopbits=serial.STOPBITS_ONE, timeout=1)
+    if command is not None:
+        link.write(mux_frame(MUX_CONTROL, command.encode("ascii") + b"\n"))
+    while True:
+        yield link.read(256)
+
+
+def file_chunks(path):
+    with open(path, "rb") as capture:
+        while True:
+            chunk = capture.read(4096)
+            if not chunk:
+                return
+            yield chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="serial port or capture file")
+    parser.add_argument("--file", action="store_true", help="read a recorded byte stream")
+    parser.add_argument("--mux", action="store_true", help="stream is channel-multiplexed")
+    parser.add_argument("--command", help="with --mux: send this command line on the control channel")
+    args = parser.parse_args()
+
+    if args.file:
+        chunks = file_chunks(args.source)
+    else:
+        chunks = serial_chunks(args.source, args.command if args.mux else None)
+    last_seq = None
+    for block in frames(chunks):
+        try:
+            frame = cobs_decode(block)
+            if args.mux:
+                channel, frame = parse_mux(frame)
+                if channel != MUX_LOG or frame[:1] not in (bytes([MSG_TEMPERATURE]), bytes([MSG_DLOG])):
+                    text = frame.decode("ascii", "replace").rstrip("\n")
+                    print("[%s] %s" % (MUX_NAMES.get(channel, channel), text))
+                    continue
+            records = parse_frame(frame)
+        except (ValueError, struct.error) as err:
+            print("# dropped frame: %s" % err, file=sys.stderr)
+            continue
+
+        seq = records[0][0]
+        if last_seq is not None and seq != (last_seq + 1) & 0xFF:
+            print("# %d frame(s) lost" % ((seq - last_seq - 1) & 0xFF), file=sys.stderr)
+        last_seq = seq
+
+        for _, timestamp, value in records:
+            text = ("%.2f" % value) if isinstance(value, float) else value
+            print("%10d ms  %s" % (timestamp, text))
+
+
+if __name__ == "__main__":
+    main()